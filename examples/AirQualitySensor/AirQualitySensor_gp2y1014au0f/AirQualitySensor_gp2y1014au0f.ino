@@ -45,6 +45,10 @@
 #define MIN (1000UL * 60 * 1)
 unsigned long dispatchTime = millis() + MIN;
 
+// Dust sensor sample interval
+#define SAMPLE_INTERVAL 1000UL
+unsigned long sampleTime = millis();
+
 const uint8_t SHARP_LED_PIN = D5;   // Sharp Dust/particle sensor Led Pin
 const uint8_t SHARP_VO_PIN = A0;    // Sharp Dust/particle analog out pin used for reading 
 
@@ -98,20 +102,18 @@ void setup() {
 void loop() {
   SinricPro.handle();
 
+  SinricProAirQualitySensor &mySinricProAirQualitySensor = SinricPro[DEVICE_ID]; // get air q sensor device
+
+  if((long)(millis() - sampleTime) >= 0) {
+    // collect samples, sendAirQualitySummary() sends their average
+    mySinricProAirQualitySensor.addAirQualitySample(0, dustSensor.getDustDensity(), 0);
+    sampleTime += SAMPLE_INTERVAL;
+  }
+
   if((long)(millis() - dispatchTime) >= 0) {
-    Serial.print("Dust density: ");
-    Serial.print(dustSensor.getDustDensity());
-    Serial.print(" ug/m3; Running average: ");
-    Serial.print(dustSensor.getRunningAverage());
-    Serial.println(" ug/m3");
-
-    SinricProAirQualitySensor &mySinricProAirQualitySensor = SinricPro[DEVICE_ID]; // get air q sensor device
-    
-    int pm1=0;
-    int pm2_5 = dustSensor.getRunningAverage();   
-    int pm10=0;   
-    
-    bool success = mySinricProAirQualitySensor.sendAirQualityEvent(pm1, pm2_5, pm10, "PERIODIC_POLL");
+    Serial.println("Sending Air Quality event ..");
+
+    bool success = mySinricProAirQualitySensor.sendAirQualitySummary("PERIODIC_POLL");
     if(success) {
       Serial.println("Air Quality event sent! ..");
     } else {
@@ -119,7 +121,5 @@ void loop() {
     }
 
     dispatchTime += MIN;
-
-    Serial.println("Sending Air Quality event ..");
   }  
 }
\ No newline at end of file
@@ -0,0 +1,286 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+/*
+ * Local websocket server: mDNS advertisement, routing of responses to their client (also when a slot is reused by
+ * another peer), admission control and the answers to rejected messages, and a request rate / latency benchmark of
+ * the receive -> respond path. The benchmark verifies the signature of every request and signs every response with
+ * SinricProSignature.cpp (HMAC-SHA256 computed with OpenSSL on the host); JSON parsing and serializing with ArduinoJson
+ * is not part of the host build and not included in the figures.
+ *
+ *   bench_local_server [rounds]
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <ArduinoJson.h>  // declarations only (shim/nojson)
+
+#include "../../src/SinricProLocalServer.h"
+#include "../../src/SinricProSignature.h"
+#include "test.h"
+
+using namespace SINRICPRO_NAMESPACE;
+
+static IPAddress clientIP(int client) { return IPAddress(192, 168, 1, 100 + client); }
+
+/**
+ * @brief Answer all queued requests like SinricProClass::handleReceiveQueue() does
+ */
+static size_t serve(LocalServerListener& listener, SinricProQueue_t& receiveQueue) {
+  size_t served = 0;
+  while (!receiveQueue.empty()) {
+    SinricProMessage* message = receiveQueue.front();
+    receiveQueue.pop();
+    listener.released();
+    String response = String("response to ") + message->getMessage();
+    listener.sendMessage(response, message->getRoute().client, message->getRoute().remoteIP);
+    delete message;
+    served++;
+  }
+  return served;
+}
+
+static const char* APP_SECRET = "a1b2c3d4-e5f6-a7b8-c9d0-e1f2a3b4c5d6-f7e8d9c0-b1a2-f3e4-d5c6-b7a8f9e0d1c2";
+
+/**
+ * @brief Text between `"<key>":"` and the next `"`
+ */
+static String stringValue(const String& message, const char* key) {
+  String pattern = String("\"") + key + "\":\"";
+  int    begin   = message.indexOf(pattern);
+  if (begin < 0) return "";
+  begin += pattern.length();
+  return message.substring(begin, message.indexOf('"', begin));
+}
+
+/**
+ * @brief A request signed with APP_SECRET, serialized like the SinricPro server / app does
+ */
+static std::string signedRequest(const std::string& replyToken) {
+  String payload = String("{\"action\":\"setPowerState\",\"clientId\":\"portal\",\"createdAt\":1700000000,\"deviceId\":\"5dc1564130xxxxxxxxxxxxxx\",\"replyToken\":\"") +
+                   replyToken.c_str() + "\",\"type\":\"request\",\"value\":{\"state\":\"On\"}}";
+  String message = String("{\"header\":{\"payloadVersion\":2,\"signatureVersion\":1},\"payload\":") + payload + ",\"signature\":{\"HMAC\":\"" +
+                   calculateSignature(APP_SECRET, payload) + "\"}}";
+  return message.c_str();
+}
+
+/**
+ * @brief Answer all queued requests with the signature work of SinricProClass::handleReceiveQueue() and sendQueuedMessage()
+ *
+ * The signature of every request is verified, the response is signed. Requests with an invalid signature are counted.
+ */
+static size_t serveSigned(LocalServerListener& listener, SinricProQueue_t& receiveQueue, size_t& invalid) {
+  size_t served = 0;
+  while (!receiveQueue.empty()) {
+    SinricProMessage* message = receiveQueue.front();
+    receiveQueue.pop();
+    listener.released();
+
+    String request = message->getMessage();
+    if (calculateSignature(APP_SECRET, extractPayload(message->getMessage())) != stringValue(request, "HMAC")) invalid++;
+
+    String payload = String("{\"action\":\"setPowerState\",\"clientId\":\"") + stringValue(request, "clientId") + "\",\"createdAt\":1700000001,\"deviceId\":\"" +
+                     stringValue(request, "deviceId") + "\",\"message\":\"OK\",\"replyToken\":\"" + stringValue(request, "replyToken") +
+                     "\",\"success\":true,\"type\":\"response\",\"value\":{\"state\":\"On\"}}";
+    String response = String("{\"header\":{\"payloadVersion\":2,\"signatureVersion\":1},\"payload\":") + payload + ",\"signature\":{\"HMAC\":\"" +
+                      calculateSignature(APP_SECRET, payload) + "\"}}";
+    listener.sendMessage(response, message->getRoute().client, message->getRoute().remoteIP);
+    delete message;
+    served++;
+  }
+  return served;
+}
+
+/**
+ * @brief Every client sends a first request on its own, afterwards the clients are known sources with a bucket of their own
+ */
+static void introduce(LocalServerListener& listener, SinricProQueue_t& receiveQueue, WebSocketsServer& server, const int* clients, int count) {
+  for (int i = 0; i < count; i++) {
+    server.hostText(clients[i], "hello");
+    listener.handle();
+    serve(listener, receiveQueue);
+  }
+  server.sent.clear();
+  HostClock::advance(1000000);
+}
+
+static void testSignature() {
+  // HMAC-SHA256 test vector of RFC 4231 (test case 2), base64 encoded
+  CHECK(HMACbase64("what do ya want for nothing?", "Jefe") == "W9zBRr9gdU5qBCQmCJV1x1oAPwidJzmDnexYuWTsOEM=");
+  std::string request = signedRequest("token");
+  CHECK(extractPayload(request.c_str()).indexOf("\"replyToken\":\"token\"") > 0);
+  CHECK(calculateSignature(APP_SECRET, extractPayload(request.c_str())) == stringValue(request, "HMAC"));
+  CHECK(calculateSignature("another secret", extractPayload(request.c_str())) != stringValue(request, "HMAC"));
+}
+
+static void testAdvertisement() {
+  HostNetwork::reset();
+  LocalServerListener listener;
+  SinricProQueue_t    receiveQueue;
+
+  String deviceIds;
+  for (int i = 0; i < 10; i++) deviceIds += (i ? ";" : "") + String("device") + String(i);
+  listener.begin(&receiveQueue, deviceIds);
+
+  auto& txt = HostNetwork::state().mdnsTxt;
+  CHECK(HostNetwork::state().mdnsHostname == "sinricpro-123456");
+  CHECK(txt["version"] == SINRICPRO_VERSION);
+  CHECK(txt["deviceids0"] == "device0;device1;device2;device3;device4;device5;device6;device7");
+  CHECK(txt["deviceids1"] == "device8;device9");
+  CHECK(txt.count("deviceids2") == 0);
+  listener.stop();
+  CHECK(HostNetwork::state().mdnsTxt.empty());
+}
+
+static void testRouting() {
+  HostNetwork::reset();
+  LocalServerListener listener;
+  SinricProQueue_t    receiveQueue;
+  listener.begin(&receiveQueue, "device");
+  WebSocketsServer& server = *WebSocketsServer::last();
+
+  int clients[SINRICPRO_LOCAL_SERVER_QUEUE_SHARE];
+  for (int i = 0; i < SINRICPRO_LOCAL_SERVER_QUEUE_SHARE; i++) clients[i] = server.hostConnect(clientIP(i));
+  introduce(listener, receiveQueue, server, clients, SINRICPRO_LOCAL_SERVER_QUEUE_SHARE);
+  for (int i = 0; i < SINRICPRO_LOCAL_SERVER_QUEUE_SHARE; i++) server.hostText(clients[i], "request " + std::to_string(i));
+  listener.handle();
+  serve(listener, receiveQueue);
+
+  CHECK(server.sent.size() == SINRICPRO_LOCAL_SERVER_QUEUE_SHARE);
+  for (size_t i = 0; i < server.sent.size(); i++) {
+    CHECK(server.sent[i].client == clients[i]);
+    CHECK(server.sent[i].remoteIP == clientIP(i));
+    CHECK(server.sent[i].text == "response to request " + std::to_string(i));
+  }
+  server.sent.clear();
+
+  // the client disconnects and another peer gets its slot before the response is ready
+  server.hostText(clients[0], "request from the old peer");
+  listener.handle();
+  server.hostDisconnect(clients[0]);
+  int reused = server.hostConnect(IPAddress(192, 168, 1, 200));
+  listener.handle();
+  CHECK(reused == clients[0]);
+  serve(listener, receiveQueue);
+  CHECK(server.sent.empty());
+
+  // the client is gone
+  server.hostText(clients[1], "request");
+  listener.handle();
+  server.hostDisconnect(clients[1]);
+  serve(listener, receiveQueue);
+  CHECK(server.sent.empty());
+  listener.stop();
+}
+
+static void testAdmission() {
+  HostNetwork::reset();
+  LocalServerListener listener;
+  SinricProQueue_t    receiveQueue;
+  listener.begin(&receiveQueue, "device");
+  WebSocketsServer& server = *WebSocketsServer::last();
+
+  int client = server.hostConnect(clientIP(0));
+  server.hostText(client, std::string(SINRICPRO_LOCAL_SERVER_MAX_SIZE + 1, 'x'));
+  for (int i = 0; i < 100; i++) server.hostText(client, "{\"payload\":{\"action\":\"setPowerState\",\"replyToken\":\"token-" + std::to_string(i) + "\"}}");
+  listener.handle();
+  CHECK(receiveQueue.size() == 1);  // the first message of a new client uses the shared bucket, its own bucket starts empty
+
+  // rejected messages are answered right away with a failed response carrying their replyToken
+  CHECK(server.sent.size() == 100);
+  if (server.sent.size() == 100) {
+    CHECK(server.sent[0].text == "{\"header\":{\"payloadVersion\":2,\"signatureVersion\":1},\"payload\":{\"type\":\"response\",\"success\":false,\"message\":\"Message is too large\",\"replyToken\":\"\"}}");
+    CHECK(server.sent[1].text.find("\"message\":\"Device is busy\",\"replyToken\":\"token-1\"") != std::string::npos);
+    CHECK(server.sent[99].text.find("\"replyToken\":\"token-99\"") != std::string::npos);
+    CHECK(server.sent[99].client == client);
+  }
+  server.sent.clear();
+  serve(listener, receiveQueue);
+
+  // the bucket of the client refills with SINRICPRO_LOCAL_SERVER_RATE messages per second
+  HostClock::advance(1000000);
+  server.sent.clear();
+  size_t accepted = 0;
+  for (int i = 0; i < SINRICPRO_LOCAL_SERVER_BURST; i++) {
+    server.hostText(client, "request");
+    listener.handle();
+    accepted += serve(listener, receiveQueue);
+  }
+  CHECK(server.sent.size() == SINRICPRO_LOCAL_SERVER_BURST);  // responses and busy answers
+  CHECK(accepted == SINRICPRO_LOCAL_SERVER_RATE);
+  listener.stop();
+}
+
+static double percentile(std::vector<double>& values, double p) {
+  if (values.empty()) return 0;
+  size_t index = std::min(values.size() - 1, (size_t)(p / 100 * values.size()));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+static void benchmark(int rounds) {
+  HostNetwork::reset();
+  LocalServerListener listener;
+  SinricProQueue_t    receiveQueue;
+  listener.begin(&receiveQueue, "device");
+  WebSocketsServer& server = *WebSocketsServer::last();
+
+  const int clients = SINRICPRO_LOCAL_SERVER_QUEUE_SHARE;  // every client has a request in flight at the same time
+  int       num[clients];
+  for (int i = 0; i < clients; i++) num[i] = server.hostConnect(clientIP(i));
+  listener.handle();
+  introduce(listener, receiveQueue, server, num, clients);
+
+  std::string request[clients];
+  for (int i = 0; i < clients; i++) request[i] = signedRequest("c3a8e7f2-1b4d-4e6a-9f0c-00000000000" + std::to_string(i));
+  std::vector<double> latencies;
+  latencies.reserve((size_t)rounds * clients);
+  size_t misrouted = 0;
+  size_t invalid   = 0;
+  double checking  = 0;  // time spent checking the responses, not part of the figures
+
+  double start = wallMicros();
+  for (int round = 0; round < rounds; round++) {
+    double sentAt[clients];
+    for (int i = 0; i < clients; i++) {
+      sentAt[i] = wallMicros();
+      server.hostText(num[i], request[i]);
+    }
+    listener.handle();
+    serveSigned(listener, receiveQueue, invalid);
+    double now = wallMicros();
+    for (auto& response : server.sent) latencies.push_back(now - sentAt[response.client]);
+    for (auto& response : server.sent) {
+      int    i    = response.client;
+      String text = response.text.c_str();
+      if (!(response.remoteIP == clientIP(i)) || stringValue(text, "replyToken") != stringValue(request[i], "replyToken")) misrouted++;
+      if (calculateSignature(APP_SECRET, extractPayload(text.c_str())) != stringValue(text, "HMAC")) invalid++;
+    }
+    server.sent.clear();
+    checking += wallMicros() - now;
+    HostClock::advance(250000);  // 4 requests per second and client (below SINRICPRO_LOCAL_SERVER_RATE)
+  }
+  double elapsed = wallMicros() - start - checking;
+
+  CHECK(latencies.size() == (size_t)rounds * clients);
+  CHECK(misrouted == 0);
+  CHECK(invalid == 0);
+  printf("local server: %zu requests from %d clients in %.1f ms (%.0f requests/s), latency p50 %.2f us, p99 %.2f us, max %.2f us\n", latencies.size(), clients,
+         elapsed / 1000, latencies.size() / (elapsed / 1000000), percentile(latencies, 50), percentile(latencies, 99), percentile(latencies, 100));
+  listener.stop();
+}
+
+int main(int argc, char** argv) {
+  testSignature();
+  testAdvertisement();
+  testRouting();
+  testAdmission();
+  benchmark(argc > 1 ? atoi(argv[1]) : 20000);
+  return testResult("bench_local_server");
+}
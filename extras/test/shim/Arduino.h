@@ -0,0 +1,40 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+/*
+ * Minimal Arduino core for the host tests.
+ * Time is simulated: millis() / micros() only advance when a test calls HostClock::advance() or delay().
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+using std::max;
+using std::min;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+struct HostClock {
+  static uint64_t& now() {
+    static uint64_t us = 1000000;
+    return us;
+  }
+  static void advance(uint64_t us) { now() += us; }
+};
+
+inline unsigned long micros() { return (unsigned long)(uint32_t)HostClock::now(); }
+inline unsigned long millis() { return (unsigned long)(uint32_t)(HostClock::now() / 1000); }
+inline void delay(unsigned long ms) { HostClock::advance((uint64_t)ms * 1000); }
+inline void yield() {}
+
+#include "WString.h"
+#include "IPAddress.h"
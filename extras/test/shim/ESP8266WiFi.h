@@ -0,0 +1,28 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include "Arduino.h"
+#include "HostNetwork.h"
+
+class HostWiFiClass {
+ public:
+  IPAddress localIP() { return HostNetwork::state().localIP; }
+  String    macAddress() { return HostNetwork::state().mac; }
+
+  int hostByName(const char* host, IPAddress& result) {
+    HostNetwork::State& s = HostNetwork::state();
+    s.dnsLookups++;
+    auto entry = s.hosts.find(host);
+    if (entry == s.hosts.end()) return 0;
+    result = entry->second;
+    return 1;
+  }
+};
+
+static HostWiFiClass WiFi;
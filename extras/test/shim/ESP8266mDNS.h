@@ -0,0 +1,34 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include "Arduino.h"
+#include "HostNetwork.h"
+
+/**
+ * @brief mDNS responder which records the advertised hostname and TXT records in HostNetwork::state()
+ */
+class HostMDNSClass {
+ public:
+  bool begin(const char* hostname) {
+    HostNetwork::state().mdnsHostname = hostname;
+    return true;
+  }
+  bool addService(const char*, const char*, uint16_t) { return true; }
+  bool addServiceTxt(const char*, const char*, const char* key, const char* value) {
+    HostNetwork::state().mdnsTxt[key] = value;
+    return true;
+  }
+  void update() {}
+  void end() {
+    HostNetwork::state().mdnsHostname.clear();
+    HostNetwork::state().mdnsTxt.clear();
+  }
+};
+
+static HostMDNSClass MDNS;
@@ -0,0 +1,68 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+
+/**
+ * @brief A simulated udp datagram
+ *
+ * For inbound datagrams `ip` / `port` are the sender, for outbound datagrams the destination.
+ */
+struct Datagram {
+  IPAddress   ip;
+  uint16_t    port;
+  std::string data;
+};
+
+/**
+ * @brief Simulated network shared by the WiFi, WiFiUDP and mDNS shims
+ */
+struct HostNetwork {
+  static const size_t MULTICAST_QUEUE = 16;  // datagrams the network stack buffers before it drops (like lwIP)
+
+  struct State {
+    IPAddress                          localIP        = IPAddress(192, 168, 1, 50);
+    String                             mac            = "5C:CF:7F:12:34:56";
+    std::deque<Datagram>               multicast;       // received on the multicast group, not yet read
+    std::vector<Datagram>              sent;            // unicast datagrams sent by the module
+    std::map<std::string, IPAddress>   hosts;           // dns table
+    size_t                             dnsLookups     = 0;
+    size_t                             multicastDrops = 0;
+    size_t                             multicastJoins = 0;
+    bool                               multicastOpen  = false;
+    std::string                        mdnsHostname;
+    std::map<std::string, std::string> mdnsTxt;
+  };
+
+  static State& state() {
+    static State s;
+    return s;
+  }
+
+  static void reset() { state() = State(); }
+
+  /**
+   * @brief Deliver a datagram to the multicast group
+   * @return `false` if the network stack buffer is full and the datagram has been dropped
+   */
+  static bool sendMulticast(const IPAddress& from, uint16_t port, const std::string& data) {
+    State& s = state();
+    if (!s.multicastOpen || s.multicast.size() >= MULTICAST_QUEUE) {
+      s.multicastDrops++;
+      return false;
+    }
+    s.multicast.push_back(Datagram{from, port, data});
+    return true;
+  }
+};
@@ -0,0 +1,33 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "WString.h"
+
+/**
+ * @brief IPv4 address, stored in network byte order like the ESP8266 core
+ */
+class IPAddress {
+ public:
+  IPAddress() : addr(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : addr(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+  IPAddress(uint32_t address) : addr(address) {}
+
+  operator uint32_t() const { return addr; }
+  bool    operator==(const IPAddress& rhs) const { return addr == rhs.addr; }
+  uint8_t operator[](int index) const { return (addr >> (index * 8)) & 0xff; }
+
+  String toString() const {
+    return String((int)(*this)[0]) + "." + String((int)(*this)[1]) + "." + String((int)(*this)[2]) + "." + String((int)(*this)[3]);
+  }
+
+ private:
+  uint32_t addr;
+};
@@ -0,0 +1,73 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+
+typedef uint8_t byte;  // like the cores, available with WString.h
+
+/**
+ * @brief Arduino String on top of std::string (only the members used by the SDK)
+ */
+class String {
+ public:
+  String() {}
+  String(const char* str) : s(str ? str : "") {}
+  String(const std::string& str) : s(str) {}
+  String(char c) : s(1, c) {}
+  String(int value) : s(std::to_string(value)) {}
+  String(unsigned int value) : s(std::to_string(value)) {}
+  String(long value) : s(std::to_string(value)) {}
+  String(unsigned long value) : s(std::to_string(value)) {}
+
+  const char*  c_str() const { return s.c_str(); }
+  unsigned int length() const { return s.length(); }
+  bool         isEmpty() const { return s.empty(); }
+  char         operator[](unsigned int index) const { return index < s.length() ? s[index] : 0; }
+
+  int indexOf(char c, unsigned int from = 0) const {
+    size_t pos = s.find(c, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+  }
+  int indexOf(const String& str, unsigned int from = 0) const {
+    size_t pos = s.find(str.s, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+  }
+  String substring(unsigned int from) const { return from < s.length() ? String(s.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    if (from >= s.length()) return String();
+    return String(s.substr(from, to - from));
+  }
+  void replace(const String& find, const String& replace) {
+    if (find.s.empty()) return;
+    for (size_t pos = s.find(find.s); pos != std::string::npos; pos = s.find(find.s, pos + replace.s.length())) s.replace(pos, find.s.length(), replace.s);
+  }
+  void toLowerCase() { std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char)std::tolower(c); }); }
+  void toUpperCase() { std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char)std::toupper(c); }); }
+
+  String& operator+=(const String& rhs) { s += rhs.s; return *this; }
+  String& operator+=(const char* rhs) { s += rhs; return *this; }
+  String& operator+=(char rhs) { s += rhs; return *this; }
+
+  friend String operator+(const String& lhs, const String& rhs) { return String(lhs.s + rhs.s); }
+  friend String operator+(const String& lhs, const char* rhs) { return String(lhs.s + rhs); }
+  friend String operator+(const char* lhs, const String& rhs) { return String(lhs + rhs.s); }
+
+  bool operator==(const String& rhs) const { return s == rhs.s; }
+  bool operator==(const char* rhs) const { return s == rhs; }
+  bool operator!=(const String& rhs) const { return s != rhs.s; }
+  bool operator<(const String& rhs) const { return s < rhs.s; }
+
+ private:
+  std::string s;
+};
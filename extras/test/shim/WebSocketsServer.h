@@ -0,0 +1,126 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+
+typedef enum {
+  WStype_ERROR,
+  WStype_DISCONNECTED,
+  WStype_CONNECTED,
+  WStype_TEXT,
+  WStype_BIN,
+  WStype_PING,
+  WStype_PONG,
+} WStype_t;
+
+/**
+ * @brief WebSocketsServer with simulated clients
+ *
+ * Tests reach the server of a listener through WebSocketsServer::last(). Clients connect, send and disconnect with
+ * the host*() functions, the events are delivered by the next loop() like in arduinoWebSockets.
+ */
+class WebSocketsServer {
+ public:
+  typedef std::function<void(uint8_t num, WStype_t type, uint8_t* payload, size_t length)> WebSocketServerEvent;
+
+  struct Sent {
+    uint8_t     client;
+    IPAddress   remoteIP;
+    std::string text;
+  };
+
+  static const uint8_t CLIENTS = 5;  // WEBSOCKETS_SERVER_CLIENT_MAX of arduinoWebSockets
+
+  WebSocketsServer(uint16_t, const String& = "", const String& = "arduino") { last() = this; }
+  ~WebSocketsServer() {
+    if (last() == this) last() = nullptr;
+  }
+
+  void begin() { running = true; }
+  void close() {
+    running = false;
+    for (auto& client : clients) client.connected = false;
+    events.clear();
+  }
+  void onEvent(WebSocketServerEvent cbEvent) { callback = cbEvent; }
+  void enableHeartbeat(uint32_t, uint32_t, uint8_t) {}
+
+  void loop() {
+    while (!events.empty()) {
+      Event event = events.front();
+      events.pop_front();
+      std::vector<uint8_t> payload(event.text.begin(), event.text.end());
+      payload.push_back(0);  // arduinoWebSockets terminates text payloads
+      if (callback) callback(event.client, event.type, payload.data(), event.text.size());
+    }
+  }
+
+  bool sendTXT(uint8_t num, String& payload) {
+    if (!clientIsConnected(num)) return false;
+    sent.push_back(Sent{num, clients[num].remoteIP, payload.c_str()});
+    return true;
+  }
+
+  IPAddress remoteIP(uint8_t num) { return num < CLIENTS && clients[num].connected ? clients[num].remoteIP : IPAddress(); }
+  bool      clientIsConnected(uint8_t num) { return num < CLIENTS && clients[num].connected; }
+
+  // simulation
+  static WebSocketsServer*& last() {
+    static WebSocketsServer* server = nullptr;
+    return server;
+  }
+
+  /**
+   * @brief Connect a client from `ip`
+   * @return client number or -1 if all slots are in use
+   */
+  int hostConnect(const IPAddress& ip) {
+    if (!running) return -1;
+    for (uint8_t num = 0; num < CLIENTS; num++) {
+      if (clients[num].connected) continue;
+      clients[num] = Client{true, ip};
+      events.push_back(Event{num, WStype_CONNECTED, std::string()});
+      return num;
+    }
+    return -1;
+  }
+
+  void hostDisconnect(uint8_t num) {
+    if (!clientIsConnected(num)) return;
+    clients[num].connected = false;
+    events.push_back(Event{num, WStype_DISCONNECTED, std::string()});
+  }
+
+  void hostText(uint8_t num, const std::string& text) {
+    if (clientIsConnected(num)) events.push_back(Event{num, WStype_TEXT, text});
+  }
+
+  std::vector<Sent> sent;
+
+ private:
+  struct Client {
+    bool      connected;
+    IPAddress remoteIP;
+  };
+  struct Event {
+    uint8_t     client;
+    WStype_t    type;
+    std::string text;
+  };
+
+  WebSocketServerEvent callback;
+  Client               clients[CLIENTS] = {};
+  std::deque<Event>    events;
+  bool                 running = false;
+};
@@ -0,0 +1,75 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include "Arduino.h"
+#include "HostNetwork.h"
+
+/**
+ * @brief WiFiUDP on the simulated network
+ *
+ * A multicast socket reads the datagrams of HostNetwork::sendMulticast(), packets sent with beginPacket() /
+ * endPacket() end up in HostNetwork::state().sent.
+ */
+class WiFiUDP {
+ public:
+  uint8_t beginMulticast(IPAddress, IPAddress, uint16_t port) { return join(port); }
+  uint8_t beginMulticast(IPAddress, uint16_t port) { return join(port); }
+
+  int parsePacket() {
+    HostNetwork::State& s = HostNetwork::state();
+    current = Datagram();
+    pos     = 0;
+    if (!multicast || s.multicast.empty()) return 0;
+    current = s.multicast.front();
+    s.multicast.pop_front();
+    return current.data.size();
+  }
+
+  IPAddress remoteIP() { return current.ip; }
+  uint16_t  remotePort() { return current.port; }
+
+  int read(char* buffer, size_t len) {
+    size_t n = std::min(len, current.data.size() - pos);
+    memcpy(buffer, current.data.data() + pos, n);
+    pos += n;
+    return n;
+  }
+
+  int beginPacket(IPAddress ip, uint16_t port) {
+    outgoing = Datagram{ip, port, std::string()};
+    return 1;
+  }
+  size_t print(const String& str) {
+    outgoing.data += str.c_str();
+    return str.length();
+  }
+  int endPacket() {
+    HostNetwork::state().sent.push_back(outgoing);
+    return 1;
+  }
+
+  void stop() {
+    if (multicast) HostNetwork::state().multicastOpen = false;
+    multicast = false;
+  }
+
+ private:
+  uint8_t join(uint16_t) {
+    HostNetwork::State& s = HostNetwork::state();
+    s.multicastJoins++;
+    s.multicastOpen = true;
+    multicast       = true;
+    return 1;
+  }
+
+  bool     multicast = false;
+  Datagram current;
+  size_t   pos = 0;
+  Datagram outgoing;
+};
@@ -0,0 +1,54 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+/*
+ * BearSSL HMAC API of the ESP8266 core (only the calls of SinricProSignature.cpp), computed with OpenSSL.
+ */
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#include <string>
+
+struct br_hash_class {
+  const EVP_MD* (*md)();
+};
+
+static const br_hash_class br_sha256_vtable = {EVP_sha256};
+
+struct br_hmac_key_context {
+  const br_hash_class* digest;
+  std::string          key;
+};
+
+struct br_hmac_context {
+  const br_hmac_key_context* keyContext;
+  std::string                data;
+};
+
+inline void br_hmac_key_init(br_hmac_key_context* keyContext, const br_hash_class* digest, const void* key, size_t length) {
+  keyContext->digest = digest;
+  keyContext->key.assign((const char*)key, length);
+}
+
+inline void br_hmac_init(br_hmac_context* context, const br_hmac_key_context* keyContext, size_t) {
+  context->keyContext = keyContext;
+  context->data.clear();
+}
+
+inline void br_hmac_update(br_hmac_context* context, const void* data, size_t length) {
+  context->data.append((const char*)data, length);
+}
+
+inline size_t br_hmac_out(const br_hmac_context* context, void* out) {
+  unsigned int length = 0;
+  HMAC(context->keyContext->digest->md(), context->keyContext->key.data(), (int)context->keyContext->key.size(), (const unsigned char*)context->data.data(),
+       context->data.size(), (unsigned char*)out, &length);
+  return length;
+}
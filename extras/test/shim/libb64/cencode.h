@@ -0,0 +1,87 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+/*
+ * libb64 base64 encoder of the ESP8266 core. Like the core with `stepsnewline = -1`, no line breaks are inserted.
+ */
+
+#define base64_encode_expected_len_nonewlines(n) ((((4 * (n)) / 3) + 3) & ~3)
+#define base64_encode_expected_len(n) base64_encode_expected_len_nonewlines(n)
+
+typedef enum { step_A, step_B, step_C } base64_encodestep;
+
+typedef struct {
+  base64_encodestep step;
+  char              result;
+  int               stepcount;
+  int               stepsnewline;
+} base64_encodestate;
+
+inline char base64_encode_value(char value) {
+  static const char* encoding = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  return value > 63 ? '=' : encoding[(int)value];
+}
+
+inline void base64_init_encodestate(base64_encodestate* state) {
+  state->step         = step_A;
+  state->result       = 0;
+  state->stepcount    = 0;
+  state->stepsnewline = -1;
+}
+
+inline int base64_encode_block(const char* plaintext, int length, char* code, base64_encodestate* state) {
+  const unsigned char* in  = (const unsigned char*)plaintext;
+  const unsigned char* end = in + length;
+  char*                out = code;
+  char                 result = state->result;
+
+  while (in < end) {
+    switch (state->step) {
+      case step_A:
+        result = (*in >> 2) & 0x3f;
+        *out++ = base64_encode_value(result);
+        result = (*in++ & 0x03) << 4;
+        state->step = step_B;
+        break;
+      case step_B:
+        result |= (*in >> 4) & 0x0f;
+        *out++ = base64_encode_value(result);
+        result = (*in++ & 0x0f) << 2;
+        state->step = step_C;
+        break;
+      case step_C:
+        result |= (*in >> 6) & 0x03;
+        *out++ = base64_encode_value(result);
+        *out++ = base64_encode_value(*in++ & 0x3f);
+        state->step = step_A;
+        break;
+    }
+  }
+  state->result = result;
+  return out - code;
+}
+
+inline int base64_encode_blockend(char* code, base64_encodestate* state) {
+  char* out = code;
+  switch (state->step) {
+    case step_B:
+      *out++ = base64_encode_value(state->result);
+      *out++ = '=';
+      *out++ = '=';
+      break;
+    case step_C:
+      *out++ = base64_encode_value(state->result);
+      *out++ = '=';
+      break;
+    case step_A:
+      break;
+  }
+  *out = 0;
+  return out - code;
+}
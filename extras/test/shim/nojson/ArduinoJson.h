@@ -0,0 +1,30 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+/*
+ * ArduinoJson is not part of the host build. These declarations only let SinricProSignature.cpp compile;
+ * signMessage() must not be called by the host tests (it returns an empty string).
+ */
+
+#include <WString.h>
+
+class JsonObject {};
+
+class JsonVariant {
+ public:
+  JsonVariant operator[](const char*) const { return JsonVariant(); }
+  template <typename T> bool is() const { return false; }
+  template <typename T> T to() { return T(); }
+  template <typename T> JsonVariant& operator=(const T&) { return *this; }
+  operator String() const { return String(); }
+};
+
+class JsonDocument : public JsonVariant {};
+
+template <typename T> size_t serializeJson(const JsonDocument&, T&) { return 0; }
@@ -0,0 +1,50 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <chrono>
+
+/*
+ * Tiny check helpers for the host tests: a failed CHECK prints the location, main() returns testResult().
+ */
+
+static int testChecks   = 0;
+static int testFailures = 0;
+
+#define CHECK(condition)                                                           \
+  do {                                                                             \
+    testChecks++;                                                                  \
+    if (!(condition)) {                                                            \
+      testFailures++;                                                              \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);         \
+    }                                                                              \
+  } while (0)
+
+#define CHECK_NEAR(value, expected, tolerance)                                                                  \
+  do {                                                                                                          \
+    testChecks++;                                                                                               \
+    double v_ = (value), e_ = (expected);                                                                       \
+    if (!(v_ - e_ <= (tolerance) && e_ - v_ <= (tolerance))) {                                                  \
+      testFailures++;                                                                                           \
+      printf("%s:%d: %s = %.6f, expected %.6f +/- %.6f\n", __FILE__, __LINE__, #value, v_, e_, (double)(tolerance)); \
+    }                                                                                                           \
+  } while (0)
+
+inline int testResult(const char* name) {
+  printf("%s: %d checks, %d failed\n", name, testChecks, testFailures);
+  return testFailures ? 1 : 0;
+}
+
+/**
+ * @brief Wall clock in microseconds (for throughput and latency figures, the SDK itself runs on the simulated clock)
+ */
+inline double wallMicros() {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,66 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+/*
+ * DnsCache: a reconnect within the ttl does not resolve the server again.
+ */
+
+#include "../../src/DnsCache.h"
+#include "test.h"
+
+using namespace SINRICPRO_NAMESPACE;
+
+int main() {
+  HostNetwork::reset();
+  auto& network = HostNetwork::state();
+  network.hosts["ws.sinric.pro"]     = IPAddress(203, 0, 113, 10);
+  network.hosts["backup.sinric.pro"]  = IPAddress(203, 0, 113, 20);
+
+  DnsCache  cache(60000);
+  IPAddress address;
+
+  CHECK(cache.resolve("ws.sinric.pro", address));
+  CHECK(address == IPAddress(203, 0, 113, 10));
+  CHECK(network.dnsLookups == 1);
+
+  // reconnects within the ttl use the cached address
+  for (int i = 0; i < 10; i++) {
+    HostClock::advance(5000000);
+    address = IPAddress();
+    CHECK(cache.resolve("ws.sinric.pro", address));
+    CHECK(address == IPAddress(203, 0, 113, 10));
+  }
+  CHECK(network.dnsLookups == 1);
+
+  // the ttl has expired
+  HostClock::advance(10000000);
+  network.hosts["ws.sinric.pro"] = IPAddress(203, 0, 113, 11);
+  CHECK(cache.resolve("ws.sinric.pro", address));
+  CHECK(address == IPAddress(203, 0, 113, 11));
+  CHECK(network.dnsLookups == 2);
+
+  // another server
+  CHECK(cache.resolve("backup.sinric.pro", address));
+  CHECK(address == IPAddress(203, 0, 113, 20));
+  CHECK(network.dnsLookups == 3);
+  CHECK(!cache.isValid("ws.sinric.pro"));
+
+  // invalidate() after a failed connection
+  cache.invalidate();
+  CHECK(cache.resolve("backup.sinric.pro", address));
+  CHECK(network.dnsLookups == 4);
+
+  // a failed lookup is not cached
+  network.hosts.erase("backup.sinric.pro");
+  cache.invalidate();
+  CHECK(!cache.resolve("backup.sinric.pro", address));
+  CHECK(!cache.isValid("backup.sinric.pro"));
+  CHECK(!cache.resolve("backup.sinric.pro", address));
+  CHECK(network.dnsLookups == 6);
+
+  return testResult("test_dns_cache");
+}
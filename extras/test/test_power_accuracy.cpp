@@ -0,0 +1,142 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+/*
+ * Accuracy of the energy (trapezoidal integral) and statistics of SampleAggregator, as used by PowerSensor, on
+ * synthetic power waveforms with jittered sample times.
+ */
+
+#include <math.h>
+
+#include <functional>
+#include <random>
+
+#include "../../src/SampleAggregator.h"
+#include "test.h"
+
+using namespace SINRICPRO_NAMESPACE;
+
+typedef std::function<double(double)> Waveform;  // power in W at time t in s
+
+struct Run {
+  SampleSummary total;
+  double        windowIntegral;  // sum of the integrals of all windows
+  double        windowDuration;  // sum of the durations of all windows
+  double        start;           // time of the first sample in s
+  double        end;             // time of the last sample in s
+};
+
+/**
+ * @brief Sample `waveform` every `intervalUs` (+/- `jitterUs`) for `seconds`, starting at micros() = `startUs`
+ *
+ * Next to a single window over the whole run, a second aggregator is reset every `windowSeconds`.
+ */
+static Run sample(const Waveform& waveform, double seconds, uint32_t intervalUs, uint32_t jitterUs, uint32_t startUs = 0, unsigned seed = 42) {
+  const double                           windowSeconds = 10;
+  std::mt19937                           random(seed);
+  std::uniform_int_distribution<int32_t> jitter(-(int32_t)jitterUs, (int32_t)jitterUs);
+
+  SampleAggregator total;
+  SampleAggregator window;
+  Run              run = {};
+  double           windowStart = 0;
+  uint64_t         t = 0;
+  for (;;) {
+    double seconds_ = t / 1000000.0;
+    double power    = waveform(seconds_);
+    total.addSample(power, startUs + (uint32_t)t);
+    window.addSample(power, startUs + (uint32_t)t);
+    run.end = seconds_;
+    if (seconds_ - windowStart >= windowSeconds) {
+      run.windowIntegral += window.getSummary().integral;
+      run.windowDuration += window.getSummary().duration;
+      window.reset();
+      windowStart = seconds_;
+    }
+    if (seconds_ >= seconds) break;
+    t += intervalUs + jitter(random);
+  }
+  run.windowIntegral += window.getSummary().integral;
+  run.windowDuration += window.getSummary().duration;
+  run.total = total.getSummary();
+  return run;
+}
+
+static void report(const char* name, const Run& run, double expected) {
+  printf("%-14s %6u samples, energy %12.3f J, expected %12.3f J, error %+.5f %%\n", name, run.total.count, run.total.integral, expected,
+         (run.total.integral - expected) / expected * 100);
+}
+
+static void testConstant() {
+  Run run = sample([](double) { return 100.0; }, 60, 1000, 0);
+  report("constant", run, 6000);
+  CHECK_NEAR(run.total.integral, 6000, 6000 * 1e-6);
+  CHECK_NEAR(run.total.duration, 60, 1e-6);
+  CHECK_NEAR(run.total.mean, 100, 1e-6);
+  CHECK(run.total.min == 100 && run.total.max == 100);
+}
+
+static void testRamp() {
+  // a linear waveform is integrated exactly by the trapezoidal rule, whatever the sample times are
+  Run    run      = sample([](double t) { return 100.0 * t / 60; }, 60, 100000, 50000);
+  double expected = 100.0 / 60 * run.end * run.end / 2;
+  report("ramp", run, expected);
+  CHECK_NEAR(run.total.integral, expected, expected * 1e-5);
+}
+
+static void testSine() {
+  // resistive load on 50 Hz mains: p(t) = 1000 sin^2(2 pi 50 t), sampled at 2 kHz with +/- 100 us jitter
+  const double omega    = 2 * M_PI * 50;
+  Run          run      = sample([omega](double t) { return 1000 * sin(omega * t) * sin(omega * t); }, 60, 500, 100);
+  double       expected = 500 * run.end - 1000 * sin(2 * omega * run.end) / (4 * omega);
+  report("sine", run, expected);
+  CHECK_NEAR(run.total.integral, expected, expected * 0.005);
+  CHECK_NEAR(run.total.mean, 500, 5);
+  CHECK(run.total.max > 990 && run.total.max <= 1000);
+  CHECK(run.total.min >= 0 && run.total.min < 10);
+
+  // windows: the integral continues from the last sample of the previous window, nothing is lost or counted twice
+  CHECK_NEAR(run.windowIntegral, run.total.integral, run.total.integral * 1e-6);
+  CHECK_NEAR(run.windowDuration, run.total.duration, 1e-4);
+}
+
+static void testSquare() {
+  // a 1000 W load switched on and off every second, sampled at 10 Hz with +/- 20 ms jitter.
+  // Every edge is off by up to 1000 W * interval / 2, the errors of the edges are random and cancel out on average.
+  const int runs       = 20;
+  double    errorSum   = 0;
+  double    worstError = 0;
+  for (unsigned seed = 1; seed <= runs; seed++) {
+    Run    run      = sample([](double t) { return fmod(t, 2) < 1 ? 1000.0 : 0.0; }, 60, 100000, 20000, 0, seed);
+    double expected = 0;
+    for (double t = 0; t < run.end; t += 2) expected += 1000 * min(1.0, run.end - t);
+    double edges = ceil(run.end);
+    CHECK_NEAR(run.total.integral, expected, edges * 1000 * 0.12 / 2);
+    CHECK_NEAR(run.total.mean, 500, 20);
+    errorSum += (run.total.integral - expected) / expected;
+    if (fabs(run.total.integral - expected) / expected > fabs(worstError)) worstError = (run.total.integral - expected) / expected;
+  }
+  printf("%-14s %6d runs, mean error %+.5f %%, worst run %+.5f %%\n", "square", runs, errorSum / runs * 100, worstError * 100);
+  CHECK_NEAR(errorSum / runs, 0, 0.005);
+}
+
+static void testMicrosOverflow() {
+  // micros() wraps after 71.6 minutes, the interval has to be computed across the wrap
+  Run run = sample([](double) { return 100.0; }, 20, 1000, 200, 0xFFFFFFFFu - 10000000u);
+  report("micros wrap", run, 100 * run.end);
+  CHECK_NEAR(run.total.integral, 100 * run.end, 100 * run.end * 1e-6);
+  CHECK_NEAR(run.total.duration, run.end, 1e-6);
+}
+
+int main() {
+  testConstant();
+  testRamp();
+  testSine();
+  testSquare();
+  testMicrosOverflow();
+  return testResult("test_power_accuracy");
+}
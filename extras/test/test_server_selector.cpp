@@ -0,0 +1,68 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+/*
+ * ServerSelector: failover, probe connections on reconnect and preference by connect to first message latency.
+ */
+
+#include "../../src/ServerSelector.h"
+#include "test.h"
+
+using namespace SINRICPRO_NAMESPACE;
+
+static const uint64_t MS = 1000;
+
+int main() {
+  ServerSelector selector;
+  selector.setServers({"a.example", "b.example", "c.example"});
+  size_t preferenceChanges = 0;
+  selector.onPreferenceChanged([&](size_t, const String&) { preferenceChanges++; });
+
+  // start with the preferred server, no probe before SINRICPRO_SERVER_PROBE_INTERVAL
+  CHECK(selector.select() == "a.example");
+  selector.connected(800);
+  HostClock::advance(60000 * MS);
+  CHECK(selector.select() == "a.example");
+  CHECK(selector.getLastSelection().reason == ServerSelectionReason::preferred);
+  selector.connected(800);
+
+  // the first reconnect after the interval measures the next server, a slower one does not become preferred
+  HostClock::advance((uint64_t)SINRICPRO_SERVER_PROBE_INTERVAL * MS);
+  CHECK(selector.select() == "b.example");
+  CHECK(selector.getLastSelection().reason == ServerSelectionReason::probe);
+  selector.connected(1500);
+  CHECK(selector.getPreferred() == 0);
+  CHECK(selector.select() == "a.example");
+  selector.connected(800);
+
+  // a faster one becomes the preferred server
+  HostClock::advance((uint64_t)SINRICPRO_SERVER_PROBE_INTERVAL * MS);
+  CHECK(selector.select() == "c.example");
+  selector.connected(300);
+  CHECK(selector.getPreferred() == 2);
+  CHECK(preferenceChanges == 1);
+  CHECK(selector.select() == "c.example");
+
+  // an unreachable probe costs one attempt, the next attempt uses the preferred server again
+  HostClock::advance((uint64_t)SINRICPRO_SERVER_PROBE_INTERVAL * MS);
+  CHECK(selector.select() == "a.example");
+  CHECK(selector.getLastSelection().reason == ServerSelectionReason::probe);
+  selector.failed();
+  CHECK(selector.select() == "c.example");
+  CHECK(selector.getStats()[0].probes == 1 && selector.getStats()[1].probes == 1);
+
+  // failover after SINRICPRO_SERVER_MAX_FAILURES failed attempts, no probe while the preferred server is unhealthy
+  for (int i = 0; i < SINRICPRO_SERVER_MAX_FAILURES; i++) {
+    CHECK(selector.select() == "c.example");
+    selector.failed();
+  }
+  HostClock::advance((uint64_t)SINRICPRO_SERVER_PROBE_INTERVAL * MS / 2);
+  CHECK(selector.select() != "c.example");
+  CHECK(selector.getLastSelection().reason == ServerSelectionReason::failover);
+
+  return testResult("test_server_selector");
+}
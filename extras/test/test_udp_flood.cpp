@@ -0,0 +1,159 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+/*
+ * UDP flood generator: floods the multicast port while a legitimate client keeps sending one request every 500 ms,
+ * then reports what the admission control did, how much memory the receive queue held and how many requests of the
+ * legitimate client were answered.
+ *
+ *   test_udp_flood                                  run the built-in scenarios and check the limits
+ *   test_udp_flood <rate> <seconds> <size> <sources>  run a single flood (datagrams/s, duration, bytes, source addresses)
+ */
+
+#include <string>
+
+#include "../../src/SinricProUDP.h"
+#include "test.h"
+
+using namespace SINRICPRO_NAMESPACE;
+
+static const uint32_t TICK_US           = 100;     // the sketch calls SinricPro.handle() every 100 us
+static const uint32_t SERVE_INTERVAL_US = 20000;   // handling a request (JSON, HMAC, callback) takes the module 20 ms
+static const uint32_t LEGIT_INTERVAL_US = 500000;  // the app sends a request every 500 ms
+static const IPAddress LEGIT_IP(192, 168, 1, 10);
+
+struct Flood {
+  const char* name;
+  uint32_t    rate;     // datagrams per second
+  uint32_t    seconds;
+  size_t      size;     // bytes per datagram
+  uint32_t    sources;  // the attacker rotates through this many source addresses
+};
+
+struct FloodResult {
+  uint32_t generated     = 0;
+  uint32_t legitSent     = 0;
+  uint32_t legitAnswered = 0;
+  size_t   maxQueued     = 0;
+  size_t   maxQueuedBytes = 0;
+  UdpStats stats         = {};
+  size_t   networkDrops  = 0;
+};
+
+static FloodResult run(const Flood& flood) {
+  HostNetwork::reset();
+  UdpListener      listener;
+  SinricProQueue_t receiveQueue;
+  listener.begin(&receiveQueue);
+
+  FloodResult result;
+  std::string payload(flood.size, 'x');
+  size_t      queuedBytes = 0;
+  uint64_t    duration    = (uint64_t)flood.seconds * 1000000;
+  uint64_t    floodCredit = 0;  // datagrams * 1000000
+  uint64_t    nextLegit   = 0;
+  uint64_t    nextServe   = SERVE_INTERVAL_US;
+
+  for (uint64_t t = 0; t < duration; t += TICK_US) {
+    floodCredit += (uint64_t)flood.rate * TICK_US;
+    while (floodCredit >= 1000000) {
+      floodCredit -= 1000000;
+      IPAddress source(10, 66, (result.generated % flood.sources) / 250, (result.generated % flood.sources) % 250 + 1);
+      HostNetwork::sendMulticast(source, 6666, payload);
+      result.generated++;
+    }
+    if (t >= nextLegit) {
+      nextLegit += LEGIT_INTERVAL_US;
+      HostNetwork::sendMulticast(LEGIT_IP, 5000, "{\"legit\":" + std::to_string(result.legitSent++) + "}");
+    }
+
+    size_t before = receiveQueue.size();
+    listener.handle();
+    if (receiveQueue.size() > before) queuedBytes += strlen(receiveQueue.back()->getMessage());
+    result.maxQueued      = max(result.maxQueued, receiveQueue.size());
+    result.maxQueuedBytes = max(result.maxQueuedBytes, queuedBytes);
+
+    if (t >= nextServe && !receiveQueue.empty()) {
+      nextServe = t + SERVE_INTERVAL_US;
+      SinricProMessage* message = receiveQueue.front();
+      receiveQueue.pop();
+      listener.released();
+      queuedBytes -= strlen(message->getMessage());
+      String response("ok");
+      listener.sendMessage(response, message->getRoute().remoteIP, message->getRoute().remotePort);
+      delete message;
+    }
+    HostClock::advance(TICK_US);
+  }
+
+  for (auto& datagram : HostNetwork::state().sent) {
+    if (datagram.ip == LEGIT_IP) result.legitAnswered++;
+  }
+  while (!receiveQueue.empty()) {
+    delete receiveQueue.front();
+    receiveQueue.pop();
+  }
+  result.stats        = listener.getStats();
+  result.networkDrops = HostNetwork::state().multicastDrops;
+  listener.stop();
+  return result;
+}
+
+static void report(const Flood& flood, const FloodResult& result) {
+  printf("%-16s %6u dgram/s %4zu bytes %4u sources: generated %7u, accepted %5u, oversized %7u, rate limited %7u, queue full %7u, network drops %6zu\n",
+         flood.name, flood.rate, flood.size, flood.sources, result.generated, result.stats.accepted, result.stats.oversized, result.stats.rateLimited,
+         result.stats.queueFull, result.networkDrops);
+  printf("%-16s max queued %zu messages / %zu bytes, legitimate client answered %u of %u\n", "", result.maxQueued, result.maxQueuedBytes, result.legitAnswered,
+         result.legitSent);
+}
+
+static void checkBounded(const FloodResult& result) {
+  CHECK(result.maxQueued <= SINRICPRO_UDP_QUEUE_SHARE);
+  CHECK(result.maxQueuedBytes <= (size_t)SINRICPRO_UDP_QUEUE_SHARE * SINRICPRO_UDP_MAX_SIZE);
+}
+
+int main(int argc, char** argv) {
+  if (argc == 5) {
+    Flood flood{"custom", (uint32_t)atoi(argv[1]), (uint32_t)atoi(argv[2]), (size_t)atoi(argv[3]), (uint32_t)max(1, atoi(argv[4]))};
+    FloodResult result = run(flood);
+    report(flood, result);
+    checkBounded(result);
+    return testResult("test_udp_flood");
+  }
+
+  // one source: the rate limit lets through the burst plus SINRICPRO_UDP_RATE per second, the app is not affected
+  Flood       single{"single source", 2000, 10, 200, 1};
+  FloodResult result = run(single);
+  report(single, result);
+  checkBounded(result);
+  CHECK(result.stats.accepted - result.legitSent <= SINRICPRO_UDP_BURST + SINRICPRO_UDP_RATE * single.seconds);
+  CHECK(result.legitAnswered == result.legitSent);
+
+  // oversized datagrams are rejected before anything is allocated
+  Flood oversized{"oversized", 2000, 10, SINRICPRO_UDP_MAX_SIZE + 1, 1};
+  result = run(oversized);
+  report(oversized, result);
+  checkBounded(result);
+  CHECK(result.stats.accepted == result.legitSent);
+  CHECK(result.stats.oversized == result.generated - result.networkDrops);
+  CHECK(result.legitAnswered == result.legitSent);
+
+  // rotating / spoofed sources: new addresses share one bucket and start with an empty bucket of their own, so the flood
+  // gets no more than the shared bucket and the buckets of the tracked sources; the app has been admitted before and
+  // keeps its bucket and its part of the queue share
+  Flood rotating{"rotating sources", 2000, 10, 200, SINRICPRO_UDP_SOURCES + 1};
+  Flood spoofed{"spoofed sources", 2000, 10, 200, 1000};
+  for (auto& flood : {rotating, spoofed}) {
+    result = run(flood);
+    report(flood, result);
+    checkBounded(result);
+    CHECK(result.stats.accepted - result.legitSent <= SINRICPRO_UDP_BURST + (SINRICPRO_UDP_SOURCES + 1) * SINRICPRO_UDP_RATE * flood.seconds);
+    CHECK(result.legitAnswered + 1 >= result.legitSent);
+  }
+
+  return testResult("test_udp_flood");
+}
@@ -0,0 +1,149 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+/*
+ * Several udp clients send requests at the same time: every response has to go back to the client which sent the
+ * request, and the multicast socket has to stay joined while responses are sent.
+ */
+
+#include "../../src/SinricProUDP.h"
+#include "test.h"
+
+using namespace SINRICPRO_NAMESPACE;
+
+static IPAddress clientIP(int client) { return IPAddress(10, 0, client / 250, client % 250 + 1); }
+static uint16_t  clientPort(int client) { return 40000 + client; }
+static std::string request(int client, int number) { return "request " + std::to_string(client) + "/" + std::to_string(number); }
+
+/**
+ * @brief Answer all queued requests like SinricProClass::handleReceiveQueue() does
+ */
+static size_t serve(UdpListener& listener, SinricProQueue_t& receiveQueue) {
+  size_t served = 0;
+  while (!receiveQueue.empty()) {
+    SinricProMessage* message = receiveQueue.front();
+    receiveQueue.pop();
+    listener.released();
+    String response = String("response to ") + message->getMessage();
+    listener.sendMessage(response, message->getRoute().remoteIP, message->getRoute().remotePort);
+    delete message;
+    served++;
+  }
+  return served;
+}
+
+/**
+ * @brief Every client sends a first request on its own, afterwards the clients are known sources with a bucket of their own
+ */
+static void introduce(UdpListener& listener, SinricProQueue_t& receiveQueue, int clients) {
+  for (int client = 0; client < clients; client++) {
+    HostNetwork::sendMulticast(clientIP(client), clientPort(client), "hello");
+    listener.handle();
+    serve(listener, receiveQueue);
+  }
+  HostNetwork::state().sent.clear();
+  HostClock::advance(1000000);
+}
+
+static void testConcurrentClients() {
+  HostNetwork::reset();
+  UdpListener      listener;
+  SinricProQueue_t receiveQueue;
+  listener.begin(&receiveQueue);
+
+  const int clients = SINRICPRO_UDP_SOURCES;
+  introduce(listener, receiveQueue, clients);
+  for (int client = 0; client < clients; client++) HostNetwork::sendMulticast(clientIP(client), clientPort(client), request(client, 0));
+
+  // receive up to SINRICPRO_UDP_QUEUE_SHARE requests before the first one is answered
+  while (!HostNetwork::state().multicast.empty()) {
+    for (int i = 0; i < SINRICPRO_UDP_QUEUE_SHARE; i++) listener.handle();
+    serve(listener, receiveQueue);
+  }
+
+  auto& sent = HostNetwork::state().sent;
+  CHECK(sent.size() == (size_t)clients);
+  for (size_t i = 0; i < sent.size(); i++) {
+    CHECK(sent[i].ip == clientIP(i));
+    CHECK(sent[i].port == clientPort(i));
+    CHECK(sent[i].data == "response to " + request(i, 0));
+  }
+  CHECK(HostNetwork::state().multicastJoins == 1);
+  CHECK(HostNetwork::state().multicastOpen);
+  CHECK(listener.getStats().accepted == (uint32_t)clients * 2);
+  listener.stop();
+  CHECK(!HostNetwork::state().multicastOpen);
+}
+
+static void testSameAddressDifferentPorts() {
+  HostNetwork::reset();
+  UdpListener      listener;
+  SinricProQueue_t receiveQueue;
+  listener.begin(&receiveQueue);
+
+  IPAddress phone = clientIP(6);
+  introduce(listener, receiveQueue, 7);
+  HostNetwork::sendMulticast(phone, 5000, "app one");
+  HostNetwork::sendMulticast(phone, 5001, "app two");
+  listener.handle();
+  listener.handle();
+  serve(listener, receiveQueue);
+
+  auto& sent = HostNetwork::state().sent;
+  CHECK(sent.size() == 2);
+  if (sent.size() == 2) {
+    CHECK(sent[0].port == 5000 && sent[0].data == "response to app one");
+    CHECK(sent[1].port == 5001 && sent[1].data == "response to app two");
+  }
+  listener.stop();
+}
+
+static void testThroughput() {
+  HostNetwork::reset();
+  UdpListener      listener;
+  SinricProQueue_t receiveQueue;
+  listener.begin(&receiveQueue);
+
+  const int clients = SINRICPRO_UDP_SOURCES;
+  const int rounds  = 4000;
+  size_t    misrouted = 0;
+  size_t    served    = 0;
+  introduce(listener, receiveQueue, clients);
+
+  double start = wallMicros();
+  for (int round = 0; round < rounds; round++) {
+    for (int client = 0; client < clients; client++) {
+      HostNetwork::sendMulticast(clientIP(client), clientPort(client), request(client, round));
+      listener.handle();
+      if (receiveQueue.size() == SINRICPRO_UDP_QUEUE_SHARE) served += serve(listener, receiveQueue);
+    }
+    served += serve(listener, receiveQueue);
+    HostClock::advance(250000);  // every client sends 4 requests per second (below SINRICPRO_UDP_RATE)
+
+    auto& sent = HostNetwork::state().sent;
+    for (size_t i = 0; i < sent.size(); i++) {
+      if (!(sent[i].ip == clientIP(i)) || sent[i].port != clientPort(i) || sent[i].data != "response to " + request(i, round)) misrouted++;
+    }
+    sent.clear();
+  }
+  double elapsed = wallMicros() - start;
+
+  CHECK(served == (size_t)clients * rounds);
+  CHECK(misrouted == 0);
+  CHECK(listener.getStats().rateLimited == 0);
+  CHECK(listener.getStats().queueFull == 0);
+  CHECK(HostNetwork::state().multicastDrops == 0);
+  printf("routing: %zu requests from %d clients in %.1f ms (%.0f requests/s), %zu misrouted\n", served, clients, elapsed / 1000, served / (elapsed / 1000000), misrouted);
+  listener.stop();
+}
+
+int main() {
+  testConcurrentClients();
+  testSameAddressDifferentPorts();
+  testThroughput();
+  return testResult("test_udp_routing");
+}
@@ -0,0 +1,360 @@
+#!/usr/bin/env python3
+#
+#  Copyright (c) 2019 Sinric. All rights reserved.
+#  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+#
+#  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+#
+"""Local TLS websocket stand-in for the SinricPro server.
+
+Accepts the device connection like ws.sinric.pro does: TLS 1.2 with a self-signed certificate (the SDK does not
+verify the server), websocket upgrade on "/", then the {"timestamp":..} message. For every connection it prints
+whether the TLS session was resumed, the handshake time and the appkey / deviceids headers. Messages of the device
+are printed as they arrive. With --drop-after the connection is closed after some seconds to make the device
+reconnect; the device reports its reconnect latency with getConnectionLatency() (dns / connect / first message).
+
+With --expect-snapshot the messages of the first seconds after connect are recorded and checked for the state
+snapshot of a device built with -DSINRICPRO_STATE_SHADOW: exactly one "stateSnapshot" event with the states of the
+devices, signed with --app-secret, and no per-device events resending the states. The stand-in exits after the
+check of the first connection with 0 (passed) or 1 (failed).
+
+    python3 tls_standin.py --port 8443 --drop-after 30
+    python3 tls_standin.py --port 8443 --expect-snapshot 5 --app-secret <APP_SECRET>
+    python3 tls_standin.py --selftest
+
+Point the sketch to the stand-in with SinricPro.begin(APP_KEY, APP_SECRET, "<address of this computer>") and build
+it with -DSINRICPRO_SERVER_SSL_PORT=8443.
+"""
+
+import argparse
+import base64
+import hashlib
+import hmac
+import json
+import os
+import socket
+import ssl
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+WEBSOCKET_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+
+def make_certificate(directory):
+    """Create a self-signed certificate with the openssl command line tool."""
+    cert = os.path.join(directory, "standin.crt")
+    key = os.path.join(directory, "standin.key")
+    subprocess.run(["openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "1", "-subj", "/CN=sinricpro-standin",
+                    "-keyout", key, "-out", cert], check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    return cert, key
+
+
+def server_context(cert, key):
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.maximum_version = ssl.TLSVersion.TLSv1_2  # like BearSSL; session ids and tickets are both enabled
+    context.load_cert_chain(cert, key)
+    return context
+
+
+def read_exactly(sock, length):
+    data = b""
+    while len(data) < length:
+        chunk = sock.recv(length - len(data))
+        if not chunk:
+            raise ConnectionError("connection closed")
+        data += chunk
+    return data
+
+
+def read_frame(sock):
+    """Read one websocket frame, returns (opcode, payload)."""
+    first, second = read_exactly(sock, 2)
+    length = second & 0x7F
+    if length == 126:
+        length = struct.unpack(">H", read_exactly(sock, 2))[0]
+    elif length == 127:
+        length = struct.unpack(">Q", read_exactly(sock, 8))[0]
+    mask = read_exactly(sock, 4) if second & 0x80 else None
+    payload = read_exactly(sock, length)
+    if mask:
+        payload = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+    return first & 0x0F, payload
+
+
+def write_frame(sock, opcode, payload, masked=False):
+    header = bytes([0x80 | opcode])
+    mask_bit = 0x80 if masked else 0
+    if len(payload) < 126:
+        header += bytes([mask_bit | len(payload)])
+    elif len(payload) < 65536:
+        header += bytes([mask_bit | 126]) + struct.pack(">H", len(payload))
+    else:
+        header += bytes([mask_bit | 127]) + struct.pack(">Q", len(payload))
+    if masked:
+        mask = os.urandom(4)
+        header += mask
+        payload = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+    sock.sendall(header + payload)
+
+
+def read_http_header(sock):
+    data = b""
+    while b"\r\n\r\n" not in data:
+        chunk = sock.recv(1024)
+        if not chunk:
+            raise ConnectionError("connection closed during upgrade")
+        data += chunk
+    lines = data.split(b"\r\n\r\n", 1)[0].decode(errors="replace").split("\r\n")
+    headers = {}
+    for line in lines[1:]:
+        name, _, value = line.partition(":")
+        headers[name.strip().lower()] = value.strip()
+    return lines[0], headers
+
+
+def extract_payload(message):
+    """The signed part of a message, like extractPayload() in SinricProSignature.cpp."""
+    begin = message.find('"payload":')
+    end = message.find(',"signature"', begin)
+    return message[begin + 10:end] if begin > 0 and end > 0 else ""
+
+
+def signature(payload, app_secret):
+    return base64.b64encode(hmac.new(app_secret.encode(), payload.encode(), hashlib.sha256).digest()).decode()
+
+
+def check_snapshot(frames, app_secret):
+    """Check the messages a device sent after connect for one signed state snapshot, returns a list of problems."""
+    problems = []
+    snapshots = []
+    device_events = []
+    for frame in frames:
+        try:
+            message = json.loads(frame)
+        except ValueError:
+            problems.append(f"not json: {frame[:60]}")
+            continue
+        payload = message.get("payload", {})
+        if payload.get("type") != "event":
+            continue
+        if payload.get("action") == "stateSnapshot":
+            snapshots.append((frame, message))
+        elif payload.get("deviceId"):
+            device_events.append(f"{payload.get('deviceId')}/{payload.get('action')}")
+
+    if len(snapshots) != 1:
+        problems.append(f"{len(snapshots)} stateSnapshot events, expected 1")
+    for frame, message in snapshots:
+        payload = message["payload"]
+        devices = payload.get("value", {}).get("devices", {})
+        if not isinstance(devices, dict) or not devices:
+            problems.append("stateSnapshot without device states")
+        if payload.get("scope") != "module":
+            problems.append(f"stateSnapshot scope {payload.get('scope')!r}, expected 'module'")
+        if app_secret and message.get("signature", {}).get("HMAC") != signature(extract_payload(frame), app_secret):
+            problems.append("stateSnapshot signature does not match --app-secret")
+    if device_events:
+        problems.append(f"{len(device_events)} per-device events after connect: {', '.join(device_events[:5])}")
+    return problems
+
+
+def handle_connection(raw, peer, context, args, log, checked=None):
+    accepted_at = time.monotonic()
+    raw.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    try:
+        sock = context.wrap_socket(raw, server_side=True)
+    except (ssl.SSLError, OSError) as error:
+        log(f"{peer[0]}: tls handshake failed: {error}")
+        raw.close()
+        return
+    handshake_ms = (time.monotonic() - accepted_at) * 1000
+    try:
+        request, headers = read_http_header(sock)
+        accept = base64.b64encode(hashlib.sha1((headers.get("sec-websocket-key", "") + WEBSOCKET_GUID).encode()).digest()).decode()
+        sock.sendall(("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                      f"Sec-WebSocket-Accept: {accept}\r\n\r\n").encode())
+        if args.first_message_delay:
+            time.sleep(args.first_message_delay / 1000)
+        write_frame(sock, 0x1, json.dumps({"timestamp": int(time.time())}, separators=(",", ":")).encode())
+        log(f"{peer[0]}: {sock.version()} session {'resumed' if sock.session_reused else 'new'}, handshake {handshake_ms:.0f} ms, "
+            f"upgrade after {(time.monotonic() - accepted_at) * 1000:.0f} ms, \"{request}\" "
+            f"appkey {headers.get('appkey', '-')}, deviceids {headers.get('deviceids', '-')}")
+
+        frames = [] if args.expect_snapshot else None
+        while True:
+            deadlines = [args.drop_after] if args.drop_after else []
+            if frames is not None:
+                deadlines.append(args.expect_snapshot)
+            sock.settimeout(max(0.01, min(deadlines) - (time.monotonic() - accepted_at)) if deadlines else None)
+            try:
+                opcode, payload = read_frame(sock)
+            except socket.timeout:
+                if frames is not None and time.monotonic() - accepted_at >= args.expect_snapshot:
+                    problems = check_snapshot(frames, args.app_secret)
+                    log(f"{peer[0]}: snapshot check {'passed' if not problems else 'failed: ' + '; '.join(problems)}")
+                    if checked:
+                        checked(problems)
+                    frames = None
+                    continue
+                log(f"{peer[0]}: dropping the connection after {args.drop_after} s")
+                break
+            if opcode == 0x8:
+                write_frame(sock, 0x8, payload[:2])
+                break
+            if opcode == 0x9:
+                write_frame(sock, 0xA, payload)
+            elif opcode == 0x1:
+                text = payload.decode(errors="replace")
+                log(f"{peer[0]}: {text}")
+                if frames is not None:
+                    frames.append(text)
+    except (ConnectionError, OSError) as error:
+        log(f"{peer[0]}: {error}")
+    finally:
+        sock.close()
+
+
+def serve(listener, context, args, log, checked=None):
+    while True:
+        try:
+            raw, peer = listener.accept()
+        except OSError:
+            return
+        threading.Thread(target=handle_connection, args=(raw, peer, context, args, log, checked), daemon=True).start()
+
+
+def connect(port, client_context, session=None):
+    """Open a websocket connection like the SDK, returns (socket, upgrade ok, first message)."""
+    raw = socket.create_connection(("127.0.0.1", port))
+    raw.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    sock = client_context.wrap_socket(raw, server_hostname="localhost", session=session)
+    key = base64.b64encode(os.urandom(16)).decode()
+    sock.sendall((f"GET / HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: {key}\r\n"
+                  "Sec-WebSocket-Version: 13\r\nappkey:selftest\r\ndeviceids:device1;device2\r\n\r\n").encode())
+    status, headers = read_http_header(sock)
+    opcode, payload = read_frame(sock)
+    expected_accept = base64.b64encode(hashlib.sha1((key + WEBSOCKET_GUID).encode()).digest()).decode()
+    ok = status.startswith("HTTP/1.1 101") and headers.get("sec-websocket-accept") == expected_accept and opcode == 0x1
+    return sock, ok, json.loads(payload)
+
+
+def event(device_id, action, value, app_secret, scope=None):
+    """A signed event serialized like ArduinoJson does (no whitespace, signature after the payload)."""
+    payload = {"action": action, "cause": {"type": "PHYSICAL_INTERACTION"}, "createdAt": 0, "deviceId": device_id,
+               "replyToken": base64.b16encode(os.urandom(8)).decode(), "type": "event", "value": value}
+    if scope:
+        del payload["deviceId"]
+        payload["scope"] = scope
+    payload_json = json.dumps(payload, separators=(",", ":"))
+    return (f'{{"header":{{"payloadVersion":2,"signatureVersion":1}},"payload":{payload_json},'
+            f'"signature":{{"HMAC":"{signature(payload_json, app_secret)}"}}}}')
+
+
+def selftest(context, args):
+    """Connect three times like the SDK does and check session resumption and the first message, then check the
+    snapshot check with a device sending one signed snapshot, a device resending every state and a wrong signature."""
+    listener = socket.create_server(("127.0.0.1", 0))
+    port = listener.getsockname()[1]
+    threading.Thread(target=serve, args=(listener, context, args, lambda line: None), daemon=True).start()
+
+    client_context = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+    client_context.check_hostname = False
+    client_context.verify_mode = ssl.CERT_NONE  # setInsecure()
+
+    session = None
+    results = []
+    for attempt in range(3):
+        started = time.monotonic()
+        sock, ok, message = connect(port, client_context, session)
+        first_message_ms = (time.monotonic() - started) * 1000
+        ok = ok and "timestamp" in message
+        results.append((sock.session_reused, first_message_ms))
+        print(f"connection {attempt + 1}: session {'resumed' if sock.session_reused else 'new'}, first message after {first_message_ms:.1f} ms"
+              f"{'' if ok else ' -- unexpected upgrade or first message'}")
+        if not ok:
+            return 1
+        session = sock.session
+        write_frame(sock, 0x8, b"\x03\xe8", masked=True)
+        sock.close()
+    listener.close()
+
+    resumed = [reused for reused, _ in results]
+    if resumed != [False, True, True]:
+        print(f"selftest failed: session resumed {resumed}, expected [False, True, True]")
+        return 1
+
+    secret = "selftest-secret"
+    states = {"device1": {"powerState": "On"}, "device2": {"powerState": "Off", "rangeValue": 3}}
+    snapshot = event("", "stateSnapshot", {"devices": states}, secret, scope="module")
+    flood = [event(device, "setPowerState", {"state": state["powerState"]}, secret) for device, state in states.items()]
+    cases = [
+        ("one signed snapshot", [snapshot], True),
+        ("per-device events", flood, False),
+        ("snapshot and per-device events", [snapshot] + flood, False),
+        ("wrong signature", [snapshot.replace('"HMAC":"', '"HMAC":"x')], False),
+    ]
+    check_args = argparse.Namespace(**vars(args))
+    check_args.expect_snapshot, check_args.app_secret, check_args.drop_after = 0.3, secret, 0
+    for name, frames, expected in cases:
+        checks = []
+        listener = socket.create_server(("127.0.0.1", 0))
+        threading.Thread(target=serve, args=(listener, context, check_args, lambda line: None, checks.append), daemon=True).start()
+        sock, ok, _ = connect(listener.getsockname()[1], client_context)
+        for frame in frames:
+            write_frame(sock, 0x1, frame.encode(), masked=True)
+        deadline = time.monotonic() + 5
+        while not checks and time.monotonic() < deadline:
+            time.sleep(0.01)
+        write_frame(sock, 0x8, b"\x03\xe8", masked=True)
+        sock.close()
+        listener.close()
+        passed = bool(checks) and not checks[0]
+        problems = "; ".join(checks[0]) if checks else "no check within 5 s"
+        print(f"snapshot check, {name}: {'passed' if passed else 'failed: ' + problems}")
+        if not ok or not checks or passed != expected:
+            print(f"selftest failed: snapshot check of '{name}' should have {'passed' if expected else 'failed'}")
+            return 1
+    print("selftest passed")
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", type=int, default=8443)
+    parser.add_argument("--cert", help="certificate (a self-signed one is created if omitted)")
+    parser.add_argument("--key", help="private key of --cert")
+    parser.add_argument("--drop-after", type=float, default=0, help="close every connection after this many seconds")
+    parser.add_argument("--first-message-delay", type=float, default=0, help="ms to wait before the timestamp message")
+    parser.add_argument("--expect-snapshot", type=float, default=0, metavar="SECONDS",
+                        help="check the messages of the first seconds after connect for one state snapshot, then exit")
+    parser.add_argument("--app-secret", help="check the signature of the state snapshot")
+    parser.add_argument("--selftest", action="store_true", help="check the stand-in with a local client and exit")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as directory:
+        cert, key = (args.cert, args.key) if args.cert else make_certificate(directory)
+        context = server_context(cert, key)
+        if args.selftest:
+            return selftest(context, args)
+
+        listener = socket.create_server(("", args.port))
+        print(f"SinricPro stand-in listening on port {args.port}")
+        checks = []
+        checked = None
+        if args.expect_snapshot:
+            def checked(problems):
+                checks.append(problems)
+                listener.shutdown(socket.SHUT_RDWR)  # wakes up accept()
+        try:
+            serve(listener, context, args, lambda line: print(time.strftime("%H:%M:%S"), line, flush=True), checked)
+        except KeyboardInterrupt:
+            pass
+    return 1 if checks and checks[0] else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+#
+#  Copyright (c) 2019 Sinric. All rights reserved.
+#  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+#
+#  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+#
+"""Render the SinricPro message trace (SINRICPRO_TRACE) as a table of per-stage latencies.
+
+Every stage column shows the time since the previous stage that was reached, "total" the time from
+receiving the message until the last stage that was reached.
+
+Input is either a serial log containing the line printed by SinricPro.dumpTrace(Serial)
+or a health report containing "sdkTrace".
+
+usage: trace_decode.py [file]   (reads stdin if no file is given)
+"""
+
+import json
+import sys
+
+STAGES = ["dequeued", "verified", "dispatched", "callback", "queued", "sent"]  # relative to "received"
+INTERFACES = {0: "?", 1: "ws", 2: "udp", 3: "localws"}
+OUTCOMES = ["pending", "success", "failed", "invalidSig", "response", "dropped", "duplicate"]
+NO_DEVICE = 0xFF
+
+
+def find_trace(text):
+    """Return the last "sdkTrace" object found in text."""
+    trace = None
+    for line in text.splitlines():
+        start = line.find("{")
+        if start < 0 or "sdkTrace" not in line:
+            continue
+        try:
+            doc = json.loads(line[start:])
+        except ValueError:
+            continue
+        if "report" in doc and isinstance(doc["report"], str) and "sdkTrace" in doc["report"]:
+            doc = json.loads(doc["report"])
+        trace = doc.get("sdkTrace", trace)
+    return trace
+
+
+def format_us(value):
+    if not value:
+        return "-"
+    if value >= 1000:
+        return "%.1fms" % (value / 1000.0)
+    return "%dus" % value
+
+
+def main():
+    text = open(sys.argv[1]).read() if len(sys.argv) > 1 else sys.stdin.read()
+    trace = find_trace(text)
+    if trace is None:
+        sys.exit("no sdkTrace found")
+
+    actions = trace.get("actions", [])
+    header = ["id", "millis", "replyToken", "device", "action", "if", "outcome"] + STAGES + ["total"]
+    rows = [header]
+    for entry in trace.get("entries", []):
+        trace_id, received_at, token, device, action, interface, outcome = entry[:7]
+        stages = entry[7:]
+        latencies = []
+        previous = 0
+        for stage in stages:
+            latencies.append(stage - previous if stage else 0)
+            previous = stage or previous
+        rows.append([
+            str(trace_id),
+            str(received_at),
+            token or "-",
+            "-" if device == NO_DEVICE else str(device),
+            actions[action] if action < len(actions) else "-",
+            INTERFACES.get(interface, str(interface)),
+            OUTCOMES[outcome] if outcome < len(OUTCOMES) else str(outcome),
+        ] + [format_us(latency) for latency in latencies] + [format_us(previous)])
+
+    widths = [max(len(row[i]) for row in rows) for i in range(len(header))]
+    for row in rows:
+        print("  ".join(cell.ljust(width) for cell, width in zip(row, widths)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,252 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <limits.h>
+#include <vector>
+
+#include "SinricProConfig.h"
+#include "SinricProDebug.h"
+#include "SinricProNamespace.h"
+#include "PrioritySendQueue.h"
+namespace SINRICPRO_NAMESPACE {
+
+/**
+ * @brief Acknowledge statistics for a single action
+ */
+struct AckStats {
+    String   action;         ///< event action (eg. "setPowerState", "other" for the actions beyond `SINRICPRO_ACK_STATS_SIZE` - 1)
+    uint32_t acknowledged;   ///< number of acknowledged events
+    uint32_t timeouts;       ///< number of events that were not acknowledged in time
+    uint32_t retransmits;    ///< number of retransmitted events
+    uint32_t lastLatency;    ///< latency of the last acknowledge in ms
+    uint32_t maxLatency;     ///< highest latency in ms
+    uint32_t totalLatency;   ///< sum of all latencies in ms (totalLatency / acknowledged = average)
+};
+
+/**
+ * @brief Keeps track of sent events until the server acknowledges them
+ *
+ * Events are identified by their replyToken. Events which are not acknowledged within `SINRICPRO_ACK_TIMEOUT`
+ * are sent again (up to `SINRICPRO_ACK_MAX_RETRANSMITS` times) if they are state events.
+ * Periodic events (cause "PERIODIC_POLL") are only tracked, not sent again.
+ * After `SINRICPRO_ACK_MAX_MISSES` timeouts in a row (at most one per handle() call) the connection is considered dead.
+ * An event acknowledged while its retransmission waits in the sendQueue stays in the table until the queued copy is
+ * discarded (see isAcknowledged() / discarded()).
+ */
+class AckTracker {
+  public:
+    AckTracker();
+
+    void sent(const String& replyToken, const String& action, const char* message, bool retransmit);
+    bool acknowledged(const String& replyToken);
+    bool isAcknowledged(const String& replyToken);
+    void discarded(const String& replyToken);
+    bool handle(PrioritySendQueue& sendQueue);
+    void requeue(PrioritySendQueue& sendQueue);
+
+    unsigned long                nextTimeoutIn() const;
+    const std::vector<AckStats>& getStats() const;
+
+  protected:
+    struct InFlightEvent {
+        String        replyToken;
+        String        action;
+        String        message;
+        unsigned long sentAt;
+        uint8_t       retransmits;
+        bool          used;
+        bool          pending;       // waiting in sendQueue for retransmission
+        bool          acknowledged;  // acknowledged while pending, the queued copy is obsolete
+    };
+
+    InFlightEvent* find(const String& replyToken);
+    AckStats&      statsFor(const String& action);
+
+    InFlightEvent         inFlight[SINRICPRO_ACK_TABLE_SIZE];
+    std::vector<AckStats> stats;
+    uint8_t               misses;
+};
+
+AckTracker::AckTracker()
+    : inFlight()
+    , misses(0) {}
+
+/**
+ * @brief Register an event that has been sent to the server
+ *
+ * @param replyToken  replyToken of the event
+ * @param action      action of the event
+ * @param message     the unsigned message (used for retransmission)
+ * @param retransmit  `true` if the event should be sent again when it is not acknowledged
+ */
+void AckTracker::sent(const String& replyToken, const String& action, const char* message, bool retransmit) {
+    InFlightEvent* event = find(replyToken);
+    if (event) {  // retransmission
+        event->sentAt  = millis();
+        event->pending = false;
+        return;
+    }
+
+    InFlightEvent* oldest = &inFlight[0];
+    for (auto& entry : inFlight) {
+        if (!entry.used) {
+            event = &entry;
+            break;
+        }
+        if ((long)(entry.sentAt - oldest->sentAt) < 0) oldest = &entry;
+    }
+    if (!event) {
+        DEBUG_SINRIC("[SinricPro:AckTracker]: table full, no longer tracking \"%s\"\r\n", oldest->replyToken.c_str());
+        event = oldest;
+    }
+
+    event->used         = true;
+    event->pending      = false;
+    event->acknowledged = false;
+    event->replyToken  = replyToken;
+    event->action      = action;
+    event->message     = retransmit ? message : "";
+    event->sentAt      = millis();
+    event->retransmits = 0;
+}
+
+/**
+ * @brief Match a response from the server against the sent events
+ *
+ * @param replyToken replyToken of the response
+ * @return `true` if the response belongs to a tracked event
+ */
+bool AckTracker::acknowledged(const String& replyToken) {
+    InFlightEvent* event = find(replyToken);
+    if (!event || event->acknowledged) return false;
+
+    uint32_t  latency = millis() - event->sentAt;
+    AckStats& entry   = statsFor(event->action);
+    entry.acknowledged++;
+    entry.lastLatency = latency;
+    entry.totalLatency += latency;
+    if (latency > entry.maxLatency) entry.maxLatency = latency;
+    DEBUG_SINRIC("[SinricPro:AckTracker]: \"%s\" acknowledged after %lu ms\r\n", event->action.c_str(), (unsigned long)latency);
+
+    event->used         = event->pending;  // keep the entry until the queued retransmission is discarded
+    event->acknowledged = true;
+    event->message      = "";
+    misses              = 0;
+    return true;
+}
+
+/**
+ * @brief `true` if the event has already been acknowledged (a queued retransmission must not be sent)
+ */
+bool AckTracker::isAcknowledged(const String& replyToken) {
+    InFlightEvent* event = find(replyToken);
+    return event && event->acknowledged;
+}
+
+/**
+ * @brief The queued copy of an event has been dropped instead of being sent
+ */
+void AckTracker::discarded(const String& replyToken) {
+    InFlightEvent* event = find(replyToken);
+    if (!event || !event->pending) return;
+    event->used    = false;
+    event->pending = false;
+    event->message = "";
+}
+
+/**
+ * @brief Check for timed out events and push state events back into the sendQueue
+ *
+ * @return `false` if too many events in a row have not been acknowledged (connection is probably dead)
+ */
+bool AckTracker::handle(PrioritySendQueue& sendQueue) {
+    unsigned long currentMillis = millis();
+    bool          timedOut      = false;
+
+    for (auto& event : inFlight) {
+        if (!event.used || event.pending) continue;
+        if (currentMillis - event.sentAt < SINRICPRO_ACK_TIMEOUT) continue;
+
+        AckStats& entry = statsFor(event.action);
+        entry.timeouts++;
+        timedOut = true;
+        DEBUG_SINRIC("[SinricPro:AckTracker]: \"%s\" has not been acknowledged\r\n", event.action.c_str());
+
+        if (event.message.length() && event.retransmits < SINRICPRO_ACK_MAX_RETRANSMITS) {
+            event.retransmits++;
+            event.pending = true;
+            entry.retransmits++;
+            sendQueue.push(new SinricProMessage(IF_WEBSOCKET, event.message.c_str()));
+        } else {
+            event.used    = false;
+            event.message = "";
+        }
+    }
+
+    if (timedOut) misses++;  // events sent together and lost together count as one miss
+    if (misses < SINRICPRO_ACK_MAX_MISSES) return true;
+    misses = 0;
+    return false;
+}
+
+/**
+ * @brief Connection was lost: push all unacknowledged state events back into the sendQueue
+ */
+void AckTracker::requeue(PrioritySendQueue& sendQueue) {
+    for (auto& event : inFlight) {
+        if (!event.used) continue;
+        if (event.message.length() && !event.pending) {
+            event.pending = true;
+            sendQueue.push(new SinricProMessage(IF_WEBSOCKET, event.message.c_str()));
+        } else if (!event.pending) {
+            event.used = false;
+        }
+    }
+    misses = 0;
+}
+
+/**
+ * @brief Time in milliseconds until the next event times out
+ * @return `ULONG_MAX` if no event is waiting for an acknowledge
+ */
+unsigned long AckTracker::nextTimeoutIn() const {
+    unsigned long result        = ULONG_MAX;
+    unsigned long currentMillis = millis();
+    for (auto& event : inFlight) {
+        if (!event.used || event.pending) continue;
+        unsigned long elapsed = currentMillis - event.sentAt;
+        unsigned long remain  = elapsed >= SINRICPRO_ACK_TIMEOUT ? 0 : SINRICPRO_ACK_TIMEOUT - elapsed;
+        if (remain < result) result = remain;
+    }
+    return result;
+}
+
+const std::vector<AckStats>& AckTracker::getStats() const {
+    return stats;
+}
+
+AckTracker::InFlightEvent* AckTracker::find(const String& replyToken) {
+    for (auto& event : inFlight) {
+        if (event.used && event.replyToken == replyToken) return &event;
+    }
+    return nullptr;
+}
+
+AckStats& AckTracker::statsFor(const String& action) {
+    for (auto& entry : stats) {
+        if (entry.action == action) return entry;
+    }
+    // keep memory bounded: when SINRICPRO_ACK_STATS_SIZE - 1 actions are recorded, all further actions share "other"
+    if (stats.size() >= SINRICPRO_ACK_STATS_SIZE - 1 && action != "other") return statsFor("other");
+    stats.push_back(AckStats{action, 0, 0, 0, 0, 0, 0});
+    return stats.back();
+}
+
+}  // namespace SINRICPRO_NAMESPACE
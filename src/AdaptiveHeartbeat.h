@@ -0,0 +1,144 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "SinricProConfig.h"
+#include "SinricProDebug.h"
+#include "SinricProNamespace.h"
+namespace SINRICPRO_NAMESPACE {
+
+static const uint32_t RTT_HISTOGRAM_BOUNDS[] = {50, 100, 200, 500, 1000, 2000};  // upper bounds in ms, last bucket is everything above
+static const size_t   RTT_HISTOGRAM_SIZE     = sizeof(RTT_HISTOGRAM_BOUNDS) / sizeof(RTT_HISTOGRAM_BOUNDS[0]) + 1;
+
+/**
+ * @brief Current state of the websocket heartbeat
+ */
+struct HeartbeatStats {
+    uint32_t interval;                          ///< current ping interval in ms
+    uint32_t pongTimeout;                       ///< current pong timeout in ms
+    uint32_t safeInterval;                      ///< longest interval that did not lead to a silent disconnect (ms)
+    uint32_t smoothedRtt;                       ///< smoothed round trip time in ms
+    uint32_t rttVariance;                       ///< round trip time variance in ms
+    uint32_t minRtt;                            ///< lowest round trip time in ms
+    uint32_t maxRtt;                            ///< highest round trip time in ms
+    uint32_t pongs;                             ///< number of received pongs
+    uint32_t idleDisconnects;                   ///< number of connections lost while idle
+    uint32_t rttHistogram[RTT_HISTOGRAM_SIZE];  ///< pong count per RTT_HISTOGRAM_BOUNDS bucket
+};
+
+/**
+ * @brief Adapts the websocket ping interval and pong timeout
+ *
+ * The pong timeout follows the measured round trip time (smoothed rtt + 4 * variance, like TCP's RTO).
+ * The ping interval starts at `SINRICPRO_HEARTBEAT_START_INTERVAL` and grows by 25% after every
+ * `SINRICPRO_HEARTBEAT_PROBE_COUNT` pongs in a row. When the connection is lost after being idle for a full
+ * interval (typically a NAT or firewall dropping the idle mapping), 3/4 of that interval becomes the new upper limit.
+ * The limit is raised by 1/8 again after every `SINRICPRO_HEARTBEAT_RECOVERY_TIME` ms without an idle disconnect, so a
+ * temporary network problem does not cap the interval for good.
+ */
+class AdaptiveHeartbeat {
+  public:
+    AdaptiveHeartbeat();
+
+    void connected();
+    void pongReceived(uint32_t rtt);
+    void connectionLost();
+
+    uint32_t              getInterval() const;
+    uint32_t              getPongTimeout() const;
+    const HeartbeatStats& getStats() const;
+
+  protected:
+    uint32_t       minInterval;
+    uint32_t       maxInterval;
+    uint32_t       successCount;
+    unsigned long  lastPongAt;
+    unsigned long  stableSince;  // last idle disconnect or last increase of the safe interval
+    HeartbeatStats stats;
+};
+
+AdaptiveHeartbeat::AdaptiveHeartbeat()
+    : minInterval(min(SINRICPRO_HEARTBEAT_MIN_INTERVAL, SINRICPRO_HEARTBEAT_MAX_INTERVAL))
+    , maxInterval(SINRICPRO_HEARTBEAT_MAX_INTERVAL)
+    , successCount(0)
+    , lastPongAt(0)
+    , stableSince(0)
+    , stats() {
+    stats.interval     = constrain(SINRICPRO_HEARTBEAT_START_INTERVAL, minInterval, maxInterval);
+    stats.pongTimeout  = WEBSOCKET_PING_TIMEOUT;
+    stats.safeInterval = maxInterval;
+}
+
+void AdaptiveHeartbeat::connected() {
+    successCount = 0;
+    lastPongAt   = millis();
+}
+
+void AdaptiveHeartbeat::pongReceived(uint32_t rtt) {
+    lastPongAt = millis();
+    stats.pongs++;
+
+    size_t bucket = 0;
+    while (bucket < RTT_HISTOGRAM_SIZE - 1 && rtt > RTT_HISTOGRAM_BOUNDS[bucket]) bucket++;
+    stats.rttHistogram[bucket]++;
+
+    if (stats.pongs == 1) {
+        stats.smoothedRtt = rtt;
+        stats.rttVariance = rtt / 2;
+        stats.minRtt      = rtt;
+        stats.maxRtt      = rtt;
+    } else {
+        uint32_t deviation = rtt > stats.smoothedRtt ? rtt - stats.smoothedRtt : stats.smoothedRtt - rtt;
+        stats.rttVariance  = (3 * stats.rttVariance + deviation) / 4;
+        stats.smoothedRtt  = (7 * stats.smoothedRtt + rtt) / 8;
+        if (rtt < stats.minRtt) stats.minRtt = rtt;
+        if (rtt > stats.maxRtt) stats.maxRtt = rtt;
+    }
+    stats.pongTimeout = constrain(stats.smoothedRtt + 4 * stats.rttVariance, (uint32_t)SINRICPRO_HEARTBEAT_MIN_PONG_TIMEOUT, (uint32_t)WEBSOCKET_PING_TIMEOUT);
+
+    // raise the limit after a long stable period
+    if (stats.safeInterval < maxInterval && lastPongAt - stableSince >= SINRICPRO_HEARTBEAT_RECOVERY_TIME) {
+        stableSince        = lastPongAt;
+        stats.safeInterval = min(stats.safeInterval + stats.safeInterval / 8, maxInterval);
+        DEBUG_SINRIC("[SinricPro:Heartbeat]: stable for %lu ms, safe interval raised to %lu ms\r\n", (unsigned long)SINRICPRO_HEARTBEAT_RECOVERY_TIME, (unsigned long)stats.safeInterval);
+    }
+
+    // probe for a longer interval
+    if (++successCount < SINRICPRO_HEARTBEAT_PROBE_COUNT) return;
+    successCount = 0;
+    if (stats.interval >= stats.safeInterval) return;
+    stats.interval = min(stats.interval + stats.interval / 4, stats.safeInterval);
+    DEBUG_SINRIC("[SinricPro:Heartbeat]: ping interval increased to %lu ms\r\n", (unsigned long)stats.interval);
+}
+
+void AdaptiveHeartbeat::connectionLost() {
+    successCount = 0;
+    if (millis() - lastPongAt < stats.interval) return;  // connection was not idle
+
+    stats.idleDisconnects++;
+    stableSince        = millis();
+    stats.safeInterval = max(stats.interval - stats.interval / 4, minInterval);
+    stats.interval     = stats.safeInterval;
+    DEBUG_SINRIC("[SinricPro:Heartbeat]: connection lost while idle, ping interval reduced to %lu ms\r\n", (unsigned long)stats.interval);
+}
+
+uint32_t AdaptiveHeartbeat::getInterval() const {
+    return stats.interval;
+}
+
+uint32_t AdaptiveHeartbeat::getPongTimeout() const {
+    return stats.pongTimeout;
+}
+
+const HeartbeatStats& AdaptiveHeartbeat::getStats() const {
+    return stats;
+}
+
+}  // namespace SINRICPRO_NAMESPACE
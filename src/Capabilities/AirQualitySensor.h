@@ -1,6 +1,8 @@
 #pragma once
 
 #include "../EventLimiter.h"
+#include "../ReportingPolicy.h"
+#include "../SampleAggregator.h"
 #include "../SinricProStrings.h"
 
 #include "../SinricProNamespace.h"
@@ -20,8 +22,20 @@ class AirQualitySensor {
   public:
     AirQualitySensor();
     bool sendAirQualityEvent(int pm1 = 0, int pm2_5 = 0, int pm10 = 0, String cause = FSTR_SINRICPRO_PERIODIC_POLL);
+
+    void setPM1Deadband(float absolute, float relative = 0);
+    void setPM2_5Deadband(float absolute, float relative = 0);
+    void setPM10Deadband(float absolute, float relative = 0);
+    void setAirQualityHeartbeat(unsigned long interval);
+
+    void addAirQualitySample(float pm1, float pm2_5, float pm10);
+    bool sendAirQualitySummary(String cause = FSTR_SINRICPRO_PERIODIC_POLL);
   private:
     EventLimiter event_limiter;
+    ReportingPolicy<3> reporting_policy;  // pm1, pm2_5, pm10
+    SampleAggregator pm1_samples;
+    SampleAggregator pm2_5_samples;
+    SampleAggregator pm10_samples;
 };
 
 template <typename T>
@@ -36,11 +50,14 @@ AirQualitySensor<T>::AirQualitySensor()
  * @param   pm10          `int` 10 μm particle pollutant in μg/m3
  * @param   cause         (optional) `String` reason why event is sent (default = `"PERIODIC_POLL"`)
  * @return  the success of sending the event
- * @retval  true          event has been sent successfully
+ * @retval  true          event has been sent successfully (or the reading is not worth a report, see `ReportingPolicy`)
  * @retval  false         event has not been sent, maybe you sent to much events in a short distance of time
  **/
 template <typename T>
 bool AirQualitySensor<T>::sendAirQualityEvent(int pm1, int pm2_5, int pm10, String cause) {
+  float values[] = {(float)pm1, (float)pm2_5, (float)pm10};
+  if (!reporting_policy.shouldReport(values)) return true;
+  if (reporting_policy.isEnabled() && event_limiter.isLimited()) return false;  // stays pending until the limiter allows it
   if (event_limiter) return false;
   T* device = static_cast<T*>(this);
   
@@ -51,7 +68,87 @@ bool AirQualitySensor<T>::sendAirQualityEvent(int pm1, int pm2_5, int pm10, Stri
   event_value[FSTR_AIRQUALITY_pm2_5] = pm2_5;
   event_value[FSTR_AIRQUALITY_pm10]  = pm10;
 
-  return device->sendEvent(eventMessage);
+  bool success = device->sendEvent(eventMessage);
+  if (success) {
+    reporting_policy.reported(values);
+    pm1_samples.reset();
+    pm2_5_samples.reset();
+    pm10_samples.reset();
+  }
+  return success;
+}
+
+/**
+ * @brief Add a measurement to the current window (call as often as you measure)
+ * 
+ * Samples are averaged by `sendAirQualitySummary()`.
+ * @param   pm1           1.0 μm particle pollutant	in μg/m3
+ * @param   pm2_5         2.5 μm particle pollutant	in μg/m3
+ * @param   pm10          10 μm particle pollutant in μg/m3
+ **/
+template <typename T>
+void AirQualitySensor<T>::addAirQualitySample(float pm1, float pm2_5, float pm10) {
+  uint32_t timestamp = micros();
+  pm1_samples.addSample(pm1, timestamp);
+  pm2_5_samples.addSample(pm2_5, timestamp);
+  pm10_samples.addSample(pm10, timestamp);
+}
+
+/**
+ * @brief Send the average of all samples since the last sent event
+ * 
+ * @param   cause         (optional) `String` reason why event is sent (default = `"PERIODIC_POLL"`)
+ * @return  the success of sending the event
+ * @retval  true          event has been sent successfully (or the averages are not worth a report, see `ReportingPolicy`)
+ * @retval  false         event has not been sent (no samples or too many events), samples are kept for the next summary
+ **/
+template <typename T>
+bool AirQualitySensor<T>::sendAirQualitySummary(String cause) {
+  if (pm2_5_samples.isEmpty()) return false;
+  return sendAirQualityEvent(lroundf(pm1_samples.getSummary().mean), lroundf(pm2_5_samples.getSummary().mean), lroundf(pm10_samples.getSummary().mean), cause);
+}
+
+/**
+ * @brief Only report PM1.0 values which differ from the last reported value by a minimum amount
+ * 
+ * @param   absolute      minimum change in μg/m3 (0 = not used)
+ * @param   relative      (optional) minimum change relative to the last reported value (eg. `0.1` = 10%)
+ **/
+template <typename T>
+void AirQualitySensor<T>::setPM1Deadband(float absolute, float relative) {
+  reporting_policy.setDeadband(0, absolute, relative);
+}
+
+/**
+ * @brief Only report PM2.5 values which differ from the last reported value by a minimum amount
+ * 
+ * @param   absolute      minimum change in μg/m3 (0 = not used)
+ * @param   relative      (optional) minimum change relative to the last reported value (eg. `0.1` = 10%)
+ **/
+template <typename T>
+void AirQualitySensor<T>::setPM2_5Deadband(float absolute, float relative) {
+  reporting_policy.setDeadband(1, absolute, relative);
+}
+
+/**
+ * @brief Only report PM10 values which differ from the last reported value by a minimum amount
+ * 
+ * @param   absolute      minimum change in μg/m3 (0 = not used)
+ * @param   relative      (optional) minimum change relative to the last reported value (eg. `0.1` = 10%)
+ **/
+template <typename T>
+void AirQualitySensor<T>::setPM10Deadband(float absolute, float relative) {
+  reporting_policy.setDeadband(2, absolute, relative);
+}
+
+/**
+ * @brief Report the air quality at least every `interval` ms, even if it has not changed
+ * 
+ * @param   interval      maximum time between two reports in ms (0 = no heartbeat)
+ **/
+template <typename T>
+void AirQualitySensor<T>::setAirQualityHeartbeat(unsigned long interval) {
+  reporting_policy.setHeartbeat(interval);
 }
 
 } // SINRICPRO_NAMESPACE
@@ -3,6 +3,7 @@
 #include "../SinricProRequest.h"
 #include "../EventLimiter.h"
 #include "../SinricProStrings.h"
+#include "../StateShadow.h"
 
 #include "../SinricProNamespace.h"
 namespace SINRICPRO_NAMESPACE {
@@ -57,11 +58,13 @@ class BrightnessController {
     bool sendBrightnessEvent(int brightness, String cause = FSTR_SINRICPRO_PHYSICAL_INTERACTION);
   protected:
     bool handleBrightnessController(SinricProRequest &request);
+    void getBrightnessState(JsonObject &state);
 
   private:
     EventLimiter event_limiter;
     BrightnessCallback brightnessCallback;
     AdjustBrightnessCallback adjustBrightnessCallback;
+    StateShadow<int> brightnessShadow;
 };
 
 template <typename T>
@@ -69,6 +72,7 @@ BrightnessController<T>::BrightnessController()
 : event_limiter (EVENT_LIMIT_STATE) { 
   T* device = static_cast<T*>(this);
   device->registerRequestHandler(std::bind(&BrightnessController<T>::handleBrightnessController, this, std::placeholders::_1)); 
+  device->registerStateHandler(std::bind(&BrightnessController<T>::getBrightnessState, this, std::placeholders::_1));
 }
 
 /**
@@ -86,6 +90,8 @@ void BrightnessController<T>::onBrightness(BrightnessCallback cb) {
 /**
  * @brief Set callback function for `adjustBrightness` request
  * 
+ * Without this callback and with `SINRICPRO_STATE_SHADOW` defined, `adjustBrightness` requests are resolved
+ * against the last known brightness and passed to the `onBrightness` callback.
  * @param cb Function pointer to a `AdjustBrightnessCallback` function
  * @return void
  * @see AdjustBrightnessCallback
@@ -101,18 +107,21 @@ void BrightnessController<T>::onAdjustBrightness(AdjustBrightnessCallback cb) {
  * @param brightness    Integer value with actual brightness the device is set to
  * @param cause   (optional) `String` reason why event is sent (default = `"PHYSICAL_INTERACTION"`)
  * @return the success of sending the even
- * @retval true   event has been sent successfully
+ * @retval true   event has been sent successfully (or the brightness has not changed, see `SINRICPRO_STATE_SHADOW`)
  * @retval false  event has not been sent, maybe you sent to much events in a short distance of time
  **/
 template <typename T>
 bool BrightnessController<T>::sendBrightnessEvent(int brightness, String cause) {
+  if (brightnessShadow.isUnchanged(brightness)) return true;
   if (event_limiter) return false;
   T* device = static_cast<T*>(this);
 
   JsonDocument eventMessage        = device->prepareEvent(FSTR_BRIGHTNESS_setBrightness, cause.c_str());
   JsonObject event_value                  = eventMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_value];
   event_value[FSTR_BRIGHTNESS_brightness] = brightness;
-  return device->sendEvent(eventMessage);
+  bool success = device->sendEvent(eventMessage);
+  if (success) brightnessShadow.set(brightness);
+  return success;
 }
 
 template <typename T>
@@ -124,17 +133,31 @@ bool BrightnessController<T>::handleBrightnessController(SinricProRequest &reque
     int brightness = request.request_value[FSTR_BRIGHTNESS_brightness];
     success = brightnessCallback(device->deviceId, brightness);
     request.response_value[FSTR_BRIGHTNESS_brightness] = brightness;
+    if (success) brightnessShadow.set(brightness);
   }
 
-  if (adjustBrightnessCallback && request.action == FSTR_BRIGHTNESS_adjustBrightness) {
+  if (request.action == FSTR_BRIGHTNESS_adjustBrightness) {
     int brightnessDelta = request.request_value[FSTR_BRIGHTNESS_brightnessDelta];
-    success = adjustBrightnessCallback(device->deviceId, brightnessDelta);
-    request.response_value[FSTR_BRIGHTNESS_brightness] = brightnessDelta;
+    if (adjustBrightnessCallback) {
+      success = adjustBrightnessCallback(device->deviceId, brightnessDelta);
+      request.response_value[FSTR_BRIGHTNESS_brightness] = brightnessDelta;
+      if (success) brightnessShadow.set(brightnessDelta);
+    } else if (brightnessCallback && brightnessShadow.isKnown()) {  // resolve against the last known brightness
+      int brightness = constrain(brightnessShadow.get() + brightnessDelta, 0, 100);
+      success = brightnessCallback(device->deviceId, brightness);
+      request.response_value[FSTR_BRIGHTNESS_brightness] = brightness;
+      if (success) brightnessShadow.set(brightness);
+    }
   }
 
   return success;
 }
 
+template <typename T>
+void BrightnessController<T>::getBrightnessState(JsonObject &state) {
+  if (brightnessShadow.isKnown()) state[FSTR_BRIGHTNESS_brightness] = brightnessShadow.get();
+}
+
 } // SINRICPRO_NAMESPACE
 
 template <typename T>
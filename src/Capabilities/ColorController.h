@@ -3,6 +3,7 @@
 #include "../SinricProRequest.h"
 #include "../EventLimiter.h"
 #include "../SinricProStrings.h"
+#include "../StateShadow.h"
 
 #include "../SinricProNamespace.h"
 namespace SINRICPRO_NAMESPACE {
@@ -46,10 +47,12 @@ class ColorController {
 
   protected:
     bool handleColorController(SinricProRequest &request);
+    void getColorState(JsonObject &state);
 
   private:
     EventLimiter event_limiter;
     ColorCallback colorCallback;
+    StateShadow<uint32_t> colorShadow;  // 0x00RRGGBB
 };
 
 template <typename T>
@@ -57,6 +60,7 @@ ColorController<T>::ColorController()
 : event_limiter(EVENT_LIMIT_STATE) { 
   T* device = static_cast<T*>(this);
   device->registerRequestHandler(std::bind(&ColorController<T>::handleColorController, this, std::placeholders::_1)); 
+  device->registerStateHandler(std::bind(&ColorController<T>::getColorState, this, std::placeholders::_1));
 }
 
 
@@ -80,11 +84,13 @@ void ColorController<T>::onColor(ColorCallback cb) {
  * @param b       Byte value for blue
  * @param cause   (optional) `String` reason why event is sent (default = `"PHYSICAL_INTERACTION"`)
  * @return the success of sending the even
- * @retval true   event has been sent successfully
+ * @retval true   event has been sent successfully (or the color has not changed, see `SINRICPRO_STATE_SHADOW`)
  * @retval false  event has not been sent, maybe you sent to much events in a short distance of time
  **/
 template <typename T>
 bool ColorController<T>::sendColorEvent(byte r, byte g, byte b, String cause) {
+  uint32_t color = ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+  if (colorShadow.isUnchanged(color)) return true;
   if (event_limiter) return false;
   T* device = static_cast<T*>(this);
 
@@ -93,7 +99,9 @@ bool ColorController<T>::sendColorEvent(byte r, byte g, byte b, String cause) {
   event_color[FSTR_COLOR_r] = r;
   event_color[FSTR_COLOR_g] = g;
   event_color[FSTR_COLOR_b] = b;
-  return device->sendEvent(eventMessage);
+  bool success = device->sendEvent(eventMessage);
+  if (success) colorShadow.set(color);
+  return success;
 }
 
 template <typename T>
@@ -112,11 +120,22 @@ bool ColorController<T>::handleColorController(SinricProRequest &request) {
     request.response_value[FSTR_COLOR_color][FSTR_COLOR_r] = r;
     request.response_value[FSTR_COLOR_color][FSTR_COLOR_g] = g;
     request.response_value[FSTR_COLOR_color][FSTR_COLOR_b] = b;
+    if (success) colorShadow.set(((uint32_t)r << 16) | ((uint32_t)g << 8) | b);
   }
 
   return success;
 }
 
+template <typename T>
+void ColorController<T>::getColorState(JsonObject &state) {
+  if (!colorShadow.isKnown()) return;
+  uint32_t color = colorShadow.get();
+  JsonObject state_color = state[FSTR_COLOR_color].to<JsonObject>();
+  state_color[FSTR_COLOR_r] = (color >> 16) & 0xFF;
+  state_color[FSTR_COLOR_g] = (color >> 8) & 0xFF;
+  state_color[FSTR_COLOR_b] = color & 0xFF;
+}
+
 } // SINRICPRO_NAMESPACE
 
 template <typename T>
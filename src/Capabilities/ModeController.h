@@ -3,6 +3,7 @@
 #include "../SinricProRequest.h"
 #include "../EventLimiter.h"
 #include "../SinricProStrings.h"
+#include "../StateShadow.h"
 
 #include "../SinricProNamespace.h"
 
@@ -10,6 +11,7 @@ namespace SINRICPRO_NAMESPACE {
 
 FSTR(MODE, setMode);  // "setMode"
 FSTR(MODE, mode);     // "mode"
+FSTR(MODE, modes);    // "modes"
 
 /**
  * @brief Callback definition for onSetMode function
@@ -63,12 +65,14 @@ class ModeController {
   protected:
 
     bool handleModeController(SinricProRequest &request);
+    void getModeState(JsonObject &state);
 
   private:
     EventLimiter event_limiter;
     std::map<String, EventLimiter> event_limiter_generic;
     ModeCallback setModeCallback;
     std::map<String, GenericModeCallback> genericModeCallback;
+    StateShadowMap<String> modeShadow;
 };
 
 template <typename T>
@@ -76,6 +80,7 @@ ModeController<T>::ModeController()
 : event_limiter(EVENT_LIMIT_STATE) { 
   T* device = static_cast<T*>(this);
   device->registerRequestHandler(std::bind(&ModeController<T>::handleModeController, this, std::placeholders::_1)); 
+  device->registerStateHandler(std::bind(&ModeController<T>::getModeState, this, std::placeholders::_1));
 }
 
 /**
@@ -107,18 +112,21 @@ void ModeController<T>::onSetMode(const String& instance, GenericModeCallback cb
  * @param mode    String with actual mode device is set to \n `MOVIE`, `MUSIC`, `NIGHT`, `SPORT`, `TV`
  * @param cause   (optional) `String` reason why event is sent (default = `FSTR_SINRICPRO_PHYSICAL_INTERACTION`)
  * @return the success of sending the even
- * @retval true   event has been sent successfully
+ * @retval true   event has been sent successfully (or the mode has not changed, see `SINRICPRO_STATE_SHADOW`)
  * @retval false  event has not been sent, maybe you sent to much events in a short distance of time
  **/
 template <typename T>
 bool ModeController<T>::sendModeEvent(String mode, String cause) {
+  if (modeShadow.isUnchanged("", mode)) return true;
   if (event_limiter) return false;
   T* device = static_cast<T*>(this);
 
   JsonDocument eventMessage = device->prepareEvent(FSTR_MODE_setMode, cause.c_str());
   JsonObject event_value = eventMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_value];
   event_value[FSTR_MODE_mode] = mode;
-  return device->sendEvent(eventMessage);
+  bool success = device->sendEvent(eventMessage);
+  if (success) modeShadow.set("", mode);
+  return success;
 }
 
 /**
@@ -128,11 +136,12 @@ bool ModeController<T>::sendModeEvent(String mode, String cause) {
  * @param mode    String with actual mode device is set to \n `MOVIE`, `MUSIC`, `NIGHT`, `SPORT`, `TV`
  * @param cause   (optional) `String` reason why event is sent (default = `FSTR_SINRICPRO_PHYSICAL_INTERACTION`)
  * @return the success of sending the even
- * @retval true   event has been sent successfully
+ * @retval true   event has been sent successfully (or the mode has not changed, see `SINRICPRO_STATE_SHADOW`)
  * @retval false  event has not been sent, maybe you sent to much events in a short distance of time
  **/
 template <typename T>
 bool ModeController<T>::sendModeEvent(String instance, String mode, String cause) {
+  if (modeShadow.isUnchanged(instance, mode)) return true;
   if (event_limiter_generic.find(instance) == event_limiter_generic.end()) event_limiter_generic[instance] = EventLimiter(EVENT_LIMIT_STATE);
   if (event_limiter_generic[instance]) return false;
 
@@ -142,7 +151,9 @@ bool ModeController<T>::sendModeEvent(String instance, String mode, String cause
   eventMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_instanceId] = instance;
   JsonObject event_value = eventMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_value];
   event_value[FSTR_MODE_mode] = mode;
-  return device->sendEvent(eventMessage);
+  bool success = device->sendEvent(eventMessage);
+  if (success) modeShadow.set(instance, mode);
+  return success;
 }
 
 template <typename T>
@@ -157,12 +168,14 @@ bool ModeController<T>::handleModeController(SinricProRequest &request) {
     if (genericModeCallback.find(request.instance) != genericModeCallback.end()) {
       success = genericModeCallback[request.instance](device->deviceId, request.instance, mode);
       request.response_value[FSTR_MODE_mode] = mode;
+      if (success) modeShadow.set(request.instance, mode);
       return success;
     } else return false;
   } else {
     if (setModeCallback) {
       success = setModeCallback(device->deviceId, mode);
       request.response_value[FSTR_MODE_mode] = mode;
+      if (success) modeShadow.set("", mode);
       return success;
     }
   }
@@ -170,6 +183,17 @@ bool ModeController<T>::handleModeController(SinricProRequest &request) {
   return success;
 }
 
+template <typename T>
+void ModeController<T>::getModeState(JsonObject &state) {
+  for (auto& entry : modeShadow.entries()) {
+    if (entry.instance == "") {
+      state[FSTR_MODE_mode] = entry.value;
+    } else {
+      state[FSTR_MODE_modes][entry.instance] = entry.value;
+    }
+  }
+}
+
 } // SINRICPRO_NAMESPACE
 
 template <typename T>
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "../EventLimiter.h"
+#include "../ReportingPolicy.h"
+#include "../SampleAggregator.h"
 #include "../SinricProStrings.h"
 
 #include "../SinricProNamespace.h"
@@ -26,11 +28,24 @@ public:
   PowerSensor();
   bool sendPowerSensorEvent(float voltage, float current, float power = -1.0f, float apparentPower = -1.0f, float reactivePower = -1.0f, float factor = -1.0f, String cause = FSTR_SINRICPRO_PERIODIC_POLL);
 
+  void setVoltageDeadband(float absolute, float relative = 0);
+  void setCurrentDeadband(float absolute, float relative = 0);
+  void setPowerDeadband(float absolute, float relative = 0);
+  void setPowerSensorHeartbeat(unsigned long interval);
+
+  void addPowerSensorSample(float voltage, float current, float power = -1.0f);
+  bool sendPowerSensorSummary(String cause = FSTR_SINRICPRO_PERIODIC_POLL);
+
 private:
   EventLimiter event_limiter;
+  ReportingPolicy<3> reporting_policy;  // voltage, current, power
+  SampleAggregator voltage_samples;
+  SampleAggregator current_samples;
+  SampleAggregator power_samples;
   unsigned long startTime = 0;
-  unsigned long lastPower = 0;
-  float getWattHours(unsigned long currentTimestamp);
+  float lastPower = 0;
+  float getWattHours(unsigned long currentTimestamp, float power);
+  bool sendPowerUsage(float voltage, float current, float power, float apparentPower, float reactivePower, float factor, float wattHours, String cause);
 };
 
 template <typename T>
@@ -47,18 +62,72 @@ PowerSensor<T>::PowerSensor()
  * @param   factor        `float` (optional) if not provided it is set to -1 \n if apparentPower is provided, factor is calculated automaticly (factor = power / apparentPower)
  * @param   cause         `String` (optional) Reason why event is sent (default = `"PERIODIC_POLL"`)
  * @return  the success of sending the event
- * @retval  true          event has been sent successfully
+ * @retval  true          event has been sent successfully (or the reading is not worth a report, see `ReportingPolicy`)
  * @retval  false         event has not been sent, maybe you sent to much events in a short distance of time
  **/
 template <typename T>
 bool PowerSensor<T>::sendPowerSensorEvent(float voltage, float current, float power, float apparentPower, float reactivePower, float factor, String cause) {
+  if (power == -1)
+    power = voltage * current;
+  return sendPowerUsage(voltage, current, power, apparentPower, reactivePower, factor, -1, cause);
+}
+
+/**
+ * @brief Add a measurement to the current window (call as often as you measure, even hundreds of times per second)
+ * 
+ * Samples are summarized by `sendPowerSensorSummary()`.
+ * @param   voltage       `float` voltage
+ * @param   current       `float` current
+ * @param   power         `float` (optional) if not provided, it is calculated automaticly (power = voltage * current)
+ * @section addPowerSensorSample Example-Code
+ * @code
+ * void loop() {
+ *   SinricPro.handle();
+ *   myPowerSensor.addPowerSensorSample(readVoltage(), readCurrent());
+ *   if (millis() - lastReport >= 60000) {
+ *     myPowerSensor.sendPowerSensorSummary();
+ *     lastReport = millis();
+ *   }
+ * }
+ * @endcode
+ **/
+template <typename T>
+void PowerSensor<T>::addPowerSensorSample(float voltage, float current, float power) {
+  if (power == -1)
+    power = voltage * current;
+  uint32_t timestamp = micros();
+  voltage_samples.addSample(voltage, timestamp);
+  current_samples.addSample(current, timestamp);
+  power_samples.addSample(power, timestamp);
+}
+
+/**
+ * @brief Send the average voltage, current and power and the energy of all samples since the last summary
+ * 
+ * The energy (`wattHours`) is the trapezoidal integral of all power samples, so fluctuating loads are measured correctly.
+ * @param   cause         `String` (optional) Reason why event is sent (default = `"PERIODIC_POLL"`)
+ * @return  the success of sending the event
+ * @retval  true          event has been sent successfully (or the summary is not worth a report, see `ReportingPolicy`)
+ * @retval  false         event has not been sent (no samples or too many events), samples are kept for the next summary
+ **/
+template <typename T>
+bool PowerSensor<T>::sendPowerSensorSummary(String cause) {
+  if (power_samples.isEmpty()) return false;
+  SampleSummary power = power_samples.getSummary();
+  float wattHours = power.integral / 3600.0f;
+  return sendPowerUsage(voltage_samples.getSummary().mean, current_samples.getSummary().mean, power.mean, -1.0f, -1.0f, -1.0f, wattHours, cause);
+}
+
+template <typename T>
+bool PowerSensor<T>::sendPowerUsage(float voltage, float current, float power, float apparentPower, float reactivePower, float factor, float wattHours, String cause) {
+  float values[] = {voltage, current, power};
+  if (!reporting_policy.shouldReport(values)) return true;
+  if (reporting_policy.isEnabled() && event_limiter.isLimited()) return false;  // stays pending until the limiter allows it
   if (event_limiter) return false;
   T* device = static_cast<T*>(this);
 
   JsonDocument eventMessage = device->prepareEvent(FSTR_POWERSENSOR_powerUsage, cause.c_str());
   JsonObject event_value = eventMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_value];
-  if (power == -1)
-    power = voltage * current;
   if (factor == -1 && apparentPower != -1)
     factor = power / apparentPower;
 
@@ -71,17 +140,68 @@ bool PowerSensor<T>::sendPowerSensorEvent(float voltage, float current, float po
   event_value[FSTR_POWERSENSOR_apparentPower] = apparentPower;
   event_value[FSTR_POWERSENSOR_reactivePower] = reactivePower;
   event_value[FSTR_POWERSENSOR_factor]        = factor;
-  event_value[FSTR_POWERSENSOR_wattHours]     = getWattHours(currentTimestamp);
+  event_value[FSTR_POWERSENSOR_wattHours]     = wattHours == -1 ? getWattHours(currentTimestamp, power) : wattHours;
+
+  bool success = device->sendEvent(eventMessage);
+  if (success) {  // otherwise the next event covers the energy since the last event that has been sent
+    startTime = currentTimestamp;
+    lastPower = power;
+    reporting_policy.reported(values);
+    voltage_samples.reset();
+    current_samples.reset();
+    power_samples.reset();
+  }
+  return success;
+}
+
+/**
+ * @brief Only report voltages which differ from the last reported voltage by a minimum amount
+ * 
+ * @param   absolute      minimum change in volts (0 = not used)
+ * @param   relative      (optional) minimum change relative to the last reported voltage (eg. `0.02` = 2%)
+ **/
+template <typename T>
+void PowerSensor<T>::setVoltageDeadband(float absolute, float relative) {
+  reporting_policy.setDeadband(0, absolute, relative);
+}
 
-  startTime = currentTimestamp;
-  lastPower = power;
-  return device->sendEvent(eventMessage);
+/**
+ * @brief Only report currents which differ from the last reported current by a minimum amount
+ * 
+ * @param   absolute      minimum change in amperes (0 = not used)
+ * @param   relative      (optional) minimum change relative to the last reported current (eg. `0.1` = 10%)
+ **/
+template <typename T>
+void PowerSensor<T>::setCurrentDeadband(float absolute, float relative) {
+  reporting_policy.setDeadband(1, absolute, relative);
+}
+
+/**
+ * @brief Only report power values which differ from the last reported power by a minimum amount
+ * 
+ * @param   absolute      minimum change in watts (0 = not used)
+ * @param   relative      (optional) minimum change relative to the last reported power (eg. `0.1` = 10%)
+ **/
+template <typename T>
+void PowerSensor<T>::setPowerDeadband(float absolute, float relative) {
+  reporting_policy.setDeadband(2, absolute, relative);
+}
+
+/**
+ * @brief Report power usage at least every `interval` ms, even if it has not changed
+ * 
+ * @param   interval      maximum time between two reports in ms (0 = no heartbeat)
+ **/
+template <typename T>
+void PowerSensor<T>::setPowerSensorHeartbeat(unsigned long interval) {
+  reporting_policy.setHeartbeat(interval);
 }
 
+// energy since the last report, assuming the power changed linearly between the two reports
 template <typename T>
-float PowerSensor<T>::getWattHours(unsigned long currentTimestamp) {
+float PowerSensor<T>::getWattHours(unsigned long currentTimestamp, float power) {
   if (startTime)
-    return (currentTimestamp - startTime) * lastPower / 3600.0f;
+    return (currentTimestamp - startTime) * (lastPower + power) / 2 / 3600.0f;
   return 0;
 }
 
@@ -3,6 +3,7 @@
 #include "../SinricProRequest.h"
 #include "../EventLimiter.h"
 #include "../SinricProStrings.h"
+#include "../StateShadow.h"
 
 #include "../SinricProNamespace.h"
 namespace SINRICPRO_NAMESPACE {
@@ -11,6 +12,7 @@ FSTR(POWERSTATE, state);             // "state"
 FSTR(POWERSTATE, On);                // "On"
 FSTR(POWERSTATE, Off);               // "Off"
 FSTR(POWERSTATE, setPowerState);     // "setPowerState"
+FSTR(POWERSTATE, powerState);        // "powerState"
 
 /**
  * @brief Callback definition for onPowerState function
@@ -42,10 +44,12 @@ class PowerStateController {
 
   protected:
     bool handlePowerStateController(SinricProRequest &request);
+    void getPowerStateState(JsonObject &state);
 
   private:
     EventLimiter event_limiter;
     PowerStateCallback powerStateCallback;
+    StateShadow<bool> powerStateShadow;
 };
 
 template <typename T>
@@ -53,6 +57,7 @@ PowerStateController<T>::PowerStateController()
 : event_limiter(EVENT_LIMIT_STATE) { 
   T* device = static_cast<T*>(this);
   device->registerRequestHandler(std::bind(&PowerStateController<T>::handlePowerStateController, this, std::placeholders::_1));
+  device->registerStateHandler(std::bind(&PowerStateController<T>::getPowerStateState, this, std::placeholders::_1));
 }
 
 /**
@@ -73,18 +78,21 @@ void PowerStateController<T>::onPowerState(PowerStateCallback cb) {
  * @param state   `true` = device turned on \n `false` = device turned off
  * @param cause   (optional) `String` reason why event is sent (default = `"PHYSICAL_INTERACTION"`)
  * @return the success of sending the even
- * @retval true   event has been sent successfully
+ * @retval true   event has been sent successfully (or the state has not changed, see `SINRICPRO_STATE_SHADOW`)
  * @retval false  event has not been sent, maybe you sent to much events in a short distance of time
  **/
 template <typename T>
 bool PowerStateController<T>::sendPowerStateEvent(bool state, String cause) {
+  if (powerStateShadow.isUnchanged(state)) return true;
   if (event_limiter) return false;
   T* device = static_cast<T*>(this);
 
   JsonDocument eventMessage = device->prepareEvent(FSTR_POWERSTATE_setPowerState, cause.c_str());
   JsonObject event_value = eventMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_value];
   event_value[FSTR_POWERSTATE_state] = state ? FSTR_POWERSTATE_On : FSTR_POWERSTATE_Off;
-  return device->sendEvent(eventMessage);
+  bool success = device->sendEvent(eventMessage);
+  if (success) powerStateShadow.set(state);
+  return success;
 }
 
 template <typename T>
@@ -97,11 +105,17 @@ bool PowerStateController<T>::handlePowerStateController(SinricProRequest &reque
     bool powerState = request.request_value[FSTR_POWERSTATE_state] == FSTR_POWERSTATE_On ? true : false;
     success = powerStateCallback(device->deviceId, powerState);
     request.response_value[FSTR_POWERSTATE_state] = powerState ? FSTR_POWERSTATE_On : FSTR_POWERSTATE_Off;
+    if (success) powerStateShadow.set(powerState);
     return success;
   }
   return success;
 }
 
+template <typename T>
+void PowerStateController<T>::getPowerStateState(JsonObject &state) {
+  if (powerStateShadow.isKnown()) state[FSTR_POWERSTATE_powerState] = powerStateShadow.get() ? FSTR_POWERSTATE_On : FSTR_POWERSTATE_Off;
+}
+
 } // SINRICPRO_NAMESPACE
 
 template <typename T>
@@ -3,6 +3,7 @@
 #include "../SinricProRequest.h"
 #include "../EventLimiter.h"
 #include "../SinricProStrings.h"
+#include "../StateShadow.h"
 
 #include "../SinricProNamespace.h"
 namespace SINRICPRO_NAMESPACE {
@@ -11,6 +12,7 @@ FSTR(RANGE, setRangeValue);       // "setRangeValue"
 FSTR(RANGE, rangeValue);          // "rangeValue"
 FSTR(RANGE, adjustRangeValue);    // "adjustRangeValue"
 FSTR(RANGE, rangeValueDelta);     // "rangeValueDelta"
+FSTR(RANGE, rangeValues);         // "rangeValues"
 
 /**
  * @brief Callback definition for onRangeValue function
@@ -125,6 +127,7 @@ class RangeController {
 
   protected:
     bool handleRangeController(SinricProRequest &request);
+    void getRangeValueState(JsonObject &state);
 
   private:
     EventLimiter event_limiter;
@@ -133,6 +136,7 @@ class RangeController {
     std::map<String, GenericRangeValueCallback> genericSetRangeValueCallback;
     AdjustRangeValueCallback adjustRangeValueCallback;
     std::map<String, GenericRangeValueCallback> genericAdjustRangeValueCallback;
+    StateShadowMap<float> rangeValueShadow;
 };
 
 template <typename T>
@@ -140,6 +144,7 @@ RangeController<T>::RangeController()
 : event_limiter(EVENT_LIMIT_STATE) { 
   T* device = static_cast<T*>(this);
   device->registerRequestHandler(std::bind(&RangeController<T>::handleRangeController, this, std::placeholders::_1)); 
+  device->registerStateHandler(std::bind(&RangeController<T>::getRangeValueState, this, std::placeholders::_1));
 }
 
 /**
@@ -197,18 +202,21 @@ void RangeController<T>::onAdjustRangeValue(const String &instance, GenericAdjus
  * @param   rangeValue  value for the range.
  * @param   cause       (optional) `String` reason why event is sent (default = `"PHYSICAL_INTERACTION"`)
  * @return  the success of sending the even
- * @retval  true        event has been sent successfully
+ * @retval  true        event has been sent successfully (or the range value has not changed, see `SINRICPRO_STATE_SHADOW`)
  * @retval  false       event has not been sent, maybe you sent to much events in a short distance of time
  */
 template <typename T>
 bool RangeController<T>::sendRangeValueEvent(int rangeValue, String cause) {
+  if (rangeValueShadow.isUnchanged("", rangeValue)) return true;
   if (event_limiter) return false;
   T* device = static_cast<T*>(this);
   
   JsonDocument eventMessage = device->prepareEvent(FSTR_RANGE_setRangeValue, cause.c_str());
   JsonObject event_value = eventMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_value];
   event_value[FSTR_RANGE_rangeValue] = rangeValue;
-  return device->sendEvent(eventMessage);
+  bool success = device->sendEvent(eventMessage);
+  if (success) rangeValueShadow.set("", rangeValue);
+  return success;
 }
 
 /**
@@ -218,11 +226,12 @@ bool RangeController<T>::sendRangeValueEvent(int rangeValue, String cause) {
  * @param   rangeValue  value for the range
  * @param   cause       (optional) `String` reason why event is sent (default = `"PHYSICAL_INTERACTION"`)
  * @return  the success of sending the even
- * @retval  true        event has been sent successfully
+ * @retval  true        event has been sent successfully (or the range value has not changed, see `SINRICPRO_STATE_SHADOW`)
  * @retval  false       event has not been sent, maybe you sent to much events in a short distance of time
  */
 template <typename T>
 bool RangeController<T>::sendRangeValueEvent(const String& instance, int rangeValue, String cause){
+  if (rangeValueShadow.isUnchanged(instance, rangeValue)) return true;
   if (event_limiter_generic.find(instance) == event_limiter_generic.end()) event_limiter_generic[instance] = EventLimiter(EVENT_LIMIT_STATE);
   if (event_limiter_generic[instance]) return false;
   T* device = static_cast<T*>(this);
@@ -232,11 +241,14 @@ bool RangeController<T>::sendRangeValueEvent(const String& instance, int rangeVa
 
   JsonObject event_value = eventMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_value];
   event_value[FSTR_RANGE_rangeValue] = rangeValue;
-  return device->sendEvent(eventMessage);
+  bool success = device->sendEvent(eventMessage);
+  if (success) rangeValueShadow.set(instance, rangeValue);
+  return success;
 }
 
 template <typename T>
 bool RangeController<T>::sendRangeValueEvent(const String& instance, float rangeValue, String cause) {
+  if (rangeValueShadow.isUnchanged(instance, rangeValue)) return true;
   if (event_limiter_generic.find(instance) == event_limiter_generic.end()) event_limiter_generic[instance] = EventLimiter(EVENT_LIMIT_STATE);
   if (event_limiter_generic[instance]) return false;
   T* device = static_cast<T*>(this);
@@ -246,7 +258,9 @@ bool RangeController<T>::sendRangeValueEvent(const String& instance, float range
 
   JsonObject event_value = eventMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_value];
   event_value[FSTR_RANGE_rangeValue] = rangeValue;
-  return device->sendEvent(eventMessage);
+  bool success = device->sendEvent(eventMessage);
+  if (success) rangeValueShadow.set(instance, rangeValue);
+  return success;
 }
 
 template <typename T>
@@ -262,6 +276,7 @@ bool RangeController<T>::handleRangeController(SinricProRequest &request) {
       int rangeValue = request.request_value[FSTR_RANGE_rangeValue];
       if (setRangeValueCallback) success = setRangeValueCallback(device->deviceId, rangeValue);
       request.response_value[FSTR_RANGE_rangeValue] = rangeValue;
+      if (success) rangeValueShadow.set("", rangeValue);
       return success;
 
     } else {
@@ -274,6 +289,7 @@ bool RangeController<T>::handleRangeController(SinricProRequest &request) {
         float value = request.request_value[FSTR_RANGE_rangeValue];
         success = cb.cb_float(device->deviceId, request.instance, value);
         request.response_value[FSTR_RANGE_rangeValue] = value;
+        if (success) rangeValueShadow.set(request.instance, value);
         return success;
       }
 
@@ -281,6 +297,7 @@ bool RangeController<T>::handleRangeController(SinricProRequest &request) {
         int value = request.request_value[FSTR_RANGE_rangeValue];
         success = cb.cb_int(device->deviceId, request.instance, value);
         request.response_value[FSTR_RANGE_rangeValue] = value;
+        if (success) rangeValueShadow.set(request.instance, value);
         return success;
       }
     }
@@ -291,27 +308,40 @@ bool RangeController<T>::handleRangeController(SinricProRequest &request) {
     if (request.instance == "") {
 
       int rangeValue = request.request_value[FSTR_RANGE_rangeValueDelta];
-      if (adjustRangeValueCallback) success = adjustRangeValueCallback(device->deviceId, rangeValue);
+      if (adjustRangeValueCallback) {
+        success = adjustRangeValueCallback(device->deviceId, rangeValue);
+      } else if (setRangeValueCallback && rangeValueShadow.isKnown("")) {  // resolve against the last known range value
+        rangeValue += (int)rangeValueShadow.get("");
+        success = setRangeValueCallback(device->deviceId, rangeValue);
+      }
       request.response_value[FSTR_RANGE_rangeValue] = rangeValue;
+      if (success) rangeValueShadow.set("", rangeValue);
       return success;
 
     } else {
 
-      if (genericAdjustRangeValueCallback.find(request.instance) == genericAdjustRangeValueCallback.end()) return false;
+      bool resolve = genericAdjustRangeValueCallback.find(request.instance) == genericAdjustRangeValueCallback.end();
+      if (resolve && (genericSetRangeValueCallback.find(request.instance) == genericSetRangeValueCallback.end() || !rangeValueShadow.isKnown(request.instance))) return false;
 
-      auto& cb = genericAdjustRangeValueCallback[request.instance];
+      // without an adjust callback the delta is resolved against the last known range value
+      auto& cb = resolve ? genericSetRangeValueCallback[request.instance] : genericAdjustRangeValueCallback[request.instance];
+      float lastValue = resolve ? rangeValueShadow.get(request.instance) : 0;
 
       if (cb.type == GenericRangeValueCallback::type_float) {
         float value = request.request_value[FSTR_RANGE_rangeValueDelta];
+        value += lastValue;
         success = cb.cb_float(device->deviceId, request.instance, value);
         request.response_value[FSTR_RANGE_rangeValue] = value;
+        if (success) rangeValueShadow.set(request.instance, value);
         return success;
       }
 
       if (cb.type == GenericRangeValueCallback::type_int) {
         int value = request.request_value[FSTR_RANGE_rangeValueDelta];
+        value += (int)lastValue;
         success = cb.cb_int(device->deviceId, request.instance, value);
         request.response_value[FSTR_RANGE_rangeValue] = value;
+        if (success) rangeValueShadow.set(request.instance, value);
         return success;
       }
     }
@@ -320,6 +350,17 @@ bool RangeController<T>::handleRangeController(SinricProRequest &request) {
   return false;
 }
 
+template <typename T>
+void RangeController<T>::getRangeValueState(JsonObject &state) {
+  for (auto& entry : rangeValueShadow.entries()) {
+    if (entry.instance == "") {
+      state[FSTR_RANGE_rangeValue] = entry.value;
+    } else {
+      state[FSTR_RANGE_rangeValues][entry.instance] = entry.value;
+    }
+  }
+}
+
 } // SINRICPRO_NAMESPACE
 
 template <typename T>
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../EventLimiter.h"
+#include "../ReportingPolicy.h"
 #include "../SinricProStrings.h"
 
 #include "../SinricProNamespace.h"
@@ -19,8 +20,13 @@ class TemperatureSensor {
   public:
     TemperatureSensor();
     bool sendTemperatureEvent(float temperature, float humidity = -1, String cause = FSTR_SINRICPRO_PERIODIC_POLL);
+
+    void setTemperatureDeadband(float absolute, float relative = 0);
+    void setHumidityDeadband(float absolute, float relative = 0);
+    void setTemperatureHeartbeat(unsigned long interval);
   private:
     EventLimiter event_limiter;
+    ReportingPolicy<2> reporting_policy;  // temperature, humidity
 };
 
 template <typename T>
@@ -34,11 +40,14 @@ TemperatureSensor<T>::TemperatureSensor()
  * @param   humidity      `float` (optional) actual humidity measured by a sensor (default=-1.0f means not supported)
  * @param   cause         (optional) `String` reason why event is sent (default = `"PERIODIC_POLL"`)
  * @return  the success of sending the even
- * @retval  true          event has been sent successfully
+ * @retval  true          event has been sent successfully (or the reading is not worth a report, see `ReportingPolicy`)
  * @retval  false         event has not been sent, maybe you sent to much events in a short distance of time
  **/
 template <typename T>
 bool TemperatureSensor<T>::sendTemperatureEvent(float temperature, float humidity, String cause) {
+  float values[] = {temperature, humidity};
+  if (!reporting_policy.shouldReport(values)) return true;
+  if (reporting_policy.isEnabled() && event_limiter.isLimited()) return false;  // stays pending until the limiter allows it
   if (event_limiter) return false;
   T* device = static_cast<T*>(this);
 
@@ -46,7 +55,49 @@ bool TemperatureSensor<T>::sendTemperatureEvent(float temperature, float humidit
   JsonObject event_value = eventMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_value];
   event_value[FSTR_TEMPERATURE_humidity] = roundf(humidity * 100) / 100.0;
   event_value[FSTR_TEMPERATURE_temperature] = roundf(temperature * 10) / 10.0;
-  return device->sendEvent(eventMessage);
+  bool success = device->sendEvent(eventMessage);
+  if (success) reporting_policy.reported(values);
+  return success;
+}
+
+/**
+ * @brief Only report temperatures which differ from the last reported temperature by a minimum amount
+ * 
+ * @param   absolute      minimum change in degrees (0 = not used)
+ * @param   relative      (optional) minimum change relative to the last reported temperature (eg. `0.05` = 5%)
+ * @section setTemperatureDeadband Example-Code
+ * @code
+ * mySensor.setTemperatureDeadband(0.5);         // report changes of 0.5 degrees or more
+ * mySensor.setHumidityDeadband(2);              // report changes of 2% humidity or more
+ * mySensor.setTemperatureHeartbeat(15 * 60000); // report at least every 15 minutes
+ * ..
+ * mySensor.sendTemperatureEvent(dht.readTemperature(), dht.readHumidity()); // call as often as you like
+ * @endcode
+ **/
+template <typename T>
+void TemperatureSensor<T>::setTemperatureDeadband(float absolute, float relative) {
+  reporting_policy.setDeadband(0, absolute, relative);
+}
+
+/**
+ * @brief Only report humidities which differ from the last reported humidity by a minimum amount
+ * 
+ * @param   absolute      minimum change in percent (0 = not used)
+ * @param   relative      (optional) minimum change relative to the last reported humidity (eg. `0.05` = 5%)
+ **/
+template <typename T>
+void TemperatureSensor<T>::setHumidityDeadband(float absolute, float relative) {
+  reporting_policy.setDeadband(1, absolute, relative);
+}
+
+/**
+ * @brief Report the temperature at least every `interval` ms, even if it has not changed
+ * 
+ * @param   interval      maximum time between two reports in ms (0 = no heartbeat)
+ **/
+template <typename T>
+void TemperatureSensor<T>::setTemperatureHeartbeat(unsigned long interval) {
+  reporting_policy.setHeartbeat(interval);
 }
 
 } // SINRICPRO_NAMESPACE
@@ -3,6 +3,7 @@
 #include "../SinricProRequest.h"
 #include "../EventLimiter.h"
 #include "../SinricProStrings.h"
+#include "../StateShadow.h"
 
 #include "../SinricProNamespace.h"
 namespace SINRICPRO_NAMESPACE {
@@ -62,11 +63,13 @@ class VolumeController {
 
   protected:
     bool handleVolumeController(SinricProRequest &request);
+    void getVolumeState(JsonObject &state);
 
   private:
     EventLimiter event_limiter;
     SetVolumeCallback volumeCallback;
     AdjustVolumeCallback adjustVolumeCallback;
+    StateShadow<int> volumeShadow;
 };
 
 template <typename T>
@@ -74,6 +77,7 @@ VolumeController<T>::VolumeController()
 : event_limiter(EVENT_LIMIT_STATE) { 
   T* device = static_cast<T*>(this);
   device->registerRequestHandler(std::bind(&VolumeController<T>::handleVolumeController, this, std::placeholders::_1)); 
+  device->registerStateHandler(std::bind(&VolumeController<T>::getVolumeState, this, std::placeholders::_1));
 }
 
 /**
@@ -89,6 +93,8 @@ void VolumeController<T>::onSetVolume(SetVolumeCallback cb) { volumeCallback = c
 /**
  * @brief Set callback function for `adjustVolume` request
  * 
+ * Without this callback and with `SINRICPRO_STATE_SHADOW` defined, `adjustVolume` requests are resolved
+ * against the last known volume and passed to the `onSetVolume` callback.
  * @param cb Function pointer to a `AdjustVolumeCallback` function
  * @return void
  * @see AdjustVolumeCallback
@@ -102,18 +108,21 @@ void VolumeController<T>::onAdjustVolume(AdjustVolumeCallback cb) { adjustVolume
  * @param   volume        Integer reporting the volume that the device have been set to
  * @param   cause         (optional) Reason why event is sent (default = `"PHYSICAL_INTERACTION"`)
  * @return  the success of sending the event
- * @retval  true          event has been sent successfully
+ * @retval  true          event has been sent successfully (or the volume has not changed, see `SINRICPRO_STATE_SHADOW`)
  * @retval  false         event has not been sent, maybe you sent to much events in a short distance of time
  **/
 template <typename T>
 bool VolumeController<T>::sendVolumeEvent(int volume, String cause) {
+  if (volumeShadow.isUnchanged(volume)) return true;
   if (event_limiter) return false;
   T* device = static_cast<T*>(this);
 
   JsonDocument eventMessage = device->prepareEvent(FSTR_VOLUME_setVolume, cause.c_str());
   JsonObject event_value = eventMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_value];
   event_value[FSTR_VOLUME_volume] = volume;
-  return device->sendEvent(eventMessage);
+  bool success = device->sendEvent(eventMessage);
+  if (success) volumeShadow.set(volume);
+  return success;
 }
 
 template <typename T>
@@ -126,6 +135,7 @@ bool VolumeController<T>::handleVolumeController(SinricProRequest &request) {
     int volume = request.request_value[FSTR_VOLUME_volume];
     success = volumeCallback(device->deviceId, volume);
     request.response_value[FSTR_VOLUME_volume] = volume;
+    if (success) volumeShadow.set(volume);
     return success;
   }
 
@@ -134,11 +144,26 @@ bool VolumeController<T>::handleVolumeController(SinricProRequest &request) {
     bool volumeDefault = request.request_value[FSTR_VOLUME_volumeDefault] | false;
     success = adjustVolumeCallback(device->deviceId, volume, volumeDefault);
     request.response_value[FSTR_VOLUME_volume] = volume;
+    if (success) volumeShadow.set(volume);
+    return success;
+  }
+
+  if (volumeCallback && volumeShadow.isKnown() && request.action == FSTR_VOLUME_adjustVolume) {  // resolve against the last known volume
+    int volumeDelta = request.request_value[FSTR_VOLUME_volume];
+    int volume = constrain(volumeShadow.get() + volumeDelta, 0, 100);
+    success = volumeCallback(device->deviceId, volume);
+    request.response_value[FSTR_VOLUME_volume] = volume;
+    if (success) volumeShadow.set(volume);
     return success;
   }
   return success;
 }
 
+template <typename T>
+void VolumeController<T>::getVolumeState(JsonObject &state) {
+  if (volumeShadow.isKnown()) state[FSTR_VOLUME_volume] = volumeShadow.get();
+}
+
 } // SINRICPRO_NAMESPACE
 
 template <typename T>
@@ -0,0 +1,309 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <functional>
+#include <limits.h>
+#include <vector>
+
+#include "SinricProConfig.h"
+#include "SinricProDebug.h"
+#include "SinricProNamespace.h"
+#include "RequestCoalescer.h"
+#include "SinricProQueue.h"
+#include "SinricProStrings.h"
+#include "StateShadow.h"
+namespace SINRICPRO_NAMESPACE {
+
+class DeferredResponseManager;
+
+/**
+ * @brief Handle to a response that is sent later (see `SinricProClass::deferResponse()`)
+ *
+ * A default constructed handle is not bound to any request. All functions are safe to call on an unbound,
+ * completed or timed out handle.
+ */
+class DeferredResponse {
+  public:
+    DeferredResponse(DeferredResponseManager* manager = nullptr, uint32_t id = 0);
+
+    bool       isPending() const;
+    JsonObject value();
+    bool       complete(bool success, const String& message = "");
+
+  protected:
+    DeferredResponseManager* manager;
+    uint32_t                 id;
+};
+
+/**
+ * @brief Called with the final response of a deferred request and the requests coalesced into it (the responses still have to be sent)
+ */
+using DeferredSendHandler = std::function<void(JsonDocument& responseMessage, const MessageRoute& route, uint32_t traceId, const std::vector<CoalescedReply>& coalesced)>;
+
+/**
+ * @brief Keeps deferred responses until they get completed or time out
+ */
+class DeferredResponseManager {
+  public:
+    DeferredResponseManager();
+
+    void             onSend(DeferredSendHandler cb);
+    void             requestStarted();
+    DeferredResponse defer(unsigned long timeout);
+    bool             store(JsonDocument& responseMessage, const MessageRoute& route, uint32_t traceId, const std::vector<CoalescedReply>& coalesced, bool success);
+    void             handle();
+    unsigned long    nextTimeoutIn() const;
+
+    bool       isPending(uint32_t id) const;
+    JsonObject value(uint32_t id);
+    bool       complete(uint32_t id, bool success, const String& message);
+
+  protected:
+    struct Entry {
+        uint32_t      id;
+        JsonDocument  responseMessage;
+        MessageRoute  route;
+        uint32_t      traceId;
+        std::vector<CoalescedReply> coalesced;  // requests merged into this request, answered with the same response
+        unsigned long deferredAt;
+        unsigned long timeout;
+        bool          stored;     // response message has been built
+        bool          completed;  // completed before the response message was built
+        bool          success;
+        String        message;
+#ifdef SINRICPRO_STATE_SHADOW
+        StateShadowUpdates shadowUpdates;  // applied if the response succeeds
+#endif
+    };
+
+    Entry*       find(uint32_t id);
+    const Entry* find(uint32_t id) const;
+    void         send(Entry& entry, bool success, const String& message);
+    void         release(Entry& entry);
+
+    Entry               entries[SINRICPRO_DEFERRED_SIZE];
+    Entry*              deferring;  // entry created by the callback of the current request
+    bool                accepting;  // a device callback is running
+    uint32_t            nextId;
+    DeferredSendHandler _sendCb;
+};
+
+DeferredResponse::DeferredResponse(DeferredResponseManager* manager, uint32_t id)
+    : manager(manager)
+    , id(id) {}
+
+/**
+ * @brief `true` until the response has been completed or has timed out
+ */
+bool DeferredResponse::isPending() const {
+    return manager && manager->isPending(id);
+}
+
+/**
+ * @brief The value of the response (eg. `value()["state"] = "LOCKED"`) to report the final state
+ * @return a null `JsonObject` if the response is not pending anymore
+ */
+JsonObject DeferredResponse::value() {
+    return manager ? manager->value(id) : JsonObject();
+}
+
+/**
+ * @brief Send the response
+ *
+ * @param success `true` if the request has been executed successfully
+ * @param message error message for the user (only used if `success` is `false`)
+ * @return `false` if the response is not pending anymore (already completed or timed out)
+ */
+bool DeferredResponse::complete(bool success, const String& message) {
+    return manager && manager->complete(id, success, message);
+}
+
+DeferredResponseManager::DeferredResponseManager()
+    : entries()
+    , deferring(nullptr)
+    , accepting(false)
+    , nextId(1)
+    , _sendCb(nullptr) {}
+
+void DeferredResponseManager::onSend(DeferredSendHandler cb) {
+    _sendCb = cb;
+}
+
+/**
+ * @brief Must be called right before a device callback is called
+ */
+void DeferredResponseManager::requestStarted() {
+    accepting = true;
+    deferring = nullptr;
+#ifdef SINRICPRO_STATE_SHADOW
+    deferredShadowUpdates() = nullptr;
+#endif
+}
+
+/**
+ * @brief Defer the response of the current request (called from a device callback)
+ * @return unbound handle if no request is in progress or all `SINRICPRO_DEFERRED_SIZE` entries are in use
+ */
+DeferredResponse DeferredResponseManager::defer(unsigned long timeout) {
+    if (!accepting) {
+        DEBUG_SINRIC("[SinricPro:DeferredResponse]: deferResponse() must be called from a device callback\r\n");
+        return DeferredResponse();
+    }
+    if (deferring) return DeferredResponse(this, deferring->id);
+
+    for (auto& entry : entries) {
+        if (entry.id) continue;
+        entry.id         = nextId++;
+        entry.deferredAt = millis();
+        entry.timeout    = timeout;
+        entry.stored     = false;
+        entry.completed  = false;
+        if (!nextId) nextId = 1;
+        deferring = &entry;
+#ifdef SINRICPRO_STATE_SHADOW
+        deferredShadowUpdates() = &entry.shadowUpdates;  // the capability updates the shadow after the callback returns
+#endif
+        return DeferredResponse(this, entry.id);
+    }
+
+    DEBUG_SINRIC("[SinricPro:DeferredResponse]: too many deferred responses, responding immediately\r\n");
+    return DeferredResponse();
+}
+
+/**
+ * @brief Keep the response of the current request if the callback deferred it
+ *
+ * A callback that deferred the response and returned `false` is answered right away with failure.
+ * @return `true` if the response has been deferred (don't send it now)
+ */
+bool DeferredResponseManager::store(JsonDocument& responseMessage, const MessageRoute& route, uint32_t traceId, const std::vector<CoalescedReply>& coalesced, bool success) {
+    accepting    = false;
+    Entry* entry = deferring;
+    deferring    = nullptr;
+#ifdef SINRICPRO_STATE_SHADOW
+    deferredShadowUpdates() = nullptr;
+#endif
+    if (!entry) return false;
+    if (!success) {
+        DEBUG_SINRIC("[SinricPro:DeferredResponse]: callback failed, deferred response dropped\r\n");
+        release(*entry);
+        return false;
+    }
+
+    entry->responseMessage = responseMessage;
+    entry->route           = route;
+    entry->traceId         = traceId;
+    entry->coalesced       = coalesced;
+    entry->stored          = true;
+    DEBUG_SINRIC("[SinricPro:DeferredResponse]: response deferred for %lu ms\r\n", entry->timeout);
+
+    if (entry->completed) send(*entry, entry->success, entry->message);  // completed within the callback
+    return true;
+}
+
+/**
+ * @brief Respond with failure to deferred requests which have not been completed in time
+ */
+void DeferredResponseManager::handle() {
+    unsigned long currentMillis = millis();
+    for (auto& entry : entries) {
+        if (!entry.id || !entry.stored) continue;
+        if (currentMillis - entry.deferredAt < entry.timeout) continue;
+        DEBUG_SINRIC("[SinricPro:DeferredResponse]: deferred response timed out\r\n");
+        send(entry, false, "Request timed out");
+    }
+}
+
+/**
+ * @brief Time in milliseconds until the next deferred response times out
+ * @return `ULONG_MAX` if no response is deferred
+ */
+unsigned long DeferredResponseManager::nextTimeoutIn() const {
+    unsigned long result        = ULONG_MAX;
+    unsigned long currentMillis = millis();
+    for (auto& entry : entries) {
+        if (!entry.id || !entry.stored) continue;
+        unsigned long elapsed = currentMillis - entry.deferredAt;
+        unsigned long remain  = elapsed >= entry.timeout ? 0 : entry.timeout - elapsed;
+        if (remain < result) result = remain;
+    }
+    return result;
+}
+
+bool DeferredResponseManager::isPending(uint32_t id) const {
+    const Entry* entry = find(id);
+    return entry && !entry->completed;
+}
+
+JsonObject DeferredResponseManager::value(uint32_t id) {
+    Entry* entry = find(id);
+    if (!entry || !entry->stored) return JsonObject();
+    return entry->responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_value];
+}
+
+bool DeferredResponseManager::complete(uint32_t id, bool success, const String& message) {
+    Entry* entry = find(id);
+    if (!entry || entry->completed) return false;
+
+    if (!entry->stored) {  // still inside the callback, response is sent by store()
+        entry->completed = true;
+        entry->success   = success;
+        entry->message   = message;
+        return true;
+    }
+    send(*entry, success, message);
+    return true;
+}
+
+DeferredResponseManager::Entry* DeferredResponseManager::find(uint32_t id) {
+    if (!id) return nullptr;
+    for (auto& entry : entries) {
+        if (entry.id == id) return &entry;
+    }
+    return nullptr;
+}
+
+const DeferredResponseManager::Entry* DeferredResponseManager::find(uint32_t id) const {
+    if (!id) return nullptr;
+    for (auto& entry : entries) {
+        if (entry.id == id) return &entry;
+    }
+    return nullptr;
+}
+
+void DeferredResponseManager::send(Entry& entry, bool success, const String& message) {
+    JsonObject payload              = entry.responseMessage[FSTR_SINRICPRO_payload];
+    payload[FSTR_SINRICPRO_success] = success;
+    payload[FSTR_SINRICPRO_message] = success ? String(FSTR_SINRICPRO_OK) : message.length() ? message : String("Request failed");
+
+#ifdef SINRICPRO_STATE_SHADOW
+    if (success) {
+        StateShadowUpdates* collecting = deferredShadowUpdates();
+        deferredShadowUpdates()        = nullptr;  // completed from within the callback of another request
+        for (auto& update : entry.shadowUpdates) update();
+        deferredShadowUpdates() = collecting;
+    }
+#endif
+    if (_sendCb) _sendCb(entry.responseMessage, entry.route, entry.traceId, entry.coalesced);
+    release(entry);
+}
+
+void DeferredResponseManager::release(Entry& entry) {
+    entry.id = 0;
+    entry.responseMessage.clear();
+    entry.coalesced.clear();
+    entry.message = "";
+#ifdef SINRICPRO_STATE_SHADOW
+    entry.shadowUpdates.clear();
+#endif
+}
+
+}  // namespace SINRICPRO_NAMESPACE
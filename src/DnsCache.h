@@ -0,0 +1,85 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#if defined(ESP8266)
+    #include <ESP8266WiFi.h>
+#elif defined(ESP32) || defined(ARDUINO_ARCH_RP2040)
+    #include <WiFi.h>
+#endif
+
+#include "SinricProConfig.h"
+#include "SinricProDebug.h"
+#include "SinricProNamespace.h"
+namespace SINRICPRO_NAMESPACE {
+
+/**
+ * @brief Remembers the last resolved server address for `ttl` milliseconds
+ */
+class DnsCache {
+  public:
+    DnsCache(unsigned long ttl = SINRICPRO_DNS_CACHE_TTL);
+
+    bool      resolve(const String& host, IPAddress& address);
+    void      invalidate();
+    bool      isValid(const String& host) const;
+    IPAddress getAddress() const;
+
+  protected:
+    unsigned long ttl;
+    String        host;
+    IPAddress     address;
+    unsigned long resolvedAt;
+    bool          valid;
+};
+
+DnsCache::DnsCache(unsigned long ttl)
+    : ttl(ttl)
+    , resolvedAt(0)
+    , valid(false) {}
+
+/**
+ * @brief Resolve `host`, using the cached address while it is valid
+ *
+ * @param host hostname to resolve
+ * @param[out] address resolved address
+ * @return `true` if the host could be resolved, `false` otherwise
+ */
+bool DnsCache::resolve(const String& host, IPAddress& address) {
+    if (isValid(host)) {
+        address = this->address;
+        return true;
+    }
+
+    if (!WiFi.hostByName(host.c_str(), address)) {
+        DEBUG_SINRIC("[SinricPro:DnsCache]: unable to resolve \"%s\"\r\n", host.c_str());
+        valid = false;
+        return false;
+    }
+
+    DEBUG_SINRIC("[SinricPro:DnsCache]: \"%s\" resolved to %s\r\n", host.c_str(), address.toString().c_str());
+    this->host    = host;
+    this->address = address;
+    resolvedAt    = millis();
+    valid         = true;
+    return true;
+}
+
+void DnsCache::invalidate() {
+    valid = false;
+}
+
+bool DnsCache::isValid(const String& host) const {
+    return valid && this->host == host && millis() - resolvedAt < ttl;
+}
+
+IPAddress DnsCache::getAddress() const {
+    return address;
+}
+
+}  // namespace SINRICPRO_NAMESPACE
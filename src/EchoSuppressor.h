@@ -0,0 +1,138 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "FastPublish.h"
+#include "SinricProConfig.h"
+#include "SinricProDebug.h"
+#include "SinricProNamespace.h"
+#include "SinricProStrings.h"
+namespace SINRICPRO_NAMESPACE {
+
+/**
+ * @brief Suppresses events which only repeat the state of a response that has just been sent
+ *
+ * Sketches often send an event (eg. `sendPowerStateEvent`) from or right after the callback which already
+ * answered the request with the same state. The server knows that state from the response, so an identical event
+ * for the same device, instance and action is dropped if it is sent within `SINRICPRO_ECHO_WINDOW` ms.
+ * While the callback runs, the requested state is expected instead, so events sent from the callback are covered too.
+ * Events with a different value are always sent.
+ */
+class EchoSuppressor {
+  public:
+    EchoSuppressor();
+
+    void     expect(JsonDocument& requestMessage);
+    void     forget(JsonDocument& message);
+    void     responded(JsonDocument& responseMessage);
+    bool     isEcho(JsonDocument& event);
+    uint32_t getSuppressedCount() const;
+
+  protected:
+    struct Response {
+        uint32_t      key;
+        uint32_t      value;
+        unsigned long respondedAt;
+        bool          used;
+    };
+
+    void      remember(uint32_t key, uint32_t value);
+    Response* find(uint32_t key);
+
+    Response responses[SINRICPRO_ECHO_TABLE_SIZE];
+    uint8_t  nextSlot;
+    uint32_t suppressed;
+};
+
+EchoSuppressor::EchoSuppressor()
+    : responses()
+    , nextSlot(0)
+    , suppressed(0) {}
+
+/**
+ * @brief Expect the requested state while the callback of a request runs (called before the callback)
+ */
+void EchoSuppressor::expect(JsonDocument& requestMessage) {
+    if (SINRICPRO_ECHO_WINDOW == 0) return;
+    remember(FastPublish::keyOf(requestMessage), FastPublish::valueOf(requestMessage));
+}
+
+/**
+ * @brief Drop the expected state after the callback returned (replaced by the state of the response)
+ */
+void EchoSuppressor::forget(JsonDocument& message) {
+    if (SINRICPRO_ECHO_WINDOW == 0) return;
+    Response* entry = find(FastPublish::keyOf(message));
+    if (entry) entry->used = false;
+}
+
+/**
+ * @brief Remember the state of a successful response
+ */
+void EchoSuppressor::responded(JsonDocument& responseMessage) {
+    if (SINRICPRO_ECHO_WINDOW == 0) return;
+    if (!(responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_success] | false)) return;
+    remember(FastPublish::keyOf(responseMessage), FastPublish::valueOf(responseMessage));
+}
+
+void EchoSuppressor::remember(uint32_t key, uint32_t value) {
+    Response* entry = find(key);
+    if (!entry) {
+        entry    = &responses[nextSlot];
+        nextSlot = (nextSlot + 1) % SINRICPRO_ECHO_TABLE_SIZE;
+    }
+
+    entry->used        = true;
+    entry->key         = key;
+    entry->value       = value;
+    entry->respondedAt = millis();
+}
+
+EchoSuppressor::Response* EchoSuppressor::find(uint32_t key) {
+    for (auto& response : responses) {
+        if (response.used && response.key == key) return &response;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Check if an event repeats a state that has just been sent in a response
+ * @return `true` if the event should be dropped
+ */
+bool EchoSuppressor::isEcho(JsonDocument& event) {
+    if (SINRICPRO_ECHO_WINDOW == 0) return false;
+
+    uint32_t      key           = FastPublish::keyOf(event);
+    unsigned long currentMillis = millis();
+    for (auto& response : responses) {
+        if (!response.used || response.key != key) continue;
+        if (currentMillis - response.respondedAt >= SINRICPRO_ECHO_WINDOW) {
+            response.used = false;
+            return false;
+        }
+        if (response.value != FastPublish::valueOf(event)) {  // state has changed since the response
+            response.used = false;
+            return false;
+        }
+        suppressed++;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Number of events that have been suppressed
+ */
+uint32_t EchoSuppressor::getSuppressedCount() const {
+    return suppressed;
+}
+
+}  // namespace SINRICPRO_NAMESPACE
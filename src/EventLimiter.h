@@ -9,6 +9,7 @@ class EventLimiter {
   public:
     EventLimiter(unsigned long minimum_distance = 1000);
     operator bool();
+    bool isLimited() const;
   private:
     unsigned long minimum_distance;
     unsigned long next_event;
@@ -50,4 +51,11 @@ EventLimiter::operator bool() {
   return true;
 }
 
+/**
+ * @brief Check if an event would be limited right now (without counting it as an attempt)
+ */
+bool EventLimiter::isLimited() const {
+  return millis() < next_event;
+}
+
 } // SINRICPRO_NAMESPACE
\ No newline at end of file
@@ -0,0 +1,241 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <sys/time.h>
+
+#include <atomic>
+#include <vector>
+
+#include "SinricProConfig.h"
+#include "SinricProDebug.h"
+#include "SinricProNamespace.h"
+#include "SinricProStrings.h"
+#include "Timestamp.h"
+namespace SINRICPRO_NAMESPACE {
+
+static const uint32_t FAST_PUBLISH_MAGIC = 0x53504650;
+
+/**
+ * @brief Data kept in RTC memory while the device is in deep sleep
+ */
+struct FastPublishData {
+    uint32_t magic;
+    uint32_t sleepMs;                                          // ESP8266: planned sleep duration
+    uint64_t clock;                                            // ESP8266: unix time in ms when going to sleep, ESP32: unix time in ms - system time in ms
+    uint32_t stateKeys[SINRICPRO_FAST_PUBLISH_STATE_COUNT];    // hash of deviceId, instanceId and action
+    uint32_t stateValues[SINRICPRO_FAST_PUBLISH_STATE_COUNT];  // hash of the reported value
+    uint32_t checksum;
+};
+
+#if defined(ESP32)
+static RTC_DATA_ATTR FastPublishData rtcFastPublishData;
+#endif
+
+/**
+ * @brief Keeps the clock and the last acknowledged states across deep sleep
+ *
+ * ESP32 keeps the system time during deep sleep, so the clock is restored for every wakeup cause.
+ * ESP8266 loses its clock and only the timer wakeup can be restored (using the planned sleep duration).
+ * RP2040 has no memory that survives deep sleep, so nothing gets restored.
+ *
+ * Except for begin() and save(), all functions are called from the side sending the events (the network side if
+ * `SINRICPRO_NETWORK_TASK` is defined).
+ */
+class FastPublish {
+  public:
+    FastPublish();
+
+    void begin(Timestamp& timestamp);
+    bool isEnabled() const;
+    void save(Timestamp& timestamp, uint32_t sleepMs);
+
+    void sent(JsonDocument& event);
+    void acknowledged(const String& replyToken, bool success);
+    bool isIdle() const;
+
+    static uint32_t keyOf(JsonDocument& message);
+    static uint32_t valueOf(JsonDocument& message);
+    static uint32_t hash(const char* data, size_t length, uint32_t seed = 2166136261UL);
+
+  protected:
+    struct PendingReport {
+        String   replyToken;
+        uint32_t key;
+        uint32_t value;
+    };
+
+    bool load();
+    void store();
+    void restore(Timestamp& timestamp);
+
+    static uint64_t systemTimeMs();
+
+    FastPublishData            data;
+    std::vector<PendingReport> pending;  // one entry per sent event waiting for its response
+    std::atomic<bool>          enabled;
+};
+
+FastPublish::FastPublish()
+    : data()
+    , pending()
+    , enabled(false) {}
+
+/**
+ * @brief Enable fast publish and restore clock and states from RTC memory
+ */
+void FastPublish::begin(Timestamp& timestamp) {
+    restore(timestamp);
+    enabled = true;  // the data is complete before the sending side sees it
+}
+
+void FastPublish::restore(Timestamp& timestamp) {
+    if (!load()) {
+        DEBUG_SINRIC("[SinricPro:FastPublish]: no data in RTC memory\r\n");
+        data       = FastPublishData();
+        data.magic = FAST_PUBLISH_MAGIC;
+        return;
+    }
+    if (!data.clock) return;
+
+#if defined(ESP32)
+    timestamp.setTimestampMs(data.clock + systemTimeMs());
+#elif defined(ESP8266)
+    if (ESP.getResetInfoPtr()->reason != REASON_DEEP_SLEEP_AWAKE) return;  // sleep duration is unknown
+    timestamp.setTimestampMs(data.clock + data.sleepMs + millis());
+#endif
+    DEBUG_SINRIC("[SinricPro:FastPublish]: clock restored (%lu)\r\n", (unsigned long)timestamp.getTimestamp());
+}
+
+bool FastPublish::isEnabled() const {
+    return enabled;
+}
+
+/**
+ * @brief Store clock and states in RTC memory
+ * @param sleepMs planned sleep duration in ms (only used on ESP8266)
+ */
+void FastPublish::save(Timestamp& timestamp, uint32_t sleepMs) {
+    uint64_t now = timestamp.getTimestampMs();
+#if defined(ESP32)
+    data.clock = now ? now - systemTimeMs() : 0;
+#else
+    data.clock = now;
+#endif
+    data.sleepMs = sleepMs;
+    store();
+}
+
+/**
+ * @brief Remember a sent event until its response arrives (a retransmission updates the existing entry)
+ */
+void FastPublish::sent(JsonDocument& event) {
+    String replyToken = event[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_replyToken] | "";
+    for (auto& report : pending) {
+        if (report.replyToken != replyToken) continue;
+        report.key   = keyOf(event);
+        report.value = valueOf(event);
+        return;
+    }
+    pending.push_back({replyToken, keyOf(event), valueOf(event)});
+}
+
+void FastPublish::acknowledged(const String& replyToken, bool success) {
+    for (auto it = pending.begin(); it != pending.end(); ++it) {
+        if (it->replyToken != replyToken) continue;
+        PendingReport report = *it;
+        pending.erase(it);
+        if (!success) return;
+
+        // replace the entry for the same key, otherwise the oldest entry
+        size_t index = SINRICPRO_FAST_PUBLISH_STATE_COUNT - 1;
+        for (size_t i = 0; i < SINRICPRO_FAST_PUBLISH_STATE_COUNT; i++) {
+            if (data.stateKeys[i] == report.key) {
+                index = i;
+                break;
+            }
+        }
+        for (size_t i = index; i > 0; i--) {
+            data.stateKeys[i]   = data.stateKeys[i - 1];
+            data.stateValues[i] = data.stateValues[i - 1];
+        }
+        data.stateKeys[0]   = report.key;
+        data.stateValues[0] = report.value;
+        return;
+    }
+}
+
+/**
+ * @brief `true` if no sent event is waiting for its response
+ */
+bool FastPublish::isIdle() const {
+    return pending.empty();
+}
+
+bool FastPublish::load() {
+#if defined(ESP8266)
+    if (!ESP.rtcUserMemoryRead(SINRICPRO_FAST_PUBLISH_RTC_OFFSET, (uint32_t*)&data, sizeof(data))) return false;
+#elif defined(ESP32)
+    data = rtcFastPublishData;
+#else
+    return false;
+#endif
+    return data.magic == FAST_PUBLISH_MAGIC && data.checksum == hash((const char*)&data, offsetof(FastPublishData, checksum));
+}
+
+void FastPublish::store() {
+    data.magic    = FAST_PUBLISH_MAGIC;
+    data.checksum = hash((const char*)&data, offsetof(FastPublishData, checksum));
+#if defined(ESP8266)
+    ESP.rtcUserMemoryWrite(SINRICPRO_FAST_PUBLISH_RTC_OFFSET, (uint32_t*)&data, sizeof(data));
+#elif defined(ESP32)
+    rtcFastPublishData = data;
+#endif
+}
+
+// FNV-1a
+uint32_t FastPublish::hash(const char* data, size_t length, uint32_t seed) {
+    uint32_t result = seed;
+    for (size_t i = 0; i < length; i++) {
+        result ^= (uint8_t)data[i];
+        result *= 16777619UL;
+    }
+    return result;
+}
+
+/**
+ * @brief Hash of deviceId, instanceId and action of an event or response
+ */
+uint32_t FastPublish::keyOf(JsonDocument& message) {
+    String   deviceId   = message[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_deviceId] | "";
+    String   instanceId = message[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_instanceId] | "";
+    String   action     = message[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_action] | "";
+    uint32_t result     = hash(deviceId.c_str(), deviceId.length());
+    result              = hash(instanceId.c_str(), instanceId.length(), result);
+    return hash(action.c_str(), action.length(), result);
+}
+
+/**
+ * @brief Hash of the value of an event or response
+ */
+uint32_t FastPublish::valueOf(JsonDocument& message) {
+    String value;
+    serializeJson(message[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_value], value);
+    return hash(value.c_str(), value.length());
+}
+
+uint64_t FastPublish::systemTimeMs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return uint64_t(tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+}
+
+}  // namespace SINRICPRO_NAMESPACE
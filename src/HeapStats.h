@@ -0,0 +1,104 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "SinricProConfig.h"
+#include "SinricProNamespace.h"
+namespace SINRICPRO_NAMESPACE {
+
+/**
+ * @brief Heap usage of the websocket connection
+ *
+ * All values are in bytes. "free" is the total free heap, "block" the largest allocatable block.
+ */
+struct HeapStats {
+    uint32_t freeBeforeHandshake  = 0;  ///< free heap right before the last connection attempt
+    uint32_t blockBeforeHandshake = 0;  ///< largest free block right before the last connection attempt
+    uint32_t freeAfterHandshake   = 0;  ///< free heap right after the connection was established
+    uint32_t blockAfterHandshake  = 0;  ///< largest free block right after the connection was established
+    uint32_t minFreeConnected     = 0;  ///< lowest free heap seen while connected
+    uint32_t minBlockConnected    = 0;  ///< smallest "largest free block" seen while connected
+};
+
+inline uint32_t getFreeHeap() {
+#if defined(ESP8266) || defined(ESP32)
+    return ESP.getFreeHeap();
+#elif defined(ARDUINO_ARCH_RP2040)
+    return rp2040.getFreeHeap();
+#else
+    return 0;
+#endif
+}
+
+inline uint32_t getMaxFreeBlock() {
+#if defined(ESP8266)
+    return ESP.getMaxFreeBlockSize();
+#elif defined(ESP32)
+    return ESP.getMaxAllocHeap();
+#else
+    return getFreeHeap();
+#endif
+}
+
+/**
+ * @brief Samples the heap around connection attempts and while the connection is established
+ */
+class HeapMonitor {
+  public:
+    HeapMonitor(unsigned long sampleInterval = SINRICPRO_HEAP_SAMPLE_INTERVAL);
+
+    void beforeHandshake();
+    void afterHandshake();
+    void sample();
+
+    const HeapStats& getStats() const;
+
+  protected:
+    unsigned long sampleInterval;
+    unsigned long lastSample;
+    HeapStats     stats;
+};
+
+HeapMonitor::HeapMonitor(unsigned long sampleInterval)
+    : sampleInterval(sampleInterval)
+    , lastSample(0) {}
+
+void HeapMonitor::beforeHandshake() {
+    stats.freeBeforeHandshake  = getFreeHeap();
+    stats.blockBeforeHandshake = getMaxFreeBlock();
+}
+
+void HeapMonitor::afterHandshake() {
+    stats.freeAfterHandshake  = getFreeHeap();
+    stats.blockAfterHandshake = getMaxFreeBlock();
+    stats.minFreeConnected    = stats.freeAfterHandshake;
+    stats.minBlockConnected   = stats.blockAfterHandshake;
+    lastSample                = millis();
+}
+
+/**
+ * @brief Update the "while connected" minimums (rate limited to one sample per `sampleInterval`)
+ */
+void HeapMonitor::sample() {
+    unsigned long currentMillis = millis();
+    if (currentMillis - lastSample < sampleInterval) return;
+    lastSample = currentMillis;
+
+    uint32_t freeHeap = getFreeHeap();
+    uint32_t maxBlock = getMaxFreeBlock();
+    if (freeHeap < stats.minFreeConnected) stats.minFreeConnected = freeHeap;
+    if (maxBlock < stats.minBlockConnected) stats.minBlockConnected = maxBlock;
+}
+
+const HeapStats& HeapMonitor::getStats() const {
+    return stats;
+}
+
+}  // namespace SINRICPRO_NAMESPACE
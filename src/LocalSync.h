@@ -0,0 +1,105 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+
+#include "FastPublish.h"
+#include "SinricProConfig.h"
+#include "SinricProDebug.h"
+#include "SinricProNamespace.h"
+#include "SinricProStrings.h"
+namespace SINRICPRO_NAMESPACE {
+
+FSTR(LOCALSYNC, adjust);                    // "adjust"
+FSTR(LOCALSYNC, set);                       // "set"
+FSTR(LOCALSYNC, adjustTargetTemperature);   // "adjustTargetTemperature"
+FSTR(LOCALSYNC, targetTemperature);         // "targetTemperature"
+FSTR(LOCALSYNC, skipChannels);              // "skipChannels"
+FSTR(LOCALSYNC, changeChannel);             // "changeChannel"
+FSTR(LOCALSYNC, increaseColorTemperature);  // "increaseColorTemperature"
+FSTR(LOCALSYNC, decreaseColorTemperature);  // "decreaseColorTemperature"
+FSTR(LOCALSYNC, setColorTemperature);       // "setColorTemperature"
+
+/**
+ * @brief Collects the state changes made by local (udp) requests while the server is not reachable
+ *
+ * Every successful local response is turned into the event which reports the new state (eg. "adjustVolume" ->
+ * "setVolume"). Only the latest state per device, instance and action is kept, at most `SINRICPRO_LOCAL_SYNC_SIZE`
+ * states (the oldest is dropped). The events are sent as soon as the server is connected again.
+ */
+class LocalSync {
+  public:
+    void record(JsonDocument& responseMessage, JsonDocument&& eventMessage);
+    bool isPending() const;
+    template <typename SendFunction>
+    void flush(SendFunction send);
+
+    static String eventAction(const String& requestAction);
+
+  protected:
+    struct Change {
+        uint32_t     key;
+        JsonDocument event;
+    };
+
+    std::vector<Change> changes;
+};
+
+/**
+ * @brief Keep the state of a successful local response
+ * @param responseMessage  the response
+ * @param eventMessage     event prepared for the device with `eventAction()` of the response action
+ */
+void LocalSync::record(JsonDocument& responseMessage, JsonDocument&& eventMessage) {
+    JsonObject response = responseMessage[FSTR_SINRICPRO_payload];
+    JsonObject payload  = eventMessage[FSTR_SINRICPRO_payload];
+    if (response[FSTR_SINRICPRO_instanceId].is<const char*>()) payload[FSTR_SINRICPRO_instanceId] = response[FSTR_SINRICPRO_instanceId];
+    payload[FSTR_SINRICPRO_value] = response[FSTR_SINRICPRO_value];
+
+    uint32_t key = FastPublish::keyOf(eventMessage);
+    for (auto& change : changes) {
+        if (change.key != key) continue;
+        change.event = std::move(eventMessage);
+        return;
+    }
+    if (changes.size() >= SINRICPRO_LOCAL_SYNC_SIZE) {
+        DEBUG_SINRIC("[SinricPro:LocalSync]: too many local changes, oldest change dropped\r\n");
+        changes.erase(changes.begin());
+    }
+    changes.push_back(Change{key, std::move(eventMessage)});
+}
+
+bool LocalSync::isPending() const {
+    return !changes.empty();
+}
+
+/**
+ * @brief Pass all collected events to `send` (in the order they have been recorded first)
+ */
+template <typename SendFunction>
+void LocalSync::flush(SendFunction send) {
+    DEBUG_SINRIC("[SinricPro:LocalSync]: sending %i local change(s)\r\n", changes.size());
+    for (auto& change : changes) send(change.event);
+    changes.clear();
+}
+
+/**
+ * @brief Action of the event which reports the state set by a request
+ */
+String LocalSync::eventAction(const String& requestAction) {
+    if (requestAction == FSTR_LOCALSYNC_adjustTargetTemperature) return FSTR_LOCALSYNC_targetTemperature;
+    if (requestAction == FSTR_LOCALSYNC_skipChannels) return FSTR_LOCALSYNC_changeChannel;
+    if (requestAction == FSTR_LOCALSYNC_increaseColorTemperature || requestAction == FSTR_LOCALSYNC_decreaseColorTemperature) return FSTR_LOCALSYNC_setColorTemperature;
+    if (requestAction.startsWith(FSTR_LOCALSYNC_adjust)) return String(FSTR_LOCALSYNC_set) + requestAction.substring(strlen(FSTR_LOCALSYNC_adjust));
+    return requestAction;
+}
+
+}  // namespace SINRICPRO_NAMESPACE
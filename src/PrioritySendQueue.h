@@ -0,0 +1,219 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <queue>
+#include <vector>
+
+#include "FastPublish.h"
+#include "SinricProConfig.h"
+#include "SinricProNamespace.h"
+#include "SinricProQueue.h"
+#include "SinricProStrings.h"
+namespace SINRICPRO_NAMESPACE {
+
+FSTR(PRIORITY, DoorbellPress);     // "DoorbellPress"
+FSTR(PRIORITY, pushNotification);  // "pushNotification"
+FSTR(PRIORITY, motion);            // "motion"
+FSTR(PRIORITY, setContactState);   // "setContactState"
+
+/**
+ * @brief Outgoing messages, served by priority
+ *
+ * Responses are sent first, then alerts, state changes and finally periodic telemetry (see `MessagePriority`).
+ * A device which has waited for `SINRICPRO_SEND_MAX_WAIT` ms is served before messages of higher priority, so
+ * a steady stream of responses can't starve telemetry. Waiting is only counted while the queue is served (from the
+ * first pop() after pause()), so messages queued while offline don't jump ahead after a reconnect.
+ * Within a priority devices are served round-robin, messages of the same device keep their order. A response does
+ * not overtake state events of its device which have been queued before it.
+ */
+class PrioritySendQueue {
+  public:
+    PrioritySendQueue();
+
+    void              push(SinricProMessage* message);
+    SinricProMessage* pop();
+    void              pause();
+    size_t            size() const;
+    bool              empty() const;
+
+    static void classify(SinricProMessage* message, JsonDocument& jsonMessage);
+
+  protected:
+    struct QueuedMessage {
+        SinricProMessage* message;
+        uint32_t          sequence;  // push order
+    };
+
+    struct DeviceQueue {
+        uint32_t                  deviceKey;
+        std::queue<QueuedMessage> messages;
+        unsigned long             waitingSince;  // millis() of the last pop, first push or start of serving
+    };
+
+    struct PriorityQueue {
+        std::vector<DeviceQueue> devices;
+        size_t                   next;   // device to serve next (round-robin)
+        size_t                   count;  // messages in all device queues
+    };
+
+    PriorityQueue*    starvingQueue(unsigned long now);
+    size_t            nextDevice(const PriorityQueue& queue) const;
+    SinricProMessage* take(PriorityQueue& queue, size_t index, unsigned long now);
+
+    PriorityQueue queues[(size_t)MessagePriority::COUNT];
+    size_t        count;
+    uint32_t      sequence;
+    bool          serving;
+};
+
+PrioritySendQueue::PrioritySendQueue()
+    : queues()
+    , count(0)
+    , sequence(0)
+    , serving(false) {}
+
+void PrioritySendQueue::push(SinricProMessage* message) {
+    PriorityQueue& queue = queues[(size_t)message->getPriority()];
+    DeviceQueue*   entry = nullptr;
+    for (auto& device : queue.devices) {
+        if (device.deviceKey == message->getDeviceKey()) entry = &device;
+    }
+    if (!entry) {
+        queue.devices.push_back(DeviceQueue{message->getDeviceKey(), {}, 0});
+        entry = &queue.devices.back();
+    }
+    if (entry->messages.empty()) entry->waitingSince = millis();
+    entry->messages.push(QueuedMessage{message, sequence++});
+    queue.count++;
+    count++;
+}
+
+/**
+ * @brief Take the next message to send
+ * @return message (owned by the caller) or `nullptr` if the queue is empty
+ */
+SinricProMessage* PrioritySendQueue::pop() {
+    if (count == 0) return nullptr;
+
+    unsigned long now = millis();
+    if (!serving) {  // the time while the queue was not served does not count as waiting
+        serving = true;
+        for (auto& queue : queues) {
+            for (auto& device : queue.devices) device.waitingSince = now;
+        }
+    }
+
+    PriorityQueue* queue = starvingQueue(now);
+    if (!queue) {
+        for (auto& candidate : queues) {
+            if (candidate.count) {
+                queue = &candidate;
+                break;
+            }
+        }
+    }
+    size_t index = nextDevice(*queue);
+
+    if (queue == &queues[(size_t)MessagePriority::response]) {  // state events queued before the response go first
+        const DeviceQueue& response   = queue->devices[index];
+        PriorityQueue&     stateQueue = queues[(size_t)MessagePriority::state];
+        for (size_t i = 0; i < stateQueue.devices.size(); i++) {
+            const DeviceQueue& state = stateQueue.devices[i];
+            if (state.deviceKey != response.deviceKey) continue;
+            if (!state.messages.empty() && (int32_t)(state.messages.front().sequence - response.messages.front().sequence) < 0) {
+                queue = &stateQueue;
+                index = i;
+            }
+            break;
+        }
+    }
+
+    count--;
+    return take(*queue, index, now);
+}
+
+/**
+ * @brief Stop serving the queue (eg. not connected), waiting is counted again from the next pop()
+ */
+void PrioritySendQueue::pause() {
+    serving = false;
+}
+
+size_t PrioritySendQueue::size() const {
+    return count;
+}
+
+bool PrioritySendQueue::empty() const {
+    return count == 0;
+}
+
+/**
+ * @brief Set priority and device key of a message by its type, action and cause
+ */
+void PrioritySendQueue::classify(SinricProMessage* message, JsonDocument& jsonMessage) {
+    String type     = jsonMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_type] | "";
+    String action   = jsonMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_action] | "";
+    String cause    = jsonMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_cause][FSTR_SINRICPRO_type] | "";
+    String deviceId = jsonMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_deviceId] | "";
+
+    MessagePriority priority = MessagePriority::state;
+    if (type == FSTR_SINRICPRO_response) {
+        priority = MessagePriority::response;
+    } else if (action == FSTR_PRIORITY_DoorbellPress || action == FSTR_PRIORITY_pushNotification || action == FSTR_PRIORITY_motion || action == FSTR_PRIORITY_setContactState) {
+        priority = MessagePriority::alert;
+    } else if (cause == FSTR_SINRICPRO_PERIODIC_POLL) {
+        priority = MessagePriority::telemetry;
+    }
+    message->setPriority(priority, FastPublish::hash(deviceId.c_str(), deviceId.length()));
+}
+
+/**
+ * @brief Lower priority queue with a device that has waited for `SINRICPRO_SEND_MAX_WAIT` ms (longest waiting first)
+ */
+PrioritySendQueue::PriorityQueue* PrioritySendQueue::starvingQueue(unsigned long now) {
+    PriorityQueue* starving   = nullptr;
+    unsigned long  maxWaiting = SINRICPRO_SEND_MAX_WAIT;
+    for (size_t i = 1; i < (size_t)MessagePriority::COUNT; i++) {
+        for (auto& device : queues[i].devices) {
+            if (device.messages.empty()) continue;
+            unsigned long waiting = now - device.waitingSince;
+            if (waiting >= maxWaiting) {
+                maxWaiting = waiting;
+                starving   = &queues[i];
+            }
+        }
+    }
+    return starving;
+}
+
+/**
+ * @brief Index of the device to serve next (round-robin), `queue` must not be empty
+ */
+size_t PrioritySendQueue::nextDevice(const PriorityQueue& queue) const {
+    size_t deviceCount = queue.devices.size();
+    for (size_t i = 0; i < deviceCount; i++) {
+        size_t index = (queue.next + i) % deviceCount;
+        if (!queue.devices[index].messages.empty()) return index;
+    }
+    return 0;
+}
+
+SinricProMessage* PrioritySendQueue::take(PriorityQueue& queue, size_t index, unsigned long now) {
+    DeviceQueue&      device  = queue.devices[index];
+    SinricProMessage* message = device.messages.front().message;
+    device.messages.pop();
+    device.waitingSince = now;
+    queue.next          = (index + 1) % queue.devices.size();
+    queue.count--;
+    return message;
+}
+
+}  // namespace SINRICPRO_NAMESPACE
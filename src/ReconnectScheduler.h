@@ -0,0 +1,181 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <limits.h>
+#include <functional>
+
+#include "SinricProConfig.h"
+#include "SinricProDebug.h"
+#include "SinricProNamespace.h"
+namespace SINRICPRO_NAMESPACE {
+
+/**
+ * @brief Reason why a connection attempt to the SinricPro server was made
+ */
+enum class ConnectionCause : uint8_t {
+    startup,            ///< first attempt after SinricPro.begin()
+    retry,              ///< the previous attempt failed
+    connectionLost,     ///< an established connection was lost
+    wifiRestored,       ///< WiFi came back after it was lost
+    deviceListChanged   ///< a device was added while connected
+};
+
+/**
+ * @brief Describes a single connection attempt
+ */
+struct ConnectionAttempt {
+    unsigned long   timestamp = 0;                        ///< millis() when the attempt was started
+    ConnectionCause cause     = ConnectionCause::startup; ///< why the attempt was made
+    uint32_t        attempt   = 0;                        ///< number of attempts since the last successful connection (1 = first)
+};
+
+/**
+ * @brief Callback definition for onConnectionAttempt function
+ *
+ * Gets called every time a new connection attempt to the SinricPro server is started
+ * @param attempt `ConnectionAttempt` containing timestamp, cause and attempt counter
+ */
+using ConnectionAttemptCallback = std::function<void(const ConnectionAttempt&)>;
+
+/**
+ * @brief Decides when the next connection attempt is allowed
+ *
+ * The delay between attempts grows exponentially (doubling with every failed attempt) up to `maxDelay`.
+ * Each delay is randomized ("equal jitter": half fixed, half random) so that devices which lost their
+ * connection at the same moment do not reconnect at the same moment.
+ */
+class ReconnectScheduler {
+  public:
+    ReconnectScheduler(unsigned long minDelay = SINRICPRO_RECONNECT_MIN_DELAY, unsigned long maxDelay = SINRICPRO_RECONNECT_MAX_DELAY);
+
+    void schedule(ConnectionCause cause);
+    void cancel();
+    bool isDue();
+    void attemptStarted();
+    void connected();
+
+    bool                     isScheduled() const;
+    unsigned long            nextAttemptIn() const;
+    const ConnectionAttempt& lastAttempt() const;
+    void                     onAttempt(ConnectionAttemptCallback cb);
+
+  protected:
+    unsigned long backoffDelay();
+
+    unsigned long minDelay;
+    unsigned long maxDelay;
+
+    bool            scheduled;
+    ConnectionCause scheduledCause;
+    unsigned long   scheduledAt;
+    unsigned long   currentDelay;
+    uint32_t        failures;
+    uint32_t        attempts;
+
+    ConnectionAttempt         _lastAttempt;
+    ConnectionAttemptCallback _attemptCb;
+};
+
+ReconnectScheduler::ReconnectScheduler(unsigned long minDelay, unsigned long maxDelay)
+    : minDelay(minDelay)
+    , maxDelay(maxDelay)
+    , scheduled(false)
+    , scheduledCause(ConnectionCause::startup)
+    , scheduledAt(0)
+    , currentDelay(0)
+    , failures(0)
+    , attempts(0)
+    , _attemptCb(nullptr) {}
+
+/**
+ * @brief Schedule the next connection attempt
+ *
+ * `startup` and `deviceListChanged` are scheduled immediately, every other cause is delayed by the current backoff.
+ * @param cause reason for the upcoming attempt
+ */
+void ReconnectScheduler::schedule(ConnectionCause cause) {
+    if (cause == ConnectionCause::retry) failures++;
+
+    scheduled      = true;
+    scheduledCause = cause;
+    scheduledAt    = millis();
+
+    switch (cause) {
+        case ConnectionCause::startup:
+        case ConnectionCause::deviceListChanged:
+            currentDelay = 0;
+            break;
+        default:
+            currentDelay = backoffDelay();
+            break;
+    }
+    DEBUG_SINRIC("[SinricPro:Reconnect]: next attempt in %lu ms\r\n", currentDelay);
+}
+
+void ReconnectScheduler::cancel() {
+    scheduled = false;
+}
+
+bool ReconnectScheduler::isDue() {
+    if (!scheduled) return false;
+    return millis() - scheduledAt >= currentDelay;
+}
+
+/**
+ * @brief Must be called right before a scheduled attempt is executed
+ */
+void ReconnectScheduler::attemptStarted() {
+    scheduled              = false;
+    _lastAttempt.timestamp = millis();
+    _lastAttempt.cause     = scheduledCause;
+    _lastAttempt.attempt   = ++attempts;
+    if (_attemptCb) _attemptCb(_lastAttempt);
+}
+
+/**
+ * @brief Must be called when a connection has been established; resets the backoff
+ */
+void ReconnectScheduler::connected() {
+    scheduled = false;
+    failures  = 0;
+    attempts  = 0;
+}
+
+bool ReconnectScheduler::isScheduled() const {
+    return scheduled;
+}
+
+/**
+ * @brief Time in milliseconds until the next attempt is due
+ * @return 0 if the attempt is due, `ULONG_MAX` if no attempt is scheduled
+ */
+unsigned long ReconnectScheduler::nextAttemptIn() const {
+    if (!scheduled) return ULONG_MAX;
+    unsigned long elapsed = millis() - scheduledAt;
+    return elapsed >= currentDelay ? 0 : currentDelay - elapsed;
+}
+
+const ConnectionAttempt& ReconnectScheduler::lastAttempt() const {
+    return _lastAttempt;
+}
+
+void ReconnectScheduler::onAttempt(ConnectionAttemptCallback cb) {
+    _attemptCb = cb;
+}
+
+unsigned long ReconnectScheduler::backoffDelay() {
+    unsigned long ceiling = minDelay;
+    for (uint32_t i = 0; i < failures && ceiling < maxDelay; i++) ceiling *= 2;
+    if (ceiling > maxDelay) ceiling = maxDelay;
+
+    return ceiling / 2 + random(ceiling / 2 + 1);
+}
+
+}  // namespace SINRICPRO_NAMESPACE
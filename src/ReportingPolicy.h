@@ -0,0 +1,122 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "SinricProNamespace.h"
+namespace SINRICPRO_NAMESPACE {
+
+/**
+ * @brief Decides if a sensor reading is worth an event
+ *
+ * Every field can have an absolute and / or a relative deadband (eg. 0.05 = 5% of the last reported value).
+ * A reading is reported if at least one field moved beyond its deadband since the last report, or if no report
+ * has been sent for the heartbeat interval. Fields without a deadband never trigger a report.
+ * A reading which should be reported stays pending until it has been sent (eg. when the event limiter allows it).
+ * Without any deadband and heartbeat, every reading is reported.
+ */
+template <size_t FIELDS>
+class ReportingPolicy {
+  public:
+    ReportingPolicy();
+
+    void setDeadband(size_t field, float absolute, float relative = 0);
+    void setHeartbeat(unsigned long interval);
+
+    bool isEnabled() const;
+    bool shouldReport(const float (&values)[FIELDS]);
+    void reported(const float (&values)[FIELDS]);
+
+  protected:
+    bool isBeyondDeadband(size_t field, float value) const;
+
+    float         absolute[FIELDS];
+    float         relative[FIELDS];
+    float         last[FIELDS];
+    unsigned long heartbeat;
+    unsigned long lastReport;
+    bool          hasReported;
+    bool          pending;
+};
+
+template <size_t FIELDS>
+ReportingPolicy<FIELDS>::ReportingPolicy()
+    : absolute()
+    , relative()
+    , last()
+    , heartbeat(0)
+    , lastReport(0)
+    , hasReported(false)
+    , pending(false) {}
+
+/**
+ * @brief Set the deadband of a field
+ *
+ * @param field     index of the field
+ * @param absolute  minimum absolute change to report (0 = not used)
+ * @param relative  minimum change relative to the last reported value (0 = not used)
+ */
+template <size_t FIELDS>
+void ReportingPolicy<FIELDS>::setDeadband(size_t field, float absolute, float relative) {
+    if (field >= FIELDS) return;
+    this->absolute[field] = absolute;
+    this->relative[field] = relative;
+}
+
+/**
+ * @brief Set the maximum time between two reports
+ * @param interval time in ms (0 = no heartbeat)
+ */
+template <size_t FIELDS>
+void ReportingPolicy<FIELDS>::setHeartbeat(unsigned long interval) {
+    heartbeat = interval;
+}
+
+template <size_t FIELDS>
+bool ReportingPolicy<FIELDS>::isEnabled() const {
+    if (heartbeat) return true;
+    for (size_t i = 0; i < FIELDS; i++) {
+        if (absolute[i] > 0 || relative[i] > 0) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Check if a reading should be reported
+ */
+template <size_t FIELDS>
+bool ReportingPolicy<FIELDS>::shouldReport(const float (&values)[FIELDS]) {
+    if (!isEnabled() || !hasReported || pending) return true;
+    if (heartbeat && millis() - lastReport >= heartbeat) return pending = true;
+    for (size_t i = 0; i < FIELDS; i++) {
+        if (isBeyondDeadband(i, values[i])) return pending = true;
+    }
+    return false;
+}
+
+/**
+ * @brief A reading has been reported
+ */
+template <size_t FIELDS>
+void ReportingPolicy<FIELDS>::reported(const float (&values)[FIELDS]) {
+    for (size_t i = 0; i < FIELDS; i++) last[i] = values[i];
+    lastReport  = millis();
+    hasReported = true;
+    pending     = false;
+}
+
+template <size_t FIELDS>
+bool ReportingPolicy<FIELDS>::isBeyondDeadband(size_t field, float value) const {
+    float change = fabsf(value - last[field]);
+    if (absolute[field] > 0 && change >= absolute[field]) return true;
+    if (relative[field] > 0 && change > 0 && change >= relative[field] * fabsf(last[field])) return true;
+    return false;
+}
+
+}  // namespace SINRICPRO_NAMESPACE
@@ -0,0 +1,200 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+
+#include "SinricProDebug.h"
+#include "SinricProMetrics.h"
+#include "SinricProNamespace.h"
+#include "SinricProQueue.h"
+#include "SinricProStrings.h"
+namespace SINRICPRO_NAMESPACE {
+
+FSTR(COALESCE, adjustVolume);             // "adjustVolume"
+FSTR(COALESCE, adjustBrightness);         // "adjustBrightness"
+FSTR(COALESCE, adjustRangeValue);         // "adjustRangeValue"
+FSTR(COALESCE, adjustPowerLevel);         // "adjustPowerLevel"
+FSTR(COALESCE, adjustPercentage);         // "adjustPercentage"
+FSTR(COALESCE, adjustOpenClose);          // "adjustOpenClose"
+FSTR(COALESCE, adjustTargetTemperature);  // "adjustTargetTemperature"
+FSTR(COALESCE, setVolume);                // "setVolume"
+FSTR(COALESCE, setBrightness);            // "setBrightness"
+FSTR(COALESCE, setRangeValue);            // "setRangeValue"
+FSTR(COALESCE, setPowerLevel);            // "setPowerLevel"
+FSTR(COALESCE, setPercentage);            // "setPercentage"
+FSTR(COALESCE, setOpenClose);             // "setOpenClose"
+FSTR(COALESCE, setColor);                 // "setColor"
+FSTR(COALESCE, setColorTemperature);      // "setColorTemperature"
+FSTR(COALESCE, targetTemperature);        // "targetTemperature"
+FSTR(COALESCE, volume);                   // "volume"
+FSTR(COALESCE, brightnessDelta);          // "brightnessDelta"
+FSTR(COALESCE, rangeValueDelta);          // "rangeValueDelta"
+FSTR(COALESCE, powerLevelDelta);          // "powerLevelDelta"
+FSTR(COALESCE, percentage);               // "percentage"
+FSTR(COALESCE, openRelativePercent);      // "openRelativePercent"
+FSTR(COALESCE, temperature);              // "temperature"
+
+/**
+ * @brief A request which has been merged into a later request and only needs a response
+ */
+struct CoalescedReply {
+    String       replyToken;
+    String       clientId;
+    MessageRoute route;
+    uint32_t     traceId;
+};
+
+/**
+ * @brief A request with a valid signature, waiting to be handled
+ */
+struct VerifiedRequest {
+    JsonDocument                requestMessage;
+    MessageRoute                route;
+    uint32_t                    traceId;
+    std::vector<CoalescedReply> coalesced;  // requests merged into this request
+};
+
+/**
+ * @brief Merges bursts of adjust and set requests for the same device and instance
+ *
+ * Only the last pending request of a device is a merge candidate, so requests for a device are never reordered.
+ * Relative requests (eg. "adjustVolume") are merged by summing up their deltas, absolute requests (eg. "setVolume")
+ * by keeping the latest value. All other values of the requests have to be equal.
+ * The device callback runs once for the merged request, every merged request still gets its own response.
+ */
+class RequestCoalescer {
+  public:
+    ~RequestCoalescer();
+
+    void             add(VerifiedRequest* request);
+    VerifiedRequest* next();
+
+  protected:
+    bool merge(VerifiedRequest& target, VerifiedRequest& request);
+
+    static const char* deltaKey(const String& action);
+    static bool        isAbsolute(const String& action);
+
+    std::vector<VerifiedRequest*> pending;
+    size_t                        position = 0;
+};
+
+RequestCoalescer::~RequestCoalescer() {
+    while (VerifiedRequest* request = next()) delete request;
+}
+
+/**
+ * @brief Add a verified request (takes ownership)
+ */
+void RequestCoalescer::add(VerifiedRequest* request) {
+    String deviceId = request->requestMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_deviceId] | "";
+    String scope    = request->requestMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_scope] | FSTR_SINRICPRO_device;
+
+    if (deviceId.length() && scope != FSTR_SINRICPRO_module) {
+        for (size_t i = pending.size(); i > position; i--) {
+            VerifiedRequest* target       = pending[i - 1];
+            String           targetDevice = target->requestMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_deviceId] | "";
+            if (targetDevice != deviceId) continue;
+            if (merge(*target, *request)) {
+                delete request;
+                return;
+            }
+            break;
+        }
+    }
+    pending.push_back(request);
+}
+
+/**
+ * @brief Next request to handle (ownership is passed to the caller)
+ * @return `nullptr` if there are no more requests
+ */
+VerifiedRequest* RequestCoalescer::next() {
+    if (position >= pending.size()) {
+        pending.clear();
+        position = 0;
+        return nullptr;
+    }
+    return pending[position++];
+}
+
+bool RequestCoalescer::merge(VerifiedRequest& target, VerifiedRequest& request) {
+    JsonObject targetPayload  = target.requestMessage[FSTR_SINRICPRO_payload];
+    JsonObject requestPayload = request.requestMessage[FSTR_SINRICPRO_payload];
+
+    String action   = requestPayload[FSTR_SINRICPRO_action] | "";
+    String instance = requestPayload[FSTR_SINRICPRO_instanceId] | "";
+    if (action != (targetPayload[FSTR_SINRICPRO_action] | "")) return false;
+    if (instance != (targetPayload[FSTR_SINRICPRO_instanceId] | "")) return false;
+
+    const char* delta    = deltaKey(action);
+    bool        absolute = isAbsolute(action);
+    if (!delta && !absolute) return false;
+
+    JsonObject targetValue  = targetPayload[FSTR_SINRICPRO_value];
+    JsonObject requestValue = requestPayload[FSTR_SINRICPRO_value];
+
+    if (delta) {
+        if (targetValue.size() != requestValue.size()) return false;
+        for (JsonPair kv : requestValue) {
+            if (strcmp(kv.key().c_str(), delta) == 0) continue;
+            if (targetValue[kv.key()] != kv.value()) return false;
+        }
+        if (targetValue[delta].is<int>() && requestValue[delta].is<int>()) {
+            targetValue[delta] = targetValue[delta].as<int>() + requestValue[delta].as<int>();
+        } else {
+            targetValue[delta] = targetValue[delta].as<float>() + requestValue[delta].as<float>();
+        }
+    }
+
+    // the merged request answers with the replyToken of the latest request
+    String replyToken = targetPayload[FSTR_SINRICPRO_replyToken] | "";
+    String clientId   = targetPayload[FSTR_SINRICPRO_clientId] | "";
+    target.coalesced.push_back(CoalescedReply{replyToken, clientId, target.route, target.traceId});
+    for (auto& reply : request.coalesced) target.coalesced.push_back(reply);
+
+    if (absolute) {
+        targetPayload[FSTR_SINRICPRO_value] = requestValue;
+    }
+    targetPayload[FSTR_SINRICPRO_replyToken] = requestPayload[FSTR_SINRICPRO_replyToken];
+    targetPayload[FSTR_SINRICPRO_clientId]   = requestPayload[FSTR_SINRICPRO_clientId];
+    target.route                             = request.route;
+    target.traceId                           = request.traceId;
+
+    SINRICPRO_METRIC_COUNT(coalesced);
+    DEBUG_SINRIC("[SinricPro:RequestCoalescer]: merged \"%s\" (%i requests)\r\n", action.c_str(), target.coalesced.size() + 1);
+    return true;
+}
+
+const char* RequestCoalescer::deltaKey(const String& action) {
+    if (action == FSTR_COALESCE_adjustVolume) return FSTR_COALESCE_volume;
+    if (action == FSTR_COALESCE_adjustBrightness) return FSTR_COALESCE_brightnessDelta;
+    if (action == FSTR_COALESCE_adjustRangeValue) return FSTR_COALESCE_rangeValueDelta;
+    if (action == FSTR_COALESCE_adjustPowerLevel) return FSTR_COALESCE_powerLevelDelta;
+    if (action == FSTR_COALESCE_adjustPercentage) return FSTR_COALESCE_percentage;
+    if (action == FSTR_COALESCE_adjustOpenClose) return FSTR_COALESCE_openRelativePercent;
+    if (action == FSTR_COALESCE_adjustTargetTemperature) return FSTR_COALESCE_temperature;
+    return nullptr;
+}
+
+bool RequestCoalescer::isAbsolute(const String& action) {
+    return action == FSTR_COALESCE_setVolume ||
+           action == FSTR_COALESCE_setBrightness ||
+           action == FSTR_COALESCE_setRangeValue ||
+           action == FSTR_COALESCE_setPowerLevel ||
+           action == FSTR_COALESCE_setPercentage ||
+           action == FSTR_COALESCE_setOpenClose ||
+           action == FSTR_COALESCE_setColor ||
+           action == FSTR_COALESCE_setColorTemperature ||
+           action == FSTR_COALESCE_targetTemperature;
+}
+
+}  // namespace SINRICPRO_NAMESPACE
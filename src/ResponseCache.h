@@ -0,0 +1,142 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <vector>
+
+#include "FastPublish.h"
+#include "SinricProConfig.h"
+#include "SinricProNamespace.h"
+#include "SinricProQueue.h"
+namespace SINRICPRO_NAMESPACE {
+
+/**
+ * @brief Remembers the replyTokens of recently handled requests together with their signed responses
+ *
+ * A retransmitted request (same replyToken) is answered with the cached response instead of calling the device
+ * callback again, so toggles don't flip twice and relays don't cycle. The route of a duplicate of a request which is
+ * still being handled (a deferred response, or the same request over udp and websocket) is remembered and gets the
+ * response as soon as it is stored (up to `SINRICPRO_RESPONSE_CACHE_WAITING` routes per request). The cache has a
+ * fixed number of entries (`SINRICPRO_RESPONSE_CACHE_SIZE`), the least recently used entry is replaced.
+ */
+class ResponseCache {
+  public:
+    ResponseCache();
+
+    bool                      isDuplicate(const String& replyToken, const MessageRoute& route, String& response);
+    std::vector<MessageRoute> store(const String& replyToken, const String& response);
+    std::vector<MessageRoute> remove(const String& replyToken);
+    uint32_t getDuplicateCount() const;
+
+  protected:
+    struct Entry {
+        uint32_t                  hash;
+        uint32_t                  lastUsed;
+        String                    replyToken;
+        String                    response;  // signed response, empty while the request is being handled
+        std::vector<MessageRoute> waiting;   // routes of duplicates received while the request is being handled
+    };
+
+    Entry* find(const String& replyToken, uint32_t hash);
+
+    Entry    entries[SINRICPRO_RESPONSE_CACHE_SIZE];
+    uint32_t useCounter;
+    uint32_t duplicates;
+};
+
+ResponseCache::ResponseCache()
+    : entries()
+    , useCounter(0)
+    , duplicates(0) {}
+
+/**
+ * @brief Check if a request has already been received
+ *
+ * Unknown replyTokens are remembered as being handled. The route of a duplicate of a request which is still being
+ * handled is remembered, `store()` returns it together with the routes of the other waiting duplicates.
+ * @param replyToken replyToken of the request
+ * @param route      where the request has been received from
+ * @param response   the signed response if the request has already been answered, otherwise empty
+ * @return `true` if the request is a duplicate and must not be handled again
+ */
+bool ResponseCache::isDuplicate(const String& replyToken, const MessageRoute& route, String& response) {
+    if (replyToken.length() == 0) return false;
+
+    uint32_t hash  = FastPublish::hash(replyToken.c_str(), replyToken.length());
+    Entry*   entry = find(replyToken, hash);
+    if (entry) {
+        entry->lastUsed = ++useCounter;
+        response        = entry->response;
+        duplicates++;
+        if (!response.length() && entry->waiting.size() < SINRICPRO_RESPONSE_CACHE_WAITING) entry->waiting.push_back(route);
+        return true;
+    }
+
+    entry = &entries[0];
+    for (auto& candidate : entries) {
+        if (candidate.lastUsed < entry->lastUsed) entry = &candidate;
+    }
+    entry->hash       = hash;
+    entry->lastUsed   = ++useCounter;
+    entry->replyToken = replyToken;
+    entry->response   = "";
+    entry->waiting.clear();
+    return false;
+}
+
+/**
+ * @brief Remember the signed response of a request
+ *
+ * Responses to requests which are no longer in the cache are not stored.
+ * @return routes of the duplicates which have been received while the request was handled, they are waiting for `response`
+ */
+std::vector<MessageRoute> ResponseCache::store(const String& replyToken, const String& response) {
+    std::vector<MessageRoute> waiting;
+    if (replyToken.length() == 0) return waiting;
+
+    Entry* entry = find(replyToken, FastPublish::hash(replyToken.c_str(), replyToken.length()));
+    if (!entry) return waiting;
+    entry->response = response;
+    waiting.swap(entry->waiting);
+    return waiting;
+}
+
+/**
+ * @brief Forget a request which has not been handled (a retransmission is handled as a new request)
+ * @return routes of the duplicates which have been received while the request was handled, they still need an answer
+ */
+std::vector<MessageRoute> ResponseCache::remove(const String& replyToken) {
+    std::vector<MessageRoute> waiting;
+    if (replyToken.length() == 0) return waiting;
+
+    Entry* entry = find(replyToken, FastPublish::hash(replyToken.c_str(), replyToken.length()));
+    if (!entry) return waiting;
+    waiting.swap(entry->waiting);
+    entry->lastUsed   = 0;
+    entry->replyToken = "";
+    entry->response   = "";
+    return waiting;
+}
+
+/**
+ * @brief Number of duplicate requests which have not been handled again
+ */
+uint32_t ResponseCache::getDuplicateCount() const {
+    return duplicates;
+}
+
+ResponseCache::Entry* ResponseCache::find(const String& replyToken, uint32_t hash) {
+    for (auto& entry : entries) {
+        if (entry.lastUsed && entry.hash == hash && entry.replyToken == replyToken) return &entry;
+    }
+    return nullptr;
+}
+
+}  // namespace SINRICPRO_NAMESPACE
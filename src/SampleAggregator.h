@@ -0,0 +1,137 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "SinricProNamespace.h"
+namespace SINRICPRO_NAMESPACE {
+
+/**
+ * @brief Summary of the samples of one window
+ */
+struct SampleSummary {
+    uint32_t count;     ///< number of samples
+    float    min;       ///< smallest sample
+    float    max;       ///< largest sample
+    float    mean;      ///< average of all samples
+    float    last;      ///< latest sample
+    float    integral;  ///< trapezoidal integral over time in value * seconds (eg. watts -> joules)
+    float    duration;  ///< time covered by the integral in seconds
+};
+
+/**
+ * @brief Aggregates samples taken at a high rate into a window summary
+ *
+ * Every sample is folded into the running min, max, mean and trapezoidal integral in constant time and memory,
+ * so samples can be added hundreds of times per second. `reset()` starts a new window; the integral continues
+ * seamlessly from the last sample of the previous window.
+ * @section SampleAggregator Example-Code
+ * @code
+ * SampleAggregator power;
+ *
+ * void loop() {
+ *   power.addSample(readPower());
+ *   if (timeToReport) {
+ *     SampleSummary summary = power.getSummary();
+ *     Serial.printf("avg %.1f W, peak %.1f W, %.3f Wh\r\n", summary.mean, summary.max, summary.integral / 3600);
+ *     power.reset();
+ *   }
+ * }
+ * @endcode
+ */
+class SampleAggregator {
+  public:
+    SampleAggregator();
+
+    void          addSample(float value);
+    void          addSample(float value, uint32_t timestampUs);
+    bool          isEmpty() const;
+    SampleSummary getSummary() const;
+    void          reset();
+
+  protected:
+    uint32_t count;
+    float    minValue;
+    float    maxValue;
+    double   sum;
+    double   integral;
+    double   elapsed;
+    float    lastValue;
+    uint32_t lastTimestampUs;
+    bool     hasLast;
+};
+
+SampleAggregator::SampleAggregator()
+    : count(0)
+    , minValue(0)
+    , maxValue(0)
+    , sum(0)
+    , integral(0)
+    , elapsed(0)
+    , lastValue(0)
+    , lastTimestampUs(0)
+    , hasLast(false) {}
+
+/**
+ * @brief Add a sample taken now
+ */
+void SampleAggregator::addSample(float value) {
+    addSample(value, micros());
+}
+
+/**
+ * @brief Add a sample
+ * @param value       sample value
+ * @param timestampUs `micros()` when the sample has been taken
+ */
+void SampleAggregator::addSample(float value, uint32_t timestampUs) {
+    if (count == 0 || value < minValue) minValue = value;
+    if (count == 0 || value > maxValue) maxValue = value;
+    sum += value;
+    count++;
+
+    if (hasLast) {
+        uint32_t dt = timestampUs - lastTimestampUs;
+        integral += (lastValue + value) * 0.5 * dt / 1000000.0;
+        elapsed += dt / 1000000.0;
+    }
+    lastValue       = value;
+    lastTimestampUs = timestampUs;
+    hasLast         = true;
+}
+
+bool SampleAggregator::isEmpty() const {
+    return count == 0;
+}
+
+SampleSummary SampleAggregator::getSummary() const {
+    SampleSummary summary;
+    summary.count    = count;
+    summary.min      = minValue;
+    summary.max      = maxValue;
+    summary.mean     = count ? sum / count : 0;
+    summary.last     = lastValue;
+    summary.integral = integral;
+    summary.duration = elapsed;
+    return summary;
+}
+
+/**
+ * @brief Start a new window
+ */
+void SampleAggregator::reset() {
+    count     = 0;
+    minValue  = 0;
+    maxValue  = 0;
+    sum       = 0;
+    integral  = 0;
+    elapsed   = 0;
+}
+
+}  // namespace SINRICPRO_NAMESPACE
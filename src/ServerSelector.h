@@ -0,0 +1,243 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+
+#include "SinricProConfig.h"
+#include "SinricProDebug.h"
+#include "SinricProNamespace.h"
+namespace SINRICPRO_NAMESPACE {
+
+/**
+ * @brief Connection statistics of a single server
+ */
+struct ServerStats {
+    String        url;                  ///< server url
+    uint32_t      connections;          ///< number of successful connections
+    uint32_t      failures;             ///< number of failed connection attempts
+    uint32_t      consecutiveFailures;  ///< failed connection attempts since the last successful connection
+    unsigned long lastFailure;          ///< millis() of the last failed connection attempt
+    uint32_t      lastLatency;          ///< connect to first message latency of the last connection in ms (0 = never connected)
+    uint32_t      smoothedLatency;      ///< smoothed connect to first message latency in ms (0 = never connected)
+    uint32_t      probes;               ///< number of connection attempts made to measure this server
+};
+
+/**
+ * @brief Reason why a server was selected
+ */
+enum class ServerSelectionReason : uint8_t {
+    preferred,  ///< the preferred (fastest known) server is healthy
+    failover,   ///< the preferred server failed too often
+    probe       ///< another server is measured (see ServerSelector)
+};
+
+/**
+ * @brief Describes the last server selection
+ */
+struct ServerSelection {
+    size_t                index     = 0;                                 ///< index of the selected server
+    ServerSelectionReason reason    = ServerSelectionReason::preferred;  ///< why the server was selected
+    unsigned long         timestamp = 0;                                 ///< millis() when the server was selected
+};
+
+/**
+ * @brief Callback definition for onServerPreferenceChanged function
+ *
+ * Gets called when a different server becomes the preferred server.
+ * Store `index` (eg. in EEPROM / Preferences) and pass it to `setPreferredServer()` after reboot to keep the preference.
+ * @param index index of the new preferred server
+ * @param url   url of the new preferred server
+ */
+using ServerPreferenceCallback = std::function<void(size_t index, const String& url)>;
+
+/**
+ * @brief Chooses the server for the next connection attempt out of an ordered list
+ *
+ * The preferred server is used as long as it is healthy. A server is unhealthy after `SINRICPRO_SERVER_MAX_FAILURES`
+ * failed attempts in a row and gets another chance after `SINRICPRO_SERVER_RETRY_INTERVAL` ms. If the preferred
+ * server is unhealthy, the next healthy server in list order is used (failover).
+ * A server becomes the preferred server after a successful connection if the preferred server is unhealthy
+ * or has a higher connect to first message latency.
+ * To measure the other servers, the first connection attempt after `SINRICPRO_SERVER_PROBE_INTERVAL` ms goes to the
+ * next healthy server in the list (round-robin) instead of the preferred one. Its connect to first message latency
+ * is measured like for every other connection. Probes only happen when the device reconnects anyway, so an
+ * established connection is never interrupted or delayed.
+ */
+class ServerSelector {
+  public:
+    ServerSelector();
+
+    void setServers(const std::vector<String>& urls);
+    void setPreferred(size_t index);
+    void onPreferenceChanged(ServerPreferenceCallback cb);
+
+    const String& select();
+    void          connected(uint32_t latency);
+    void          failed();
+
+    const String&                   getCurrent() const;
+    size_t                          getPreferred() const;
+    const ServerSelection&          getLastSelection() const;
+    const std::vector<ServerStats>& getStats() const;
+
+  protected:
+    bool          isHealthy(const ServerStats& server) const;
+    bool          isProbeDue() const;
+    const String& choose(size_t index, ServerSelectionReason reason);
+    void          prefer(size_t index);
+
+    std::vector<ServerStats> servers;
+    size_t                   current;
+    size_t                   preferred;
+    ServerSelection          selection;
+    size_t                   probeIndex;
+    unsigned long            lastProbe;
+    ServerPreferenceCallback _preferenceCb;
+};
+
+ServerSelector::ServerSelector()
+    : current(0)
+    , preferred(0)
+    , probeIndex(0)
+    , lastProbe(0)
+    , _preferenceCb(nullptr) {}
+
+/**
+ * @brief Set the server list; the statistics are kept if the list has not changed
+ */
+void ServerSelector::setServers(const std::vector<String>& urls) {
+    bool unchanged = urls.size() == servers.size();
+    for (size_t i = 0; unchanged && i < urls.size(); i++) unchanged = urls[i] == servers[i].url;
+    if (unchanged) return;
+
+    servers.clear();
+    for (auto& url : urls) servers.push_back(ServerStats{url, 0, 0, 0, 0, 0, 0, 0});
+    probeIndex = 0;
+    lastProbe  = millis();
+    if (preferred >= servers.size()) preferred = 0;
+    current = preferred;
+}
+
+/**
+ * @brief Set the preferred server (eg. restored from persistent storage)
+ * @param index index into the server list
+ */
+void ServerSelector::setPreferred(size_t index) {
+    preferred = index;
+    if (servers.size() && preferred >= servers.size()) preferred = 0;
+}
+
+void ServerSelector::onPreferenceChanged(ServerPreferenceCallback cb) {
+    _preferenceCb = cb;
+}
+
+/**
+ * @brief Select the server for the next connection attempt
+ * @return url of the selected server
+ */
+const String& ServerSelector::select() {
+    if (isHealthy(servers[preferred]) && isProbeDue()) {
+        lastProbe = millis();
+        for (size_t i = 0; i < servers.size(); i++) {
+            size_t index = probeIndex;
+            probeIndex   = (probeIndex + 1) % servers.size();
+            if (index == preferred || !isHealthy(servers[index])) continue;
+            servers[index].probes++;
+            return choose(index, ServerSelectionReason::probe);
+        }
+    }
+    if (isHealthy(servers[preferred])) return choose(preferred, ServerSelectionReason::preferred);
+
+    for (size_t i = 0; i < servers.size(); i++) {
+        size_t index = (current + i) % servers.size();
+        if (isHealthy(servers[index])) return choose(index, ServerSelectionReason::failover);
+    }
+
+    // no healthy server left: start over
+    for (auto& server : servers) server.consecutiveFailures = 0;
+    return choose(preferred, ServerSelectionReason::preferred);
+}
+
+/**
+ * @brief The current server has been connected successfully
+ * @param latency connect to first message latency in ms
+ */
+void ServerSelector::connected(uint32_t latency) {
+    ServerStats& server = servers[current];
+    server.connections++;
+    server.consecutiveFailures = 0;
+    server.lastLatency         = latency;
+    server.smoothedLatency     = server.smoothedLatency ? (3 * server.smoothedLatency + latency) / 4 : latency;
+
+    if (current == preferred) return;
+
+    const ServerStats& preferredServer = servers[preferred];
+    if (isHealthy(preferredServer) && preferredServer.smoothedLatency && preferredServer.smoothedLatency <= server.smoothedLatency) return;
+
+    prefer(current);
+}
+
+/**
+ * @brief A connection attempt to the current server failed
+ */
+void ServerSelector::failed() {
+    ServerStats& server = servers[current];
+    server.failures++;
+    server.consecutiveFailures++;
+    server.lastFailure = millis();
+}
+
+const String& ServerSelector::getCurrent() const {
+    return servers[current].url;
+}
+
+size_t ServerSelector::getPreferred() const {
+    return preferred;
+}
+
+const ServerSelection& ServerSelector::getLastSelection() const {
+    return selection;
+}
+
+const std::vector<ServerStats>& ServerSelector::getStats() const {
+    return servers;
+}
+
+bool ServerSelector::isHealthy(const ServerStats& server) const {
+    if (server.consecutiveFailures < SINRICPRO_SERVER_MAX_FAILURES) return true;
+    return millis() - server.lastFailure >= SINRICPRO_SERVER_RETRY_INTERVAL;
+}
+
+/**
+ * @brief `true` if the next connection attempt should measure another server (only if there is more than one server)
+ */
+bool ServerSelector::isProbeDue() const {
+    return servers.size() > 1 && millis() - lastProbe >= SINRICPRO_SERVER_PROBE_INTERVAL;
+}
+
+void ServerSelector::prefer(size_t index) {
+    preferred = index;
+    DEBUG_SINRIC("[SinricPro:ServerSelector]: \"%s\" is the new preferred server\r\n", servers[index].url.c_str());
+    if (_preferenceCb) _preferenceCb(preferred, servers[index].url);
+}
+
+const String& ServerSelector::choose(size_t index, ServerSelectionReason reason) {
+    if (index != current) {
+        DEBUG_SINRIC("[SinricPro:ServerSelector]: switching to \"%s\"\r\n", servers[index].url.c_str());
+    }
+    current             = index;
+    selection.index     = index;
+    selection.reason    = reason;
+    selection.timestamp = millis();
+    return servers[current].url;
+}
+
+}  // namespace SINRICPRO_NAMESPACE
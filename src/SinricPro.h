@@ -7,17 +7,34 @@
 
 #pragma once
 
+#include "AckTracker.h"
+#include "DeferredResponse.h"
+#include "EchoSuppressor.h"
+#include "ResponseCache.h"
+#include "LocalSync.h"
+#include "RequestCoalescer.h"
+#include "FastPublish.h"
+#include "PrioritySendQueue.h"
 #include "SinricProDeviceInterface.h"
 #include "SinricProInterface.h"
 #include "SinricProMessageid.h"
+#include "SinricProMetrics.h"
+#include "SinricProProfiler.h"
 #include "SinricProModuleCommandHandler.h"
 #include "SinricProNamespace.h"
 #include "SinricProQueue.h"
 #include "SinricProSignature.h"
 #include "SinricProStrings.h"
+#include "SinricProTrace.h"
 #include "SinricProUDP.h"
+#include "SinricProLocalServer.h"
 #include "SinricProWebsocket.h"
 #include "Timestamp.h"
+
+#if defined(SINRICPRO_NETWORK_TASK) && !defined(ESP32) && !defined(ARDUINO_ARCH_RP2040)
+#error "SINRICPRO_NETWORK_TASK is only supported on ESP32 and RP2040"
+#endif
+
 namespace SINRICPRO_NAMESPACE {
 
 /**
@@ -94,14 +111,45 @@ class SinricProClass : public SinricProInterface {
 
   public:
     void           begin(String appKey, String appSecret, String serverURL = SINRICPRO_SERVER_URL);
+    void           begin(String appKey, String appSecret, const std::vector<String>& serverURLs);
     void           handle();
+    void           handleNetwork();
+    unsigned long  nextDeadlineMs();
+    void           enableFastPublish();
+    bool           isPublished();
+    void           prepareSleep(uint32_t sleepMs = 0);
+#ifdef SINRICPRO_TRACE
+    void           dumpTrace(Print& output);
+#endif
+#ifdef SINRICPRO_PROFILE
+    void           onSlowCallback(SlowCallbackHandler cb);
+    const std::vector<CallbackStats>& getCallbackStats();
+    const TimingStats&                getHandleStats();
+    const TimingStats&                getLoopGapStats();
+#endif
     void           stop();
     bool           isConnected();
     void           onConnected(ConnectedCallbackHandler cb);
     void           onDisconnected(DisconnectedCallbackHandler cb);
     void           onPong(PongCallback cb);
+    void           onConnectionAttempt(ConnectionAttemptCallback cb);
+    const ConnectionAttempt& getLastConnectionAttempt();
+    const ConnectionLatency& getConnectionLatency();
+    const HeapStats&         getHeapStats();
+    const TlsStats&          getTlsStats();
+    const HeartbeatStats&    getHeartbeatStats();
+    const std::vector<AckStats>& getAckStats();
+    uint32_t       getSuppressedEchoes();
+    uint32_t       getDuplicateRequests();
+    const UdpStats& getUdpStats();
+    void           setPreferredServer(size_t index);
+    void           onServerPreferenceChanged(ServerPreferenceCallback cb);
+    const String&  getCurrentServer();
+    const ServerSelection& getServerSelection();
+    const std::vector<ServerStats>& getServerStats();
     void           restoreDeviceStates(bool flag);
     void           setResponseMessage(String&& message);
+    DeferredResponse deferResponse(unsigned long timeout = SINRICPRO_DEFERRED_TIMEOUT);
     unsigned long  getTimestamp() override;
     virtual String sign(const String& message);
     Proxy          operator[](const String deviceId);
@@ -119,19 +167,42 @@ class SinricProClass : public SinricProInterface {
     JsonDocument prepareResponse(JsonDocument& requestMessage);
     JsonDocument prepareEvent(String deviceId, const char* action, const char* cause) override;
     void         sendMessage(JsonDocument& jsonMessage) override;
+    bool         isQueueingAllowed() override;
 
   private:
     void handleReceiveQueue();
     void handleSendQueue();
-
-    void handleDeviceRequest(JsonDocument& requestMessage, interface_t Interface);
-    void handleModuleRequest(JsonDocument& requestMessage, interface_t Interface);
+    void queueOutbound(SinricProMessage* message);
+    void sendSigned(const MessageRoute& route, String& message);
+    void handleLocalQueue();
+    void pushSendQueue(SinricProMessage* message);
+    void sendQueuedMessage(SinricProMessage* rawMessage);
+    void queueEvent(JsonDocument& eventMessage);
+
+    void handleRequest(VerifiedRequest& request);
+    void dispatchRequest(VerifiedRequest* request);
+
+    void handleDeviceRequest(JsonDocument& requestMessage, const MessageRoute& route, const std::vector<CoalescedReply>& coalesced);
+    void handleModuleRequest(JsonDocument& requestMessage, const MessageRoute& route);
+    void sendDeviceResponse(JsonDocument& responseMessage, const MessageRoute& route, uint32_t traceId, const std::vector<CoalescedReply>& coalesced);
     void handleResponse(JsonDocument& responseMessage);
-    void handleInvalidSignatureRequest(JsonDocument& requestMessage, interface_t Interface);
+    void handleInvalidSignatureRequest(JsonDocument& requestMessage, const MessageRoute& route);
+#ifdef SINRICPRO_NETWORK_TASK
+    void handleBusyRequest(VerifiedRequest& request);
+#endif
+
+#ifdef SINRICPRO_STATE_SHADOW
+    void addStateSnapshot(JsonObject& snapshot);
+    void sendStateSnapshot();
+#endif
 
     JsonDocument prepareRequest(String deviceId, const char* action);
 
-    void connect();
+    bool handleWiFiState();
+
+    String getDeviceList();
+    void   publishDeviceList();
+    void connect(ConnectionCause cause = ConnectionCause::startup);
     void disconnect();
     void reconnect();
 
@@ -149,19 +220,53 @@ class SinricProClass : public SinricProInterface {
 
     String appKey;
     String appSecret;
-    String serverURL;
+    std::vector<String> serverURLs;
 
     WebsocketListener _websocketListener;
     UdpListener       _udpListener;
+#ifdef SINRICPRO_LOCAL_SERVER
+    LocalServerListener _localServer;  // local websocket server (see SinricProLocalServer.h)
+#endif
     SinricProQueue_t  receiveQueue;
-    SinricProQueue_t  sendQueue;
+    PrioritySendQueue sendQueue;
+    SinricProQueue_t  localQueue;  // udp / local websocket responses, sent without waiting for the server
 
-    Timestamp timestamp;
+    Timestamp   timestamp;
+    AckTracker  _ackTracker;
+    FastPublish _fastPublish;
 
-    bool   _begin             = false;
+    std::atomic<bool> _begin{false};
+    bool   _wifiConnected     = false;
+    bool   _wasConnected      = false;
     String responseMessageStr = "";
+    uint32_t currentTraceId   = 0;  // trace id of the request being handled
 
     SinricProModuleCommandHandler _moduleCommandHandler;
+    DeferredResponseManager       _deferredResponses;
+    EchoSuppressor                _echoSuppressor;
+    ResponseCache                 _responseCache;  // network side
+    LocalSync                     _localSync;
+
+#ifdef SINRICPRO_STATE_SHADOW
+    std::atomic<bool> _snapshotPending{false};  // set by the network side after connect, sent from handle()
+#endif
+
+#ifdef SINRICPRO_NETWORK_TASK
+    void handleVerifiedQueue();
+
+    SinricProSpscQueue<VerifiedRequest*, SINRICPRO_NETWORK_QUEUE_SIZE>  verifiedQueue;  // network -> application
+    SinricProSpscQueue<SinricProMessage*, SINRICPRO_NETWORK_QUEUE_SIZE> outboundQueue;  // application -> network
+    std::atomic<bool> _reconnectRequested{false};
+    std::atomic<String*> _pendingDeviceList{nullptr};  // application -> network, taken by getDeviceList()
+    String               _deviceList;                  // network side
+    std::atomic<uint32_t> _outboundCount{0};           // messages passed to the network side and not yet in the sendQueue
+    std::atomic<bool>     _sendIdle{true};             // network side: sendQueue empty and no event waiting for its response
+
+  #if defined(ESP32)
+    static void  networkTask(void* arg);
+    TaskHandle_t _networkTask = nullptr;
+  #endif
+#endif
 };
 
 class SinricProClass::Proxy {
@@ -224,6 +329,25 @@ DeviceType& SinricProClass::getDeviceInstance(String deviceId) {
  * @endcode
  **/
 void SinricProClass::begin(String appKey, String appSecret, String serverURL) {
+    begin(appKey, appSecret, std::vector<String>{serverURL});
+}
+
+/**
+ * @brief Initializing SinricProClass with a list of SinricPro Servers
+ *
+ * The first server is used until it fails `SINRICPRO_SERVER_MAX_FAILURES` times in a row, then the next server in the list is used.
+ * The server with the lowest connect latency becomes the preferred server (see `onServerPreferenceChanged` and `setPreferredServer`).
+ * @param appKey `String` containing APP_KEY (see credentials from https://sinric.pro )
+ * @param appSecret `String` containing APP_SECRET (see credentials from https:://sinric.pro)
+ * @param serverURLs ordered list of SinricPro Server URLs
+ * @section Example-Code
+ * @code
+ * void setup() {
+ *   SinricPro.begin(APP_KEY, APP_SECRET, {"ws.sinric.pro", "ws2.example.com"});
+ * }
+ * @endcode
+ **/
+void SinricProClass::begin(String appKey, String appSecret, const std::vector<String>& serverURLs) {
     bool success = true;
     if (!appKey.length()) {
         DEBUG_SINRIC("[SinricPro:begin()]: App-Key \"%s\" is invalid!! Please check your app-key!! SinricPro will not work!\r\n", appKey.c_str());
@@ -234,16 +358,27 @@ void SinricProClass::begin(String appKey, String appSecret, String serverURL) {
         success = false;
     }
 
+    if (!serverURLs.size()) {
+        DEBUG_SINRIC("[SinricPro:begin()]: No server URL given!! SinricPro will not work!\r\n");
+        success = false;
+    }
+
     if (!success) {
         _begin = false;
         return;
     }
 
-    this->appKey    = appKey;
-    this->appSecret = appSecret;
-    this->serverURL = serverURL;
-    _begin          = true;
-    _udpListener.begin(&receiveQueue);
+    this->appKey     = appKey;
+    this->appSecret  = appSecret;
+    this->serverURLs = serverURLs;
+    _deferredResponses.onSend([this](JsonDocument& responseMessage, const MessageRoute& route, uint32_t traceId, const std::vector<CoalescedReply>& coalesced) {
+        sendDeviceResponse(responseMessage, route, traceId, coalesced);
+    });
+#ifdef SINRICPRO_STATE_SHADOW
+    _moduleCommandHandler.onStateSnapshot([this](JsonObject& snapshot) { addStateSnapshot(snapshot); });
+#endif
+    _begin           = true;
+    _wifiConnected  = false;
 }
 
 template <typename DeviceType>
@@ -253,17 +388,20 @@ DeviceType& SinricProClass::add(String deviceId) {
     newDevice->begin(this);
 
     devices.push_back(newDevice);
+    publishDeviceList();
     return *newDevice;
 }
 
 __attribute__((deprecated("Please use DeviceType& myDevice = SinricPro.add<DeviceType>(String);"))) void SinricProClass::add(SinricProDeviceInterface* newDevice) {
     newDevice->begin(this);
     devices.push_back(newDevice);
+    publishDeviceList();
 }
 
 __attribute__((deprecated("Please use DeviceType& myDevice = SinricPro.add<DeviceType>(String);"))) void SinricProClass::add(SinricProDeviceInterface& newDevice) {
     newDevice.begin(this);
     devices.push_back(&newDevice);
+    publishDeviceList();
 }
 
 /**
@@ -293,14 +431,232 @@ void SinricProClass::handle() {
         return;
     }
 
-    if (!isConnected()) connect();
+    SINRICPRO_PROFILE_HANDLE_START(handleStart);
+#ifdef SINRICPRO_NETWORK_TASK
+  #if defined(ESP32)
+    if (!_networkTask) xTaskCreatePinnedToCore(networkTask, "SinricPro", SINRICPRO_NETWORK_TASK_STACK_SIZE, this, SINRICPRO_NETWORK_TASK_PRIORITY, &_networkTask, SINRICPRO_NETWORK_TASK_CORE);
+  #endif
+    handleVerifiedQueue();
+#else
+    handleNetwork();
+#endif
+#ifdef SINRICPRO_STATE_SHADOW
+    if (_snapshotPending.exchange(false)) sendStateSnapshot();
+#endif
+    if (_localSync.isPending() && isConnected()) _localSync.flush([this](JsonDocument& event) { queueEvent(event); });
+    _deferredResponses.handle();
+    SINRICPRO_PROFILE_HANDLE_DONE(handleStart);
+}
+
+/**
+ * @brief Handles the network side of the communication (websocket, udp, signatures)
+ *
+ * Called by handle() unless `SINRICPRO_NETWORK_TASK` is defined. \n
+ * With `SINRICPRO_NETWORK_TASK` defined, websocket and udp i/o, json parsing, signature verification and signing
+ * run outside of your loop() and only the device callbacks are called from handle(): \n
+ * - ESP32: a task pinned to core `SINRICPRO_NETWORK_TASK_CORE` calls this function. Don't call it yourself. \n
+ * - RP2040: call this function from loop1() to run the network side on core1. \n
+ * @section handleNetwork Example-Code (RP2040)
+ * @code
+ * #define SINRICPRO_NETWORK_TASK
+ * #include <SinricPro.h>
+ * ..
+ * void loop() {
+ *   SinricPro.handle();
+ * }
+ *
+ * void loop1() {
+ *   SinricPro.handleNetwork();
+ * }
+ * @endcode
+ **/
+void SinricProClass::handleNetwork() {
+    if (!_begin) {
+        if (_websocketListener.isStarted()) _websocketListener.stop();
+        return;
+    }
+
+#ifdef SINRICPRO_NETWORK_TASK
+    if (_reconnectRequested.exchange(false)) {
+        _websocketListener.stop();
+        connect(ConnectionCause::deviceListChanged);
+    }
+
+    SinricProMessage* outboundMessage;
+    while (outboundQueue.pop(outboundMessage)) {
+        _sendIdle = false;  // before the message is counted out, see isPublished()
+        pushSendQueue(outboundMessage);
+        _outboundCount--;
+    }
+    _sendIdle = sendQueue.empty() && _fastPublish.isIdle();
+#endif
+
+    if (!handleWiFiState()) return;
+
+    if (!_websocketListener.isStarted()) connect();
     _websocketListener.handle();
     _udpListener.handle();
+#ifdef SINRICPRO_LOCAL_SERVER
+    _localServer.handle();
+#endif
+
+    bool connected = isConnected();
+    if (_wasConnected && !connected) _ackTracker.requeue(sendQueue);
+#ifdef SINRICPRO_STATE_SHADOW
+    if (!_wasConnected && connected) _snapshotPending = true;
+#endif
+    _wasConnected = connected;
+    if (connected && !_ackTracker.handle(sendQueue)) {
+        DEBUG_SINRIC("[SinricPro:handle()]: events have not been acknowledged, connection seems to be dead. Reconnecting...\r\n");
+        _websocketListener.disconnect();
+    }
 
     handleReceiveQueue();
     handleSendQueue();
 }
 
+/**
+ * @brief Time in milliseconds until handle() has to be called again
+ *
+ * Takes the next connection attempt, websocket ping / pong timeout, event acknowledge timeout and pending
+ * messages into account. Incoming requests are not predictable: they arrive whenever the server sends them, so
+ * limit the sleep time to keep your device responsive.
+ * With `SINRICPRO_NETWORK_TASK` defined, only the requests waiting for handle() are taken into account.
+ * @return `0` if handle() has work to do right now, `ULONG_MAX` if nothing is scheduled
+ * @section nextDeadlineMs Example-Code
+ * @code
+ * void loop() {
+ *   SinricPro.handle();
+ *   delay(min(SinricPro.nextDeadlineMs(), 100UL));  // lets WiFi modem / light sleep kick in
+ * }
+ * @endcode
+ **/
+unsigned long SinricProClass::nextDeadlineMs() {
+    if (!_begin) return ULONG_MAX;
+#ifdef SINRICPRO_NETWORK_TASK
+    if (!verifiedQueue.empty() || (_localSync.isPending() && isConnected())) return 0;
+    return _deferredResponses.nextTimeoutIn();
+#else
+    if ((WiFi.status() == WL_CONNECTED) != _wifiConnected) return 0;
+    if (!_wifiConnected) return ULONG_MAX;
+    if (!_websocketListener.isStarted()) return 0;
+    if (receiveQueue.size() || localQueue.size()) return 0;
+
+    bool connected = isConnected();
+    if (connected && sendQueue.size() && timestamp.getTimestamp()) return 0;
+    if (connected && _localSync.isPending()) return 0;
+
+    unsigned long deadline = _websocketListener.nextDeadlineIn();
+    if (connected) deadline = min(deadline, _ackTracker.nextTimeoutIn());
+    return min(deadline, _deferredResponses.nextTimeoutIn());
+#endif
+}
+
+/**
+ * @brief Enable fast publish mode for battery devices waking up from deep sleep
+ *
+ * Restores the clock and the last acknowledged states saved by `prepareSleep()`. \n
+ * While fast publish is enabled:
+ * - events are queued while the device is offline and sent as soon as the websocket is connected
+ *   (without waiting for the timestamp message if the clock could be restored)
+ * - every event is sent, also if it reports the same value as an earlier one (eg. a second doorbell press)
+ *
+ * Call it before sending the first event.
+ * @section enableFastPublish Example-Code
+ * @code
+ * void setup() {
+ *   setupWiFi();
+ *   SinricProContactsensor& mySensor = SinricPro[SENSOR_ID];
+ *   SinricPro.begin(APP_KEY, APP_SECRET);
+ *   SinricPro.enableFastPublish();
+ *   mySensor.sendContactEvent(digitalRead(CONTACT_PIN));
+ * }
+ *
+ * void loop() {
+ *   SinricPro.handle();
+ *   if (SinricPro.isPublished() || millis() > 10000) {
+ *     SinricPro.prepareSleep(SLEEP_MS);
+ *     ESP.deepSleep(SLEEP_MS * 1000);
+ *   }
+ * }
+ * @endcode
+ **/
+void SinricProClass::enableFastPublish() {
+    _fastPublish.begin(timestamp);
+}
+
+/**
+ * @brief `true` if fast publish is enabled and every queued event has been sent and answered by the server
+ **/
+bool SinricProClass::isPublished() {
+    if (!_fastPublish.isEnabled()) return false;
+#ifdef SINRICPRO_NETWORK_TASK
+    if (_outboundCount) return false;
+    return _sendIdle;
+#else
+    return sendQueue.empty() && _fastPublish.isIdle();
+#endif
+}
+
+/**
+ * @brief Save clock and reported states to RTC memory and close the connection before going to deep sleep
+ *
+ * @param sleepMs planned sleep duration in milliseconds. ESP8266 can't keep its clock during deep sleep and uses this value
+ * to restore the clock after a timer wakeup. ESP32 keeps its clock and ignores this value.
+ **/
+void SinricProClass::prepareSleep(uint32_t sleepMs) {
+    _fastPublish.save(timestamp, sleepMs);
+    stop();
+}
+
+#ifdef SINRICPRO_TRACE
+/**
+ * @brief Print the lifecycle trace of the most recent inbound messages as a single json line
+ *
+ * Only available if `SINRICPRO_TRACE` is defined. The trace is also part of the health report.
+ * Use extras/trace_decode.py to render per-stage latencies.
+ * @param output where to print the trace (eg. `Serial`)
+ **/
+void SinricProClass::dumpTrace(Print& output) {
+    Trace.dump(output);
+}
+#endif
+
+#ifdef SINRICPRO_PROFILE
+/**
+ * @brief Set callback function for blocking device / module callbacks
+ *
+ * Gets called after a callback (like `onPowerState`) took longer than `SINRICPRO_CALLBACK_BUDGET` ms.
+ * Only available if `SINRICPRO_PROFILE` is defined.
+ * @param cb Function pointer to a `SlowCallbackHandler` function
+ * @see SlowCallbackHandler
+ **/
+void SinricProClass::onSlowCallback(SlowCallbackHandler cb) {
+    Profiler.onSlowCallback(cb);
+}
+
+/**
+ * @brief Get callback durations per action (max, histogram and p99 via `percentile(99)`)
+ **/
+const std::vector<CallbackStats>& SinricProClass::getCallbackStats() {
+    return Profiler.getCallbackStats();
+}
+
+/**
+ * @brief Get the durations of handle() calls
+ **/
+const TimingStats& SinricProClass::getHandleStats() {
+    return Profiler.getHandleStats();
+}
+
+/**
+ * @brief Get the gaps between two handle() calls (your loop() latency)
+ **/
+const TimingStats& SinricProClass::getLoopGapStats() {
+    return Profiler.getLoopGapStats();
+}
+#endif
+
 JsonDocument SinricProClass::prepareRequest(String deviceId, const char* action) {
     JsonDocument requestMessage;
     JsonObject   header                     = requestMessage[FSTR_SINRICPRO_header].to<JsonObject>();
@@ -318,16 +674,19 @@ JsonDocument SinricProClass::prepareRequest(String deviceId, const char* action)
 }
 
 void SinricProClass::handleResponse(JsonDocument& responseMessage) {
-    (void)responseMessage;
     DEBUG_SINRIC("[SinricPro.handleResponse()]:\r\n");
 
+    String replyToken = responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_replyToken] | "";
+    _ackTracker.acknowledged(replyToken);
+    _fastPublish.acknowledged(replyToken, responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_success] | false);
+
 #ifndef NODEBUG_SINRIC
     serializeJsonPretty(responseMessage, DEBUG_ESP_PORT);
     Serial.println();
 #endif
 }
 
-void SinricProClass::handleModuleRequest(JsonDocument& requestMessage, interface_t Interface) {
+void SinricProClass::handleModuleRequest(JsonDocument& requestMessage, const MessageRoute& route) {
     DEBUG_SINRIC("[SinricPro.handleModuleScopeRequest()]: handling module scope request\r\n");
 #ifndef NODEBUG_SINRIC
     serializeJsonPretty(requestMessage, DEBUG_ESP_PORT);
@@ -340,7 +699,13 @@ void SinricProClass::handleModuleRequest(JsonDocument& requestMessage, interface
     JsonObject       response_value = responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_value];
     SinricProRequest request{action, "", request_value, response_value};
 
+    SINRICPRO_METRIC_START(callbackStart);
+    SINRICPRO_PROFILE_START(profileStart);
     bool success = _moduleCommandHandler.handleRequest(request);
+    SINRICPRO_PROFILE_CALLBACK(profileStart, "", action);
+    SINRICPRO_METRIC_STOP(callback, callbackStart);
+    SINRICPRO_TRACE_STAGE(currentTraceId, callbackReturned);
+    SINRICPRO_TRACE_RESULT(currentTraceId, success);
 
     responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_success] = success;
     responseMessage[FSTR_SINRICPRO_payload].remove(FSTR_SINRICPRO_deviceId);
@@ -355,10 +720,47 @@ void SinricProClass::handleModuleRequest(JsonDocument& requestMessage, interface
 
     String responseString;
     serializeJson(responseMessage, responseString);
-    sendQueue.push(new SinricProMessage(Interface, responseString.c_str()));
+    SinricProMessage* response = new SinricProMessage(route, responseString.c_str());
+    PrioritySendQueue::classify(response, responseMessage);
+    response->setTraceId(currentTraceId);
+    SINRICPRO_TRACE_STAGE(currentTraceId, responseQueued);
+    queueOutbound(response);
+}
+
+#ifdef SINRICPRO_STATE_SHADOW
+/**
+ * @brief Add the last known states of all devices to `snapshot`, keyed by deviceId (devices without a known state are skipped)
+ */
+void SinricProClass::addStateSnapshot(JsonObject& snapshot) {
+    for (auto& device : devices) {
+        JsonDocument state = device->getState();
+        if (state.size()) snapshot[device->getDeviceId()] = state;
+    }
+}
+
+/**
+ * @brief Send the states of all devices in a single module scope event
+ *
+ * Sent once after every connect to resync the server, instead of one event per device and capability.
+ * Events reporting a state which is already known are dropped by the capabilities, so a sketch which resends
+ * all states from `onConnected` doesn't cause a flood of events.
+ */
+void SinricProClass::sendStateSnapshot() {
+    JsonDocument eventMessage = prepareEvent("", FSTR_SNAPSHOT_stateSnapshot, FSTR_SNAPSHOT_RECONNECT);
+    JsonObject   payload      = eventMessage[FSTR_SINRICPRO_payload];
+    payload.remove(FSTR_SINRICPRO_deviceId);
+    payload[FSTR_SINRICPRO_scope] = FSTR_SINRICPRO_module;
+
+    JsonObject snapshot = payload[FSTR_SINRICPRO_value][FSTR_SNAPSHOT_devices].to<JsonObject>();
+    addStateSnapshot(snapshot);
+    if (!snapshot.size()) return;
+
+    DEBUG_SINRIC("[SinricPro:sendStateSnapshot()]: sending states of %i device(s)\r\n", snapshot.size());
+    sendMessage(eventMessage);
 }
+#endif
 
-void SinricProClass::handleDeviceRequest(JsonDocument& requestMessage, interface_t Interface) {
+void SinricProClass::handleDeviceRequest(JsonDocument& requestMessage, const MessageRoute& route, const std::vector<CoalescedReply>& coalesced) {
     DEBUG_SINRIC("[SinricPro.handleDeviceRequest()]: handling device sope request\r\n");
 #ifndef NODEBUG_SINRIC
     serializeJsonPretty(requestMessage, DEBUG_ESP_PORT);
@@ -374,6 +776,9 @@ void SinricProClass::handleDeviceRequest(JsonDocument& requestMessage, interface
     JsonObject  request_value  = requestMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_value];
     JsonObject  response_value = responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_value];
 
+    bool fromServer = route.interface == IF_WEBSOCKET;
+    if (fromServer) _echoSuppressor.expect(requestMessage);  // events sent from the callback
+
     for (auto& device : devices) {
         if (device->getDeviceId() == deviceId && success == false) {
             SinricProRequest request{
@@ -381,7 +786,14 @@ void SinricProClass::handleDeviceRequest(JsonDocument& requestMessage, interface
                 instance,
                 request_value,
                 response_value};
+            SINRICPRO_TRACE_DEVICE(currentTraceId, &device - devices.data());
+            _deferredResponses.requestStarted();
+            SINRICPRO_METRIC_START(callbackStart);
+            SINRICPRO_PROFILE_START(profileStart);
             success                                                         = device->handleRequest(request);
+            SINRICPRO_PROFILE_CALLBACK(profileStart, deviceId, action);
+            SINRICPRO_METRIC_STOP(callback, callbackStart);
+            SINRICPRO_TRACE_STAGE(currentTraceId, callbackReturned);
             responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_success] = success;
             if (!success) {
                 if (responseMessageStr.length() > 0) {
@@ -394,54 +806,211 @@ void SinricProClass::handleDeviceRequest(JsonDocument& requestMessage, interface
         }
     }
 
+    SINRICPRO_TRACE_RESULT(currentTraceId, success);
+    if (fromServer) _echoSuppressor.forget(requestMessage);  // the final response is remembered when it gets sent
+
+    if (_deferredResponses.store(responseMessage, route, currentTraceId, coalesced, success)) return;
+    sendDeviceResponse(responseMessage, route, currentTraceId, coalesced);
+}
+
+/**
+ * @brief Queue the final response of a device request (right away or when its deferred response completes)
+ *
+ * The requests coalesced into the request get the same response. Successful local requests are recorded for the
+ * server (LocalSync), responses to the server are remembered to suppress echoing events.
+ */
+void SinricProClass::sendDeviceResponse(JsonDocument& responseMessage, const MessageRoute& route, uint32_t traceId, const std::vector<CoalescedReply>& coalesced) {
+    bool   success = responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_success] | false;
+    String action  = responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_action] | "";
+
+    if (coalesced.size()) {  // answer the requests that have been merged into this request
+        String replyToken = responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_replyToken] | "";
+        String clientId   = responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_clientId] | "";
+        for (auto& reply : coalesced) {
+            responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_replyToken] = reply.replyToken;
+            responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_clientId]   = reply.clientId;
+            String responseString;
+            serializeJson(responseMessage, responseString);
+            SinricProMessage* response = new SinricProMessage(reply.route, responseString.c_str());
+            PrioritySendQueue::classify(response, responseMessage);
+            response->setTraceId(reply.traceId);
+            SINRICPRO_TRACE_REQUEST(reply.traceId, reply.replyToken, action);
+            SINRICPRO_TRACE_RESULT(reply.traceId, success);
+            SINRICPRO_TRACE_STAGE(reply.traceId, responseQueued);
+            queueOutbound(response);
+        }
+        responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_replyToken] = replyToken;
+        responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_clientId]   = clientId;
+    }
+
+    if (route.interface != IF_WEBSOCKET) {  // local request
+        if (success) {
+            String deviceId = responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_deviceId] | "";
+            _localSync.record(responseMessage, prepareEvent(deviceId, LocalSync::eventAction(action).c_str(), FSTR_SINRICPRO_PHYSICAL_INTERACTION));
+        }
+    } else {
+        _echoSuppressor.responded(responseMessage);
+    }
+
     String responseString;
     serializeJson(responseMessage, responseString);
-    sendQueue.push(new SinricProMessage(Interface, responseString.c_str()));
+    SinricProMessage* response = new SinricProMessage(route, responseString.c_str());
+    PrioritySendQueue::classify(response, responseMessage);
+    response->setTraceId(traceId);
+    SINRICPRO_TRACE_STAGE(traceId, responseQueued);
+    queueOutbound(response);
 }
 
+/**
+ * @brief Passes a verified request to the module or the device it belongs to
+ */
+void SinricProClass::handleRequest(VerifiedRequest& request) {
+    JsonDocument& requestMessage = request.requestMessage;
+    SINRICPRO_METRIC_START(dispatchStart);
+    SINRICPRO_TRACE_REQUEST(currentTraceId, requestMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_replyToken] | "", requestMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_action] | "");
+    SINRICPRO_TRACE_STAGE(currentTraceId, dispatched);
+    String scope = requestMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_scope] | FSTR_SINRICPRO_device;
+    if (strcmp(FSTR_SINRICPRO_module, scope.c_str()) == 0) {
+        handleModuleRequest(requestMessage, request.route);
+    } else {
+        handleDeviceRequest(requestMessage, request.route, request.coalesced);
+    }
+    SINRICPRO_METRIC_STOP(dispatch, dispatchStart);
+}
+
+/**
+ * @brief Handle a verified request directly or hand it over to the application (network task)
+ */
+void SinricProClass::dispatchRequest(VerifiedRequest* request) {
+#ifdef SINRICPRO_NETWORK_TASK
+    if (!verifiedQueue.push(request)) {
+        DEBUG_SINRIC("[SinricPro.dispatchRequest()]: verifiedQueue is full, request has been rejected\r\n");
+        SINRICPRO_METRIC_COUNT(dropped);
+        SINRICPRO_TRACE_OUTCOME(request->traceId, dropped);
+        handleBusyRequest(*request);
+        delete request;
+    }
+#else
+    currentTraceId = request->traceId;
+    handleRequest(*request);
+    currentTraceId = 0;
+    delete request;
+#endif
+}
+
+/**
+ * @brief Push a message for the server into the sendQueue (via outboundQueue if the network task owns the sendQueue)
+ */
+void SinricProClass::queueOutbound(SinricProMessage* message) {
+#ifdef SINRICPRO_NETWORK_TASK
+    _outboundCount++;
+    if (!outboundQueue.push(message)) {
+        _outboundCount--;
+        DEBUG_SINRIC("[SinricPro:queueOutbound()]: outboundQueue is full, message has been dropped\r\n");
+        SINRICPRO_METRIC_COUNT(dropped);
+        delete message;
+    }
+#else
+    pushSendQueue(message);
+#endif
+}
+
+#ifdef SINRICPRO_NETWORK_TASK
+void SinricProClass::handleVerifiedQueue() {
+    VerifiedRequest* request;
+    while (verifiedQueue.pop(request)) {
+        currentTraceId = request->traceId;
+        handleRequest(*request);
+        currentTraceId = 0;
+        delete request;
+    }
+}
+
+  #if defined(ESP32)
+void SinricProClass::networkTask(void* arg) {
+    SinricProClass* sinricPro = static_cast<SinricProClass*>(arg);
+    for (;;) {
+        sinricPro->handleNetwork();
+        vTaskDelay(1);
+    }
+}
+  #endif
+#endif
+
 void SinricProClass::handleReceiveQueue() {
     if (receiveQueue.size() == 0) return;
 
     DEBUG_SINRIC("[SinricPro.handleReceiveQueue()]: %i message(s) in receiveQueue\r\n", receiveQueue.size());
+    RequestCoalescer requests;
     while (receiveQueue.size() > 0) {
         SinricProMessage* rawMessage = receiveQueue.front();
         receiveQueue.pop();
+        if (rawMessage->getInterface() == IF_UDP) _udpListener.released();
+#ifdef SINRICPRO_LOCAL_SERVER
+        if (rawMessage->getInterface() == IF_LOCAL_WEBSOCKET) _localServer.released();
+#endif
+        uint32_t traceId = rawMessage->getTraceId();
+        SINRICPRO_TRACE_STAGE(traceId, dequeued);
+        SINRICPRO_METRIC_START(parseStart);
         JsonDocument jsonMessage;
         deserializeJson(jsonMessage, rawMessage->getMessage());
+        SINRICPRO_METRIC_STOP(parse, parseStart);
 
         bool sigMatch = false;
 
         if (strncmp(rawMessage->getMessage(), "{\"timestamp\":", 13) == 0 && strlen(rawMessage->getMessage()) <= 26) {
             sigMatch = true;  // timestamp message has no signature...ignore sigMatch for this!
         } else {
+            SINRICPRO_METRIC_START(verifyStart);
             String signature           = jsonMessage[FSTR_SINRICPRO_signature][FSTR_SINRICPRO_HMAC] | "";
             String payload             = extractPayload(rawMessage->getMessage());
             String calculatedSignature = calculateSignature(appSecret.c_str(), payload);
             sigMatch                   = (calculatedSignature == signature);
+            SINRICPRO_METRIC_STOP(verify, verifyStart);
         }
 
         String messageType = jsonMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_type];
 
         if (sigMatch) {  // signature is valid process message
             DEBUG_SINRIC("[SinricPro.handleReceiveQueue()]: Signature is valid. Processing message...\r\n");
+            SINRICPRO_TRACE_STAGE(traceId, verified);
             extractTimestamp(jsonMessage);
-            if (messageType == FSTR_SINRICPRO_response) handleResponse(jsonMessage);
+            if (messageType == FSTR_SINRICPRO_response) {
+                SINRICPRO_METRIC_COUNT(responses);
+                SINRICPRO_TRACE_REQUEST(traceId, jsonMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_replyToken] | "", jsonMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_action] | "");
+                SINRICPRO_TRACE_OUTCOME(traceId, response);
+                handleResponse(jsonMessage);
+            }
             if (messageType == FSTR_SINRICPRO_request) {
-                String scope = jsonMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_scope] | FSTR_SINRICPRO_device;
-                if (strcmp(FSTR_SINRICPRO_module, scope.c_str()) == 0) {
-                    handleModuleRequest(jsonMessage, rawMessage->getInterface());
+                SINRICPRO_METRIC_COUNT(requests);
+                String replyToken = jsonMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_replyToken] | "";
+                String cachedResponse;
+                if (_responseCache.isDuplicate(replyToken, rawMessage->getRoute(), cachedResponse)) {
+                    SINRICPRO_METRIC_COUNT(duplicates);
+                    SINRICPRO_TRACE_REQUEST(traceId, replyToken.c_str(), jsonMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_action] | "");
+                    SINRICPRO_TRACE_OUTCOME(traceId, duplicate);
+                    if (cachedResponse.length()) {
+                        DEBUG_SINRIC("[SinricPro.handleReceiveQueue()]: Request has already been handled. Sending cached response...\r\n");
+                        sendSigned(rawMessage->getRoute(), cachedResponse);
+                    } else {
+                        DEBUG_SINRIC("[SinricPro.handleReceiveQueue()]: Request is already being handled. Duplicate will be answered with its response\r\n");
+                    }
                 } else {
-                    handleDeviceRequest(jsonMessage, rawMessage->getInterface());
+                    requests.add(new VerifiedRequest{std::move(jsonMessage), rawMessage->getRoute(), traceId, {}});
                 }
-            };
+            }
         } else {
-            handleInvalidSignatureRequest(jsonMessage, rawMessage->getInterface());
+            SINRICPRO_METRIC_COUNT(invalidSignatures);
+            SINRICPRO_TRACE_OUTCOME(traceId, invalidSignature);
+            handleInvalidSignatureRequest(jsonMessage, rawMessage->getRoute());
         }
         delete rawMessage;
     }
+
+    while (VerifiedRequest* request = requests.next()) dispatchRequest(request);
 }
 
-void SinricProClass::handleInvalidSignatureRequest(JsonDocument& requestMessage, interface_t Interface) { 
+void SinricProClass::handleInvalidSignatureRequest(JsonDocument& requestMessage, const MessageRoute& route) { 
     DEBUG_SINRIC("[SinricPro.handleInvalidSignatureRequest()]: Signature is invalid!\r\n");
     
 #ifndef NODEBUG_SINRIC
@@ -454,66 +1023,250 @@ void SinricProClass::handleInvalidSignatureRequest(JsonDocument& requestMessage,
 
     String responseString;
     serializeJson(responseMessage, responseString);
-    sendQueue.push(new SinricProMessage(Interface, responseString.c_str()));
+    SinricProMessage* response = new SinricProMessage(route, responseString.c_str());
+    PrioritySendQueue::classify(response, responseMessage);
+    pushSendQueue(response);
+}
+
+#ifdef SINRICPRO_NETWORK_TASK
+/**
+ * @brief Answer a request (and the requests coalesced into it) with failure because the application is busy
+ *
+ * The replyTokens are removed from the response cache, so a retransmission is handled as a new request. Duplicates
+ * which have been received while the request was waiting get the same answer.
+ */
+void SinricProClass::handleBusyRequest(VerifiedRequest& request) {
+    JsonDocument responseMessage                                    = prepareResponse(request.requestMessage);
+    responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_message] = "Device is busy";
+    if (responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_scope] == FSTR_SINRICPRO_module) responseMessage[FSTR_SINRICPRO_payload].remove(FSTR_SINRICPRO_deviceId);
+
+    auto respond = [&](const MessageRoute& route, const String& replyToken) {
+        String responseString;
+        serializeJson(responseMessage, responseString);
+        std::vector<MessageRoute> routes = _responseCache.remove(replyToken);  // duplicates received meanwhile
+        routes.insert(routes.begin(), route);
+        for (size_t i = 0; i < routes.size(); i++) {
+            if (i && routes[i].isSamePeer(route)) continue;
+            SinricProMessage* response = new SinricProMessage(routes[i], responseString.c_str());
+            PrioritySendQueue::classify(response, responseMessage);
+            pushSendQueue(response);
+        }
+    };
+
+    respond(request.route, request.requestMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_replyToken] | "");
+    for (auto& reply : request.coalesced) {
+        responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_replyToken] = reply.replyToken;
+        responseMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_clientId]   = reply.clientId;
+        respond(reply.route, reply.replyToken);
+    }
 }
+#endif
 
 void SinricProClass::handleSendQueue() {
-    if (!isConnected()) return;
-    if (!timestamp.getTimestamp()) return;
-    while (sendQueue.size() > 0) {
+    handleLocalQueue();
+    if (!isConnected() || !timestamp.getTimestamp()) {
+        sendQueue.pause();
+        return;
+    }
+    SINRICPRO_METRIC_GAUGE(sendQueue, sendQueue.size());
+    for (size_t burst = 0; burst < SINRICPRO_SEND_BURST && !sendQueue.empty(); burst++) {
         DEBUG_SINRIC("[SinricPro:handleSendQueue()]: %i message(s) in sendQueue\r\n", sendQueue.size());
-        DEBUG_SINRIC("[SinricPro:handleSendQueue()]: Sending message...\r\n");
+        SinricProMessage* rawMessage = sendQueue.pop();
+        SINRICPRO_METRIC_WAIT(rawMessage);
+        sendQueuedMessage(rawMessage);
+        delete rawMessage;
+    }
+}
 
-        SinricProMessage* rawMessage = sendQueue.front();
-        sendQueue.pop();
+/**
+ * @brief Answer local (udp) requests right away, no matter if the server is connected
+ *
+ * Responses are signed with the local clock (set by the server or by the last request received).
+ */
+void SinricProClass::handleLocalQueue() {
+    while (!localQueue.empty()) {
+        SinricProMessage* rawMessage = localQueue.front();
+        localQueue.pop();
+        SINRICPRO_METRIC_WAIT(rawMessage);
+        sendQueuedMessage(rawMessage);
+        SINRICPRO_METRIC_STOP(localRoundTrip, rawMessage->getRoute().receivedAt);
+        delete rawMessage;
+    }
+}
 
-        JsonDocument jsonMessage;
-        deserializeJson(jsonMessage, rawMessage->getMessage());
-        jsonMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_createdAt] = timestamp.getTimestamp();
-        signMessage(appSecret, jsonMessage);
+/**
+ * @brief Push a message into the sendQueue, local (udp / local websocket) messages into the localQueue (network side)
+ */
+void SinricProClass::pushSendQueue(SinricProMessage* message) {
+    if (message->getInterface() == IF_WEBSOCKET) {
+        sendQueue.push(message);
+    } else {
+        localQueue.push(message);
+    }
+}
 
-        String messageStr;
+/**
+ * @brief Sign and send a message from the sendQueue / localQueue
+ */
+void SinricProClass::sendQueuedMessage(SinricProMessage* rawMessage) {
+    DEBUG_SINRIC("[SinricPro:sendQueuedMessage()]: Sending message...\r\n");
+    SINRICPRO_METRIC_START(signStart);
+    JsonDocument jsonMessage;
+    deserializeJson(jsonMessage, rawMessage->getMessage());
+
+    String messageType = jsonMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_type] | "";
+    String replyToken  = jsonMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_replyToken] | "";
+    bool   isEvent     = messageType == FSTR_SINRICPRO_event && rawMessage->getInterface() == IF_WEBSOCKET;
+    if (isEvent && _ackTracker.isAcknowledged(replyToken)) {
+        DEBUG_SINRIC("[SinricPro:sendQueuedMessage()]: event has been acknowledged meanwhile, retransmission has been dropped\r\n");
+        _ackTracker.discarded(replyToken);
+        return;
+    }
+    if (isEvent && _fastPublish.isEnabled()) _fastPublish.sent(jsonMessage);
 
-        serializeJson(jsonMessage, messageStr);
+    jsonMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_createdAt] = timestamp.getTimestamp();
+    signMessage(appSecret, jsonMessage);
+
+    String messageStr;
+
+    serializeJson(jsonMessage, messageStr);
+    SINRICPRO_METRIC_STOP(sign, signStart);
 #ifndef NODEBUG_SINRIC
-        serializeJsonPretty(jsonMessage, DEBUG_ESP_PORT);
-        Serial.println();
-#endif
-
-        switch (rawMessage->getInterface()) {
-            case IF_WEBSOCKET:
-                DEBUG_SINRIC("[SinricPro:handleSendQueue]: Sending to websocket\r\n");
-                _websocketListener.sendMessage(messageStr);
-                break;
-            case IF_UDP:
-                DEBUG_SINRIC("[SinricPro:handleSendQueue]: Sending to UDP\r\n");
-                _udpListener.sendMessage(messageStr);
-                break;
-            default:
-                break;
+    serializeJsonPretty(jsonMessage, DEBUG_ESP_PORT);
+    Serial.println();
+#endif
+
+    sendSigned(rawMessage->getRoute(), messageStr);
+
+    if (messageType == FSTR_SINRICPRO_response) {
+        for (auto& route : _responseCache.store(replyToken, messageStr)) {
+            if (route.isSamePeer(rawMessage->getRoute())) continue;  // already answered by this response
+            DEBUG_SINRIC("[SinricPro:sendQueuedMessage()]: answering a duplicate which has been received meanwhile\r\n");
+            sendSigned(route, messageStr);
         }
-        delete rawMessage;
-        DEBUG_SINRIC("[SinricPro:handleSendQueue()]: message sent.\r\n");
     }
+    if (isEvent) {
+        String action = jsonMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_action] | "";
+        String cause  = jsonMessage[FSTR_SINRICPRO_payload][FSTR_SINRICPRO_cause][FSTR_SINRICPRO_type] | "";
+        _ackTracker.sent(replyToken, action, rawMessage->getMessage(), cause != FSTR_SINRICPRO_PERIODIC_POLL);
+    }
+    SINRICPRO_TRACE_STAGE(rawMessage->getTraceId(), sent);
+    DEBUG_SINRIC("[SinricPro:sendQueuedMessage()]: message sent.\r\n");
+}
+
+/**
+ * @brief Send an already signed message
+ */
+void SinricProClass::sendSigned(const MessageRoute& route, String& message) {
+    switch (route.interface) {
+        case IF_WEBSOCKET: {
+            DEBUG_SINRIC("[SinricPro:sendSigned]: Sending to websocket\r\n");
+            SINRICPRO_METRIC_START(sendStart);
+            _websocketListener.sendMessage(message);
+            SINRICPRO_METRIC_STOP(send, sendStart);
+            SINRICPRO_METRIC_COUNT(websocketSent);
+            break;
+        }
+        case IF_UDP: {
+            DEBUG_SINRIC("[SinricPro:sendSigned]: Sending to UDP\r\n");
+            SINRICPRO_METRIC_START(sendStart);
+            _udpListener.sendMessage(message, route.remoteIP, route.remotePort);
+            SINRICPRO_METRIC_STOP(send, sendStart);
+            SINRICPRO_METRIC_COUNT(udpSent);
+            break;
+        }
+#ifdef SINRICPRO_LOCAL_SERVER
+        case IF_LOCAL_WEBSOCKET: {
+            DEBUG_SINRIC("[SinricPro:sendSigned]: Sending to local websocket client %i\r\n", route.client);
+            SINRICPRO_METRIC_START(sendStart);
+            _localServer.sendMessage(message, route.client, route.remoteIP);
+            SINRICPRO_METRIC_STOP(send, sendStart);
+            SINRICPRO_METRIC_COUNT(localSent);
+            break;
+        }
+#endif
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Tracks the WiFi connection and suspends / resumes the listeners on every change
+ *
+ * @return `true` if WiFi is connected, `false` otherwise
+ */
+bool SinricProClass::handleWiFiState() {
+    bool wifiConnected = (WiFi.status() == WL_CONNECTED);
+    if (wifiConnected == _wifiConnected) return wifiConnected;
+
+    _wifiConnected = wifiConnected;
+    if (wifiConnected) {
+        DEBUG_SINRIC("[SinricPro:handle()]: WiFi connected\r\n");
+        _udpListener.begin(&receiveQueue);
+#ifdef SINRICPRO_LOCAL_SERVER
+        _localServer.begin(&receiveQueue, getDeviceList());
+#endif
+        _websocketListener.resume();
+    } else {
+        DEBUG_SINRIC("[SinricPro:handle()]: WiFi disconnected\r\n");
+        _udpListener.stop();
+#ifdef SINRICPRO_LOCAL_SERVER
+        _localServer.stop();
+#endif
+        _websocketListener.suspend();
+    }
+    return wifiConnected;
 }
 
-void SinricProClass::connect() {
+/**
+ * @brief All device ids separated by `;` (network side)
+ *
+ * With `SINRICPRO_NETWORK_TASK` defined, `devices` is owned by the application. The list is built by
+ * publishDeviceList() and handed over to the network side.
+ */
+String SinricProClass::getDeviceList() {
+#ifdef SINRICPRO_NETWORK_TASK
+    if (String* deviceList = _pendingDeviceList.exchange(nullptr)) {
+        _deviceList = *deviceList;
+        delete deviceList;
+    }
+    return _deviceList;
+#else
     String deviceList;
     int    i = 0;
     for (auto& device : devices) {
-        String deviceId = device->getDeviceId();
         if (i > 0) deviceList += ';';
         deviceList += device->getDeviceId();
         i++;
     }
+    return deviceList;
+#endif
+}
 
-    _websocketListener.begin(serverURL, appKey, deviceList, &receiveQueue);
+/**
+ * @brief Hand the device list over to the network side after a device has been added (application side)
+ */
+void SinricProClass::publishDeviceList() {
+#ifdef SINRICPRO_NETWORK_TASK
+    String* deviceList = new String();
+    for (auto& device : devices) {
+        if (deviceList->length()) *deviceList += ';';
+        *deviceList += device->getDeviceId();
+    }
+    delete _pendingDeviceList.exchange(deviceList);
+#endif
+}
+
+void SinricProClass::connect(ConnectionCause cause) {
+    _websocketListener.begin(serverURLs, appKey, getDeviceList(), &receiveQueue, cause);
 }
 
 void SinricProClass::stop() {
     _begin = false;
     DEBUG_SINRIC("[SinricPro:stop()\r\n");
+#ifndef SINRICPRO_NETWORK_TASK
     _websocketListener.stop();
+#endif  // otherwise the network task stops the listener
 }
 
 bool SinricProClass::isConnected() {
@@ -594,15 +1347,173 @@ void SinricProClass::onPong(PongCallback cb) {
     _websocketListener.onPong(cb);
 }
 
+/**
+ * @brief Set callback function for connection attempts
+ *
+ * Gets called every time a new connection attempt to the SinricPro server is started.
+ * Attempts are delayed by an exponential backoff with random jitter and are not started while WiFi is disconnected.
+ *
+ * @param cb Function pointer to a `ConnectionAttemptCallback` function
+ * @return void
+ * @see ConnectionAttemptCallback
+ **/
+void SinricProClass::onConnectionAttempt(ConnectionAttemptCallback cb) {
+    _websocketListener.onConnectionAttempt(cb);
+}
+
+/**
+ * @brief Get the most recent connection attempt
+ *
+ * @return `ConnectionAttempt` containing the timestamp (millis) and cause of the attempt
+ **/
+const ConnectionAttempt& SinricProClass::getLastConnectionAttempt() {
+    return _websocketListener.getLastConnectionAttempt();
+}
+
+/**
+ * @brief Get the timings of the most recent successful connection
+ *
+ * Measured from the start of the connection attempt until the server address was resolved,
+ * the websocket was connected and the first message (timestamp) was received.
+ * @return `ConnectionLatency`
+ **/
+const ConnectionLatency& SinricProClass::getConnectionLatency() {
+    return _websocketListener.getConnectionLatency();
+}
+
+/**
+ * @brief Get heap usage of the websocket connection
+ *
+ * Free heap and largest free block before and after the last (tls) handshake and the minimum while connected.
+ * The difference between `freeBeforeHandshake` and `minFreeConnected` is the memory held by the connection.
+ * @return `HeapStats`
+ **/
+const HeapStats& SinricProClass::getHeapStats() {
+    return _websocketListener.getHeapStats();
+}
+
+/**
+ * @brief Get the tls memory profile of the websocket connection
+ *
+ * Negotiated max fragment length, buffer sizes of the secure client and the largest free block required for a handshake.
+ * @return `TlsStats`
+ **/
+const TlsStats& SinricProClass::getTlsStats() {
+    return _websocketListener.getTlsStats();
+}
+
+/**
+ * @brief Get acknowledge statistics for sent events
+ *
+ * One entry per event action with the number of acknowledged, timed out and retransmitted events and the acknowledge latency.
+ * @return `std::vector<AckStats>`
+ **/
+const std::vector<AckStats>& SinricProClass::getAckStats() {
+    return _ackTracker.getStats();
+}
+
+/**
+ * @brief Get the number of suppressed events
+ *
+ * An event is suppressed if it repeats the state of a response sent less than `SINRICPRO_ECHO_WINDOW` ms ago
+ * (eg. `sendPowerStateEvent` called from `onPowerState`).
+ * @return number of suppressed events
+ **/
+uint32_t SinricProClass::getSuppressedEchoes() {
+    return _echoSuppressor.getSuppressedCount();
+}
+
+/**
+ * @brief Get the number of retransmitted requests
+ *
+ * A request with the replyToken of one of the last `SINRICPRO_RESPONSE_CACHE_SIZE` requests is answered with the
+ * cached response (or dropped while the original request is still being handled) without calling the callback again.
+ * @return number of duplicate requests
+ **/
+uint32_t SinricProClass::getDuplicateRequests() {
+    return _responseCache.getDuplicateCount();
+}
+
+/**
+ * @brief Get the statistics of the udp admission control
+ *
+ * Counts the accepted datagrams and the datagrams rejected before parsing: too large (`SINRICPRO_UDP_MAX_SIZE`),
+ * too many waiting udp messages (`SINRICPRO_UDP_QUEUE_SHARE`) and rate limited per source (`SINRICPRO_UDP_RATE`).
+ * @return `UdpStats`
+ **/
+const UdpStats& SinricProClass::getUdpStats() {
+    return _udpListener.getStats();
+}
+
+/**
+ * @brief Set the preferred server
+ *
+ * Use this to restore the index reported by `onServerPreferenceChanged` after a reboot.
+ * @param index index into the server list passed to `begin()`
+ **/
+void SinricProClass::setPreferredServer(size_t index) {
+    _websocketListener.setPreferredServer(index);
+}
+
+/**
+ * @brief Set callback function for server preference changes
+ *
+ * Gets called when a different server becomes the preferred server (lower latency or failover).
+ * @param cb Function pointer to a `ServerPreferenceCallback` function
+ * @see ServerPreferenceCallback
+ **/
+void SinricProClass::onServerPreferenceChanged(ServerPreferenceCallback cb) {
+    _websocketListener.onServerPreferenceChanged(cb);
+}
+
+/**
+ * @brief Get the url of the server used for the current / last connection
+ **/
+const String& SinricProClass::getCurrentServer() {
+    return _websocketListener.getCurrentServer();
+}
+
+/**
+ * @brief Get the last server selection (selected index and reason)
+ **/
+const ServerSelection& SinricProClass::getServerSelection() {
+    return _websocketListener.getServerSelection();
+}
+
+/**
+ * @brief Get connection statistics for every server
+ *
+ * @return `std::vector<ServerStats>` in the order passed to `begin()`
+ **/
+const std::vector<ServerStats>& SinricProClass::getServerStats() {
+    return _websocketListener.getServerStats();
+}
+
+/**
+ * @brief Get the state of the adaptive websocket heartbeat
+ *
+ * Contains the current ping interval and pong timeout, the learned safe interval and round trip time statistics
+ * including a histogram (see `RTT_HISTOGRAM_BOUNDS`).
+ * @return `HeartbeatStats`
+ **/
+const HeartbeatStats& SinricProClass::getHeartbeatStats() {
+    return _websocketListener.getHeartbeatStats();
+}
+
 void SinricProClass::reconnect() {
+#ifdef SINRICPRO_NETWORK_TASK
+    // the listener is owned by the network task
+    _reconnectRequested = true;
+    return;
+#endif
     DEBUG_SINRIC("SinricPro:reconnect(): disconnecting\r\n");
-    stop();
+    _websocketListener.stop();
     DEBUG_SINRIC("SinricPro:reconnect(): connecting\r\n");
-    connect();
+    connect(ConnectionCause::deviceListChanged);
 }
 
 void SinricProClass::onConnect() {
-    DEBUG_SINRIC("[SinricPro]: Connected to \"%s\"!]\r\n", serverURL.c_str());
+    DEBUG_SINRIC("[SinricPro]: Connected to \"%s\"!]\r\n", getCurrentServer().c_str());
 }
 
 void SinricProClass::onDisconnect() {
@@ -629,14 +1540,37 @@ void SinricProClass::extractTimestamp(JsonDocument& message) {
 }
 
 void SinricProClass::sendMessage(JsonDocument& jsonMessage) {
-    if (!isConnected()) {
+    if (_echoSuppressor.isEcho(jsonMessage)) {
+        DEBUG_SINRIC("[SinricPro:sendMessage()]: state has just been sent in a response, message has been dropped\r\n");
+        SINRICPRO_METRIC_COUNT(echoes);
+        return;
+    }
+    if (!isQueueingAllowed()) {
         DEBUG_SINRIC("[SinricPro:sendMessage()]: device is offline, message has been dropped\r\n");
+        SINRICPRO_METRIC_COUNT(dropped);
         return;
     }
-    DEBUG_SINRIC("[SinricPro:sendMessage()]: pushing message into sendQueue\r\n");
+    queueEvent(jsonMessage);  // fast publish drops already reported states when the event is sent
+}
+
+/**
+ * @brief `true` if events are accepted: the server is connected or fast publish queues them until it is
+ */
+bool SinricProClass::isQueueingAllowed() {
+    return isConnected() || _fastPublish.isEnabled();
+}
+
+/**
+ * @brief Queue an event for the server
+ */
+void SinricProClass::queueEvent(JsonDocument& jsonMessage) {
+    SINRICPRO_METRIC_COUNT(events);
+    DEBUG_SINRIC("[SinricPro:queueEvent()]: pushing message into sendQueue\r\n");
     String messageString;
     serializeJson(jsonMessage, messageString);
-    sendQueue.push(new SinricProMessage(IF_WEBSOCKET, messageString.c_str()));
+    SinricProMessage* message = new SinricProMessage(IF_WEBSOCKET, messageString.c_str());
+    PrioritySendQueue::classify(message, jsonMessage);
+    queueOutbound(message);
 }
 
 /**
@@ -678,6 +1612,37 @@ void SinricProClass::setResponseMessage(String&& message) {
     responseMessageStr = message;
 }
 
+/**
+ * @brief Defer the response of the request which is currently handled
+ *
+ * Call this from a device callback (like `onDoorState` or `onLockState`) to answer the request later, when the hardware
+ * has finished. Return `true` from the callback, then complete the returned handle with the final result.
+ * If the response is not completed within `timeout` ms, the request is answered with failure.
+ * @param timeout time in ms to complete the response
+ * @return `DeferredResponse` handle (unbound if called outside of a device callback or if too many responses are pending)
+ * @section deferResponse Example-Code
+ * @code
+ * DeferredResponse pendingLock;
+ *
+ * bool onLockState(const String& deviceId, bool& lockState) {
+ *   startMotor(lockState);
+ *   pendingLock = SinricPro.deferResponse();
+ *   return true;
+ * }
+ *
+ * void loop() {
+ *   SinricPro.handle();
+ *   if (pendingLock.isPending() && motorFinished()) {
+ *     pendingLock.value()["state"] = isLocked() ? "LOCKED" : "UNLOCKED";
+ *     pendingLock.complete(!motorFailed(), "Motor jammed");
+ *   }
+ * }
+ * @endcode
+ **/
+DeferredResponse SinricProClass::deferResponse(unsigned long timeout) {
+    return _deferredResponses.defer(timeout);
+}
+
 /**
  * @brief
  *
@@ -58,6 +58,72 @@
 #define UDP_MULTICAST_PORT 3333
 #endif
 
+// UDP admission control Configuration
+#ifndef SINRICPRO_UDP_MAX_SIZE
+#define SINRICPRO_UDP_MAX_SIZE 1024  // bytes
+#endif
+
+#ifndef SINRICPRO_UDP_QUEUE_SHARE
+#define SINRICPRO_UDP_QUEUE_SHARE 4  // udp messages waiting in the receive queue
+#endif
+
+#ifndef SINRICPRO_UDP_QUEUE_RESERVED
+#define SINRICPRO_UDP_QUEUE_RESERVED 2  // part of the queue share which unknown sources can't use
+#endif
+
+#ifndef SINRICPRO_UDP_RATE
+#define SINRICPRO_UDP_RATE 5  // datagrams per second and source
+#endif
+
+#ifndef SINRICPRO_UDP_BURST
+#define SINRICPRO_UDP_BURST 10  // datagrams a source may send at once
+#endif
+
+#ifndef SINRICPRO_UDP_SOURCES
+#define SINRICPRO_UDP_SOURCES 8  // source addresses tracked by the rate limit
+#endif
+
+#ifndef SINRICPRO_UDP_SOURCE_IDLE
+#define SINRICPRO_UDP_SOURCE_IDLE 30000  // ms after which a tracked source may be replaced by a new one
+#endif
+
+// Local websocket server Configuration (only used if SINRICPRO_LOCAL_SERVER is defined)
+#ifndef SINRICPRO_LOCAL_SERVER_PORT
+#define SINRICPRO_LOCAL_SERVER_PORT 8080
+#endif
+
+#ifndef SINRICPRO_LOCAL_SERVER_TXT_IDS
+#define SINRICPRO_LOCAL_SERVER_TXT_IDS 8  // device ids per mDNS TXT record
+#endif
+
+#ifndef SINRICPRO_LOCAL_SERVER_MAX_SIZE
+#define SINRICPRO_LOCAL_SERVER_MAX_SIZE 2048  // bytes
+#endif
+
+#ifndef SINRICPRO_LOCAL_SERVER_QUEUE_SHARE
+#define SINRICPRO_LOCAL_SERVER_QUEUE_SHARE 4  // local websocket messages waiting in the receive queue
+#endif
+
+#ifndef SINRICPRO_LOCAL_SERVER_QUEUE_RESERVED
+#define SINRICPRO_LOCAL_SERVER_QUEUE_RESERVED 1  // part of the queue share which unknown clients can't use
+#endif
+
+#ifndef SINRICPRO_LOCAL_SERVER_RATE
+#define SINRICPRO_LOCAL_SERVER_RATE 10  // messages per second and client address
+#endif
+
+#ifndef SINRICPRO_LOCAL_SERVER_BURST
+#define SINRICPRO_LOCAL_SERVER_BURST 20  // messages a client address may send at once
+#endif
+
+#ifndef SINRICPRO_LOCAL_SERVER_SOURCES
+#define SINRICPRO_LOCAL_SERVER_SOURCES 5  // client addresses tracked by the rate limit (clients of WebSocketsServer)
+#endif
+
+#ifndef SINRICPRO_LOCAL_SERVER_SOURCE_IDLE
+#define SINRICPRO_LOCAL_SERVER_SOURCE_IDLE 30000  // ms after which a tracked client address may be replaced by a new one
+#endif
+
 // WebSocket Configuration
 #ifdef DEBUG_WIFI_ISSUE
   #define WEBSOCKET_PING_INTERVAL 10000
@@ -67,6 +133,187 @@
 #define WEBSOCKET_PING_TIMEOUT 10000
 #define WEBSOCKET_RETRY_COUNT 2
 
+// Adaptive heartbeat: ping interval is kept between MIN and MAX, pong timeout between MIN_PONG_TIMEOUT and WEBSOCKET_PING_TIMEOUT
+#ifndef SINRICPRO_HEARTBEAT_MIN_INTERVAL
+#define SINRICPRO_HEARTBEAT_MIN_INTERVAL 15000
+#endif
+
+#ifndef SINRICPRO_HEARTBEAT_MAX_INTERVAL
+#define SINRICPRO_HEARTBEAT_MAX_INTERVAL WEBSOCKET_PING_INTERVAL
+#endif
+
+#ifndef SINRICPRO_HEARTBEAT_START_INTERVAL
+#define SINRICPRO_HEARTBEAT_START_INTERVAL 60000
+#endif
+
+#ifndef SINRICPRO_HEARTBEAT_PROBE_COUNT
+#define SINRICPRO_HEARTBEAT_PROBE_COUNT 3
+#endif
+
+#ifndef SINRICPRO_HEARTBEAT_MIN_PONG_TIMEOUT
+#define SINRICPRO_HEARTBEAT_MIN_PONG_TIMEOUT 2000
+#endif
+
+#ifndef SINRICPRO_HEARTBEAT_RECOVERY_TIME
+#define SINRICPRO_HEARTBEAT_RECOVERY_TIME 3600000  // ms without idle disconnect before the safe interval is raised again
+#endif
+
+// Reconnect Configuration
+#ifndef SINRICPRO_RECONNECT_MIN_DELAY
+#define SINRICPRO_RECONNECT_MIN_DELAY 2000
+#endif
+
+#ifndef SINRICPRO_RECONNECT_MAX_DELAY
+#define SINRICPRO_RECONNECT_MAX_DELAY 60000
+#endif
+
+#ifndef SINRICPRO_DNS_CACHE_TTL
+#define SINRICPRO_DNS_CACHE_TTL 300000
+#endif
+
+// Server selection: a server is skipped after MAX_FAILURES failed attempts in a row for RETRY_INTERVAL ms
+#ifndef SINRICPRO_SERVER_MAX_FAILURES
+#define SINRICPRO_SERVER_MAX_FAILURES 3
+#endif
+
+#ifndef SINRICPRO_SERVER_RETRY_INTERVAL
+#define SINRICPRO_SERVER_RETRY_INTERVAL 600000
+#endif
+
+#ifndef SINRICPRO_SERVER_PROBE_INTERVAL
+#define SINRICPRO_SERVER_PROBE_INTERVAL 600000  // ms after which a reconnect measures the next other server once
+#endif
+
+// Heap Configuration
+#ifndef SINRICPRO_HEAP_SAMPLE_INTERVAL
+#define SINRICPRO_HEAP_SAMPLE_INTERVAL 1000
+#endif
+
+// Minimum contiguous free heap required to start a connection attempt (0 = derived from the tls buffer sizes)
+#ifndef SINRICPRO_TLS_MIN_FREE_BLOCK
+#define SINRICPRO_TLS_MIN_FREE_BLOCK 0
+#endif
+
+// TLS Configuration (BearSSL: ESP8266 / RP2040)
+#ifndef SINRICPRO_TLS_FRAGMENT_LENGTH
+#define SINRICPRO_TLS_FRAGMENT_LENGTH 1024  // max fragment length to negotiate: 512, 1024, 2048, 4096 (0 = default buffers)
+#endif
+
+#ifndef SINRICPRO_TLS_TX_BUFFER
+#define SINRICPRO_TLS_TX_BUFFER 512
+#endif
+
+// Event acknowledge Configuration
+#ifndef SINRICPRO_ACK_TIMEOUT
+#define SINRICPRO_ACK_TIMEOUT 5000
+#endif
+
+#ifndef SINRICPRO_ACK_MAX_RETRANSMITS
+#define SINRICPRO_ACK_MAX_RETRANSMITS 1
+#endif
+
+#ifndef SINRICPRO_ACK_MAX_MISSES
+#define SINRICPRO_ACK_MAX_MISSES 2
+#endif
+
+#ifndef SINRICPRO_ACK_TABLE_SIZE
+#define SINRICPRO_ACK_TABLE_SIZE 8
+#endif
+
+#ifndef SINRICPRO_ACK_STATS_SIZE
+#define SINRICPRO_ACK_STATS_SIZE 8
+#endif
+
+// Deferred response Configuration
+#ifndef SINRICPRO_DEFERRED_SIZE
+#define SINRICPRO_DEFERRED_SIZE 4
+#endif
+
+#ifndef SINRICPRO_DEFERRED_TIMEOUT
+#define SINRICPRO_DEFERRED_TIMEOUT 5000
+#endif
+
+// Echo suppression Configuration (SINRICPRO_ECHO_WINDOW 0 = disabled)
+#ifndef SINRICPRO_ECHO_WINDOW
+#define SINRICPRO_ECHO_WINDOW 2000
+#endif
+
+#ifndef SINRICPRO_ECHO_TABLE_SIZE
+#define SINRICPRO_ECHO_TABLE_SIZE 8
+#endif
+
+// Send queue Configuration
+#ifndef SINRICPRO_SEND_BURST
+#define SINRICPRO_SEND_BURST 8  // maximum messages sent per handle() call
+#endif
+
+#ifndef SINRICPRO_SEND_MAX_WAIT
+#define SINRICPRO_SEND_MAX_WAIT 2000  // ms a lower priority message may wait before it is sent first
+#endif
+
+// Local control Configuration (state changes made by udp requests while the server is not reachable)
+#ifndef SINRICPRO_LOCAL_SYNC_SIZE
+#define SINRICPRO_LOCAL_SYNC_SIZE 8
+#endif
+
+// Response cache Configuration (number of replyTokens / responses kept to answer retransmitted requests)
+#ifndef SINRICPRO_RESPONSE_CACHE_SIZE
+#define SINRICPRO_RESPONSE_CACHE_SIZE 4
+#endif
+#ifndef SINRICPRO_RESPONSE_CACHE_WAITING
+#define SINRICPRO_RESPONSE_CACHE_WAITING 2  // duplicates of a request in flight which are answered with its response
+#endif
+
+// Fast publish Configuration
+#ifndef SINRICPRO_FAST_PUBLISH_STATE_COUNT
+#define SINRICPRO_FAST_PUBLISH_STATE_COUNT 8
+#endif
+
+// ESP8266: offset in 4-byte blocks into the 512 byte RTC user memory
+#ifndef SINRICPRO_FAST_PUBLISH_RTC_OFFSET
+#define SINRICPRO_FAST_PUBLISH_RTC_OFFSET 64
+#endif
+
+// Message trace Configuration (only used if SINRICPRO_TRACE is defined)
+#ifndef SINRICPRO_TRACE_SIZE
+#define SINRICPRO_TRACE_SIZE 16
+#endif
+
+#ifndef SINRICPRO_TRACE_TOKEN_LENGTH
+#define SINRICPRO_TRACE_TOKEN_LENGTH 8
+#endif
+
+#ifndef SINRICPRO_TRACE_ACTION_COUNT
+#define SINRICPRO_TRACE_ACTION_COUNT 16
+#endif
+
+// Profiler Configuration (only used if SINRICPRO_PROFILE is defined)
+// Callbacks taking longer than SINRICPRO_CALLBACK_BUDGET ms are reported
+#ifndef SINRICPRO_CALLBACK_BUDGET
+#define SINRICPRO_CALLBACK_BUDGET 100
+#endif
+
+#ifndef SINRICPRO_PROFILE_ACTION_COUNT
+#define SINRICPRO_PROFILE_ACTION_COUNT 16
+#endif
+
+// Network task Configuration (only used if SINRICPRO_NETWORK_TASK is defined)
+#ifndef SINRICPRO_NETWORK_TASK_CORE
+#define SINRICPRO_NETWORK_TASK_CORE 0
+#endif
+
+#ifndef SINRICPRO_NETWORK_TASK_STACK_SIZE
+#define SINRICPRO_NETWORK_TASK_STACK_SIZE 8192
+#endif
+
+#ifndef SINRICPRO_NETWORK_TASK_PRIORITY
+#define SINRICPRO_NETWORK_TASK_PRIORITY 1
+#endif
+
+#ifndef SINRICPRO_NETWORK_QUEUE_SIZE
+#define SINRICPRO_NETWORK_QUEUE_SIZE 16
+#endif
+
 // EventLimiter Configuration
 #ifndef EVENT_LIMIT_STATE
 #define EVENT_LIMIT_STATE         1000
@@ -9,6 +9,7 @@
 
 #include "SinricProRequest.h"
 #include "SinricProDeviceInterface.h"
+#include "StateShadow.h"
 #include <map>
 
 #include "SinricProNamespace.h"
@@ -28,10 +29,12 @@ public:
   bool                                 operator==(const String& other);
 
   virtual String                       getDeviceId();
+  virtual JsonDocument                 getState();
 protected:
   virtual                              ~SinricProDevice();
 
   void                                 registerRequestHandler(const SinricProRequestHandler &requestHandler);
+  void                                 registerStateHandler(const SinricProStateHandler &stateHandler);
   unsigned long                        getTimestamp();
   String                               sign(const String& message);
   virtual bool                         sendEvent(JsonDocument &event);
@@ -43,6 +46,9 @@ protected:
 
   String                               deviceId;
   std::vector<SinricProRequestHandler> requestHandlers;
+#ifdef SINRICPRO_STATE_SHADOW
+  std::vector<SinricProStateHandler>   stateHandlers;
+#endif
 
 private:
   SinricProInterface                   *eventSender;
@@ -81,23 +87,49 @@ String SinricProDevice::sign(const String& message) {
 }
 
 bool SinricProDevice::sendEvent(JsonDocument& event) {
-  if (!SinricPro.isConnected()) {
+  if (!eventSender) return false;
+
+  if (!eventSender->isQueueingAllowed()) {
     DEBUG_SINRIC("[SinricProDevice::sendEvent]: The event could not be sent. No connection to the SinricPro server.\r\n");
     return false;
   }
 
-  if (eventSender) {
-    eventSender->sendMessage(event);
-    return true;
-  }
-  
-  return false;
+  eventSender->sendMessage(event);
+  return true;
 }
 
 void SinricProDevice::registerRequestHandler(const SinricProRequestHandler &requestHandler) {
   requestHandlers.push_back(requestHandler);
 }
 
+void SinricProDevice::registerStateHandler(const SinricProStateHandler &stateHandler) {
+#ifdef SINRICPRO_STATE_SHADOW
+  stateHandlers.push_back(stateHandler);
+#else
+  (void)stateHandler;
+#endif
+}
+
+/**
+ * @brief Get the last known states of all capabilities (requires `SINRICPRO_STATE_SHADOW`)
+ * 
+ * States are known after they have been set by an accepted request or reported by a sent event.
+ * @return JsonDocument like `{"powerState":"On","brightness":50}` (empty object if no state is known)
+ * @section getState Example-Code
+ * @code
+ * serializeJson(myLight.getState(), Serial);
+ * @endcode
+ **/
+JsonDocument SinricProDevice::getState() {
+  JsonDocument state;
+  state.to<JsonObject>();
+#ifdef SINRICPRO_STATE_SHADOW
+  JsonObject states = state.as<JsonObject>();
+  for (auto& stateHandler : stateHandlers) stateHandler(states);
+#endif
+  return state;
+}
+
 unsigned long SinricProDevice::getTimestamp() {
   if (eventSender) return eventSender->getTimestamp();
   return 0;
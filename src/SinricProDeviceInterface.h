@@ -14,6 +14,7 @@ class SinricProDeviceInterface {
     virtual String        getProductType()                         = 0;
     virtual void          begin(SinricProInterface* eventSender)   = 0;
     virtual unsigned long getTimestamp()                           = 0;
+    virtual JsonDocument  getState()                               = 0;
 };
 
 }  // namespace SINRICPRO_NAMESPACE
\ No newline at end of file
@@ -21,6 +21,7 @@ class SinricProInterface {
     virtual JsonDocument  prepareEvent(String deviceId, const char* action, const char* cause) = 0;
     virtual unsigned long getTimestamp()                                                       = 0;
     virtual bool          isConnected()                                                        = 0;
+    virtual bool          isQueueingAllowed()                                                  = 0;
 };
 
 }  // namespace SINRICPRO_NAMESPACE
\ No newline at end of file
@@ -0,0 +1,204 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+/*
+ * The local websocket server is only available if SINRICPRO_LOCAL_SERVER is defined (before including SinricPro.h).
+ */
+
+#ifdef SINRICPRO_LOCAL_SERVER
+
+#if defined(ESP8266)
+    #include <ESP8266WiFi.h>
+    #include <ESP8266mDNS.h>
+#elif defined(ESP32)
+    #include <WiFi.h>
+    #include <ESPmDNS.h>
+#else
+    #error "SINRICPRO_LOCAL_SERVER is only supported on ESP8266 and ESP32"
+#endif
+
+#include <WebSocketsServer.h>
+
+#include "SinricProConfig.h"
+#include "SinricProDebug.h"
+#include "SinricProMetrics.h"
+#include "SinricProNamespace.h"
+#include "SinricProQueue.h"
+#include "SinricProTrace.h"
+#include "SinricProVersion.h"
+#include "UdpAdmission.h"
+namespace SINRICPRO_NAMESPACE {
+
+/**
+ * @brief Local websocket server for hub apps on the local network
+ *
+ * Accepts the same signed messages as the SinricPro server connection (signed with the app secret), requests are
+ * handled by the same pipeline and answered on the connection they came from. The server is advertised via mDNS as
+ * `_sinricpro._tcp` with the SDK version and the device ids (TXT records `deviceids0`, `deviceids1`, .. with up to
+ * `SINRICPRO_LOCAL_SERVER_TXT_IDS` ids separated by `;`).
+ * Messages pass an admission control like udp datagrams (size, receive queue share and rate per client address) with
+ * its own limits (`SINRICPRO_LOCAL_SERVER_MAX_SIZE`, `_QUEUE_SHARE`, `_RATE`, ..) before they are queued. A rejected
+ * message is answered with a failed response ("Device is busy" / "Message is too large") carrying its replyToken, so
+ * the client doesn't wait for a timeout. These answers are not signed: signing would be the HMAC work the admission
+ * control saves. A response is only sent if its client is still connected from the address of the request.
+ */
+class LocalServerListener {
+  public:
+    LocalServerListener();
+
+    void begin(SinricProQueue_t* receiveQueue, const String& deviceIds);
+    void handle();
+    void sendMessage(String& message, uint8_t client, const IPAddress& remoteIP);
+    void released();
+    void stop();
+
+  protected:
+    void advertise(const String& deviceIds);
+    void onEvent(uint8_t client, WStype_t type, uint8_t* payload, size_t length);
+    void sendRejected(uint8_t client, const char* message, size_t length);
+
+    WebSocketsServer  _server;
+    UdpAdmission      _admission;
+    SinricProQueue_t* receiveQueue;
+    bool              started;
+};
+
+LocalServerListener::LocalServerListener()
+    : _server(SINRICPRO_LOCAL_SERVER_PORT)
+    , _admission(AdmissionLimits{SINRICPRO_LOCAL_SERVER_MAX_SIZE, SINRICPRO_LOCAL_SERVER_QUEUE_SHARE, SINRICPRO_LOCAL_SERVER_QUEUE_RESERVED, SINRICPRO_LOCAL_SERVER_RATE,
+                                 SINRICPRO_LOCAL_SERVER_BURST, SINRICPRO_LOCAL_SERVER_SOURCES, SINRICPRO_LOCAL_SERVER_SOURCE_IDLE})
+    , receiveQueue(nullptr)
+    , started(false) {}
+
+void LocalServerListener::begin(SinricProQueue_t* receiveQueue, const String& deviceIds) {
+    this->receiveQueue = receiveQueue;
+    if (started) stop();
+
+    _server.onEvent([this](uint8_t client, WStype_t type, uint8_t* payload, size_t length) { onEvent(client, type, payload, length); });
+    _server.begin();
+    _server.enableHeartbeat(WEBSOCKET_PING_INTERVAL, WEBSOCKET_PING_TIMEOUT, WEBSOCKET_RETRY_COUNT);
+    advertise(deviceIds);
+    started = true;
+    DEBUG_SINRIC("[SinricPro:LocalServer]: listening on port %i\r\n", SINRICPRO_LOCAL_SERVER_PORT);
+}
+
+void LocalServerListener::handle() {
+    if (!started) return;
+    _server.loop();
+#if defined(ESP8266)
+    MDNS.update();
+#endif
+}
+
+void LocalServerListener::sendMessage(String& message, uint8_t client, const IPAddress& remoteIP) {
+    if (!started) return;
+    if (!_server.clientIsConnected(client) || !(_server.remoteIP(client) == remoteIP)) {  // the slot may have been reused by another peer
+        DEBUG_SINRIC("[SinricPro:LocalServer]: client %i has disconnected, response dropped\r\n", client);
+        return;
+    }
+    _server.sendTXT(client, message);
+}
+
+/**
+ * @brief A local websocket message has been taken from the receive queue
+ */
+void LocalServerListener::released() {
+    _admission.released();
+}
+
+void LocalServerListener::stop() {
+    if (!started) return;
+    MDNS.end();
+    _server.close();
+    started = false;
+}
+
+void LocalServerListener::advertise(const String& deviceIds) {
+    String mac      = WiFi.macAddress();
+    mac.replace(":", "");
+    String hostname = "sinricpro-" + mac.substring(6);
+    hostname.toLowerCase();
+    if (!MDNS.begin(hostname.c_str())) {
+        DEBUG_SINRIC("[SinricPro:LocalServer]: mDNS responder could not be started\r\n");
+        return;
+    }
+
+    MDNS.addService("sinricpro", "tcp", SINRICPRO_LOCAL_SERVER_PORT);
+    MDNS.addServiceTxt("sinricpro", "tcp", "version", SINRICPRO_VERSION);
+
+    int start = 0;
+    for (int chunk = 0; start < (int)deviceIds.length(); chunk++) {
+        int end = start - 1;
+        for (int ids = 0; ids < SINRICPRO_LOCAL_SERVER_TXT_IDS && (end = deviceIds.indexOf(';', end + 1)) >= 0; ids++) {}
+        if (end < 0) end = deviceIds.length();
+        String key = "deviceids" + String(chunk);
+        MDNS.addServiceTxt("sinricpro", "tcp", key.c_str(), deviceIds.substring(start, end).c_str());
+        start = end + 1;
+    }
+    DEBUG_SINRIC("[SinricPro:LocalServer]: advertised as %s.local\r\n", hostname.c_str());
+}
+
+void LocalServerListener::onEvent(uint8_t client, WStype_t type, uint8_t* payload, size_t length) {
+    switch (type) {
+        case WStype_CONNECTED:
+            DEBUG_SINRIC("[SinricPro:LocalServer]: client %i connected from %s\r\n", client, _server.remoteIP(client).toString().c_str());
+            break;
+
+        case WStype_DISCONNECTED:
+            DEBUG_SINRIC("[SinricPro:LocalServer]: client %i disconnected\r\n", client);
+            break;
+
+        case WStype_TEXT: {
+            if (!_admission.admit((uint32_t)_server.remoteIP(client), length)) {
+                sendRejected(client, (const char*)payload, length);
+                break;
+            }
+            SinricProMessage* request = new SinricProMessage(MessageRoute{IF_LOCAL_WEBSOCKET, _server.remoteIP(client), 0, (uint32_t)micros(), client}, (char*)payload);
+            DEBUG_SINRIC("[SinricPro:LocalServer]: receiving data from client %i\r\n", client);
+            SINRICPRO_TRACE_RECEIVED(request);
+            receiveQueue->push(request);
+            SINRICPRO_METRIC_COUNT(localReceived);
+            SINRICPRO_METRIC_GAUGE(receiveQueue, receiveQueue->size());
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Answer a message which has not been admitted with a failed response
+ *
+ * The replyToken is taken from the raw message (no JSON parsing), a message without a readable replyToken is answered
+ * without one.
+ */
+void LocalServerListener::sendRejected(uint8_t client, const char* message, size_t length) {
+    const char* reason = length > _admission.getLimits().maxSize ? "Message is too large" : "Device is busy";
+
+    String      replyToken;
+    const char* token = strstr(message, "\"replyToken\":\"");
+    if (token) {
+        token += 14;
+        for (size_t i = 0; i < 64 && (isalnum(token[i]) || token[i] == '-'); i++) replyToken += token[i];
+        if (token[replyToken.length()] != '"') replyToken = "";
+    }
+
+    String response = "{\"header\":{\"payloadVersion\":2,\"signatureVersion\":1},\"payload\":{\"type\":\"response\",\"success\":false,\"message\":\"";
+    response += reason;
+    response += "\",\"replyToken\":\"";
+    response += replyToken;
+    response += "\"}}";
+    DEBUG_SINRIC("[SinricPro:LocalServer]: message of client %i rejected: %s\r\n", client, reason);
+    _server.sendTXT(client, response);
+}
+
+}  // namespace SINRICPRO_NAMESPACE
+
+#endif
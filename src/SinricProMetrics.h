@@ -0,0 +1,173 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+/*
+ * Metrics are only collected if SINRICPRO_METRICS is defined (before including SinricPro.h).
+ * Otherwise all SINRICPRO_METRIC_xxx macros compile to nothing.
+ */
+
+#ifdef SINRICPRO_METRICS
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "SinricProNamespace.h"
+namespace SINRICPRO_NAMESPACE {
+
+enum class MetricCounter : uint8_t {
+    websocketReceived,   // messages received via websocket
+    udpReceived,         // messages received via udp
+    localReceived,       // messages received via the local websocket server
+    websocketSent,       // messages sent via websocket
+    udpSent,             // messages sent via udp
+    localSent,           // messages sent via the local websocket server
+    requests,            // requests with a valid signature
+    responses,           // responses with a valid signature
+    invalidSignatures,   // messages with an invalid signature
+    events,              // events queued by devices
+    dropped,             // messages dropped (offline / queue full)
+    coalesced,           // requests merged into a later request
+    echoes,              // events suppressed because they repeat a response
+    duplicates,          // retransmitted requests answered from the response cache
+    udpOversized,        // udp datagrams rejected: larger than SINRICPRO_UDP_MAX_SIZE
+    udpQueueFull,        // udp datagrams rejected: udp share of the receiveQueue exhausted
+    udpRateLimited,      // udp datagrams rejected: per-source rate limit
+    COUNT
+};
+
+enum class MetricGauge : uint8_t {
+    receiveQueue,  // receiveQueue size
+    sendQueue,     // sendQueue size
+    COUNT
+};
+
+enum class MetricHistogram : uint8_t {
+    parse,          // deserializeJson of received messages
+    verify,         // signature verification
+    dispatch,       // complete request handling (device lookup, callback, response building)
+    callback,       // device / module callback
+    sign,           // signing and serializing outgoing messages
+    send,           // websocket sendTXT / udp send
+    waitResponse,   // time from creation until sent: responses
+    waitAlert,      // time from creation until sent: alerts
+    waitState,      // time from creation until sent: state changes
+    waitTelemetry,  // time from creation until sent: periodic telemetry
+    localRoundTrip, // udp request received until response sent
+    COUNT
+};
+
+static const uint32_t METRIC_HISTOGRAM_BOUNDS[] = {100, 500, 1000, 5000, 10000, 50000, 100000};  // upper bounds in us, last bucket is everything above
+static const size_t   METRIC_HISTOGRAM_SIZE     = sizeof(METRIC_HISTOGRAM_BOUNDS) / sizeof(METRIC_HISTOGRAM_BOUNDS[0]) + 1;
+
+static const char* const METRIC_COUNTER_NAMES[]   = {"websocketReceived", "udpReceived", "localReceived", "websocketSent", "udpSent", "localSent", "requests", "responses", "invalidSignatures", "events", "dropped", "coalesced", "echoes", "duplicates", "udpOversized", "udpQueueFull", "udpRateLimited"};
+static const char* const METRIC_GAUGE_NAMES[]     = {"receiveQueue", "sendQueue"};
+static const char* const METRIC_HISTOGRAM_NAMES[] = {"parse", "verify", "dispatch", "callback", "sign", "send", "waitResponse", "waitAlert", "waitState", "waitTelemetry", "localRoundTrip"};
+
+/**
+ * @brief Counters, gauges and fixed-bucket histograms of the request / response pipeline (static storage)
+ */
+class MetricsRegistry {
+  public:
+    void count(MetricCounter counter, uint32_t value = 1);
+    void gauge(MetricGauge gauge, uint32_t value);
+    void record(MetricHistogram histogram, uint32_t us);
+    void reset();
+
+    void toJson(JsonObject metrics) const;
+
+  protected:
+    struct Gauge {
+        uint32_t current;
+        uint32_t max;
+    };
+
+    struct Histogram {
+        uint32_t count;
+        uint64_t total;
+        uint32_t max;
+        uint32_t buckets[METRIC_HISTOGRAM_SIZE];
+    };
+
+    uint32_t  counters[(size_t)MetricCounter::COUNT]     = {};
+    Gauge     gauges[(size_t)MetricGauge::COUNT]         = {};
+    Histogram histograms[(size_t)MetricHistogram::COUNT] = {};
+};
+
+void MetricsRegistry::count(MetricCounter counter, uint32_t value) {
+    counters[(size_t)counter] += value;
+}
+
+void MetricsRegistry::gauge(MetricGauge gauge, uint32_t value) {
+    Gauge& entry  = gauges[(size_t)gauge];
+    entry.current = value;
+    if (value > entry.max) entry.max = value;
+}
+
+void MetricsRegistry::record(MetricHistogram histogram, uint32_t us) {
+    Histogram& entry = histograms[(size_t)histogram];
+    entry.count++;
+    entry.total += us;
+    if (us > entry.max) entry.max = us;
+
+    size_t bucket = 0;
+    while (bucket < METRIC_HISTOGRAM_SIZE - 1 && us > METRIC_HISTOGRAM_BOUNDS[bucket]) bucket++;
+    entry.buckets[bucket]++;
+}
+
+void MetricsRegistry::reset() {
+    memset(counters, 0, sizeof(counters));
+    memset(gauges, 0, sizeof(gauges));
+    memset(histograms, 0, sizeof(histograms));
+}
+
+void MetricsRegistry::toJson(JsonObject metrics) const {
+    JsonObject counterObject = metrics["counters"].to<JsonObject>();
+    for (size_t i = 0; i < (size_t)MetricCounter::COUNT; i++) counterObject[METRIC_COUNTER_NAMES[i]] = counters[i];
+
+    JsonObject gaugeObject = metrics["gauges"].to<JsonObject>();
+    for (size_t i = 0; i < (size_t)MetricGauge::COUNT; i++) {
+        JsonObject entry = gaugeObject[METRIC_GAUGE_NAMES[i]].to<JsonObject>();
+        entry["current"] = gauges[i].current;
+        entry["max"]     = gauges[i].max;
+    }
+
+    JsonArray bounds = metrics["histogramBounds"].to<JsonArray>();
+    for (auto bound : METRIC_HISTOGRAM_BOUNDS) bounds.add(bound);
+
+    JsonObject histogramObject = metrics["histograms"].to<JsonObject>();
+    for (size_t i = 0; i < (size_t)MetricHistogram::COUNT; i++) {
+        const Histogram& histogram = histograms[i];
+        JsonObject       entry     = histogramObject[METRIC_HISTOGRAM_NAMES[i]].to<JsonObject>();
+        entry["count"]             = histogram.count;
+        entry["avg"]               = histogram.count ? (uint32_t)(histogram.total / histogram.count) : 0;
+        entry["max"]               = histogram.max;
+        JsonArray buckets          = entry["buckets"].to<JsonArray>();
+        for (auto bucket : histogram.buckets) buckets.add(bucket);
+    }
+}
+
+MetricsRegistry Metrics;
+
+}  // namespace SINRICPRO_NAMESPACE
+
+#define SINRICPRO_METRIC_COUNT(name)         SINRICPRO_NAMESPACE::Metrics.count(SINRICPRO_NAMESPACE::MetricCounter::name)
+#define SINRICPRO_METRIC_GAUGE(name, value)  SINRICPRO_NAMESPACE::Metrics.gauge(SINRICPRO_NAMESPACE::MetricGauge::name, value)
+#define SINRICPRO_METRIC_START(timer)        uint32_t timer = micros()
+#define SINRICPRO_METRIC_STOP(name, timer)   SINRICPRO_NAMESPACE::Metrics.record(SINRICPRO_NAMESPACE::MetricHistogram::name, micros() - timer)
+#define SINRICPRO_METRIC_WAIT(message)       SINRICPRO_NAMESPACE::Metrics.record((SINRICPRO_NAMESPACE::MetricHistogram)((size_t)SINRICPRO_NAMESPACE::MetricHistogram::waitResponse + (size_t)message->getPriority()), micros() - message->getCreatedAt())
+
+#else
+
+#define SINRICPRO_METRIC_COUNT(name)
+#define SINRICPRO_METRIC_GAUGE(name, value)
+#define SINRICPRO_METRIC_START(timer)
+#define SINRICPRO_METRIC_STOP(name, timer)
+#define SINRICPRO_METRIC_WAIT(message)
+
+#endif
@@ -11,6 +11,9 @@
 #include "SinricProStrings.h"
 #include "SinricProNamespace.h"
 #include "SinricProDebug.h"
+#include "SinricProMetrics.h"
+#include "SinricProProfiler.h"
+#include "SinricProTrace.h"
 #include "Capabilities/SettingController.h"
 
 namespace SINRICPRO_NAMESPACE {
@@ -27,10 +30,14 @@ FSTR(SETTINGS, id);             // "id"
 FSTR(SETTINGS, value);          // "value"
 FSTR(INSIGHTS, health);         // "health"
 FSTR(INSIGHTS, report);         // "report"
+FSTR(SNAPSHOT, stateSnapshot);  // "stateSnapshot"
+FSTR(SNAPSHOT, devices);        // "devices"
+FSTR(SNAPSHOT, RECONNECT);      // "RECONNECT"
 
 using OTAUpdateCallbackHandler = std::function<bool(const String& url, int major, int minor, int patch, bool forceUpdate)>;
 using SetSettingCallbackHandler = std::function<bool(const String& id, SettingValue& value)>;
 using ReportHealthCallbackHandler = std::function<bool(String& healthReport)>;
+using StateSnapshotCallbackHandler = std::function<void(JsonObject& devices)>;
 
 class SinricProModuleCommandHandler {
   public:
@@ -41,17 +48,24 @@ class SinricProModuleCommandHandler {
     void onOTAUpdate(OTAUpdateCallbackHandler callback);
     void onSetSetting(SetSettingCallbackHandler callback);
     void onReportHealth(ReportHealthCallbackHandler callback);
+    void onStateSnapshot(StateSnapshotCallbackHandler callback);
 
   private:
+#if defined(SINRICPRO_METRICS) || defined(SINRICPRO_TRACE) || defined(SINRICPRO_PROFILE)
+    void addSdkReport(String& healthReport);
+#endif
+
     OTAUpdateCallbackHandler _otaUpdateCallbackHandler;
     SetSettingCallbackHandler _setSettingCallbackHandler;
     ReportHealthCallbackHandler _reportHealthCallbackHandler;
+    StateSnapshotCallbackHandler _stateSnapshotCallbackHandler;
 };
 
 SinricProModuleCommandHandler::SinricProModuleCommandHandler()
     : _otaUpdateCallbackHandler(nullptr),
      _setSettingCallbackHandler(nullptr),
-     _reportHealthCallbackHandler(nullptr) {}
+     _reportHealthCallbackHandler(nullptr),
+     _stateSnapshotCallbackHandler(nullptr) {}
 
 SinricProModuleCommandHandler::~SinricProModuleCommandHandler() {}
 
@@ -67,6 +81,39 @@ void SinricProModuleCommandHandler::onReportHealth(ReportHealthCallbackHandler c
   _reportHealthCallbackHandler = callback;
 }
 
+/**
+ * @brief Set the function which adds the states of all devices to a state snapshot (keyed by deviceId)
+ */
+void SinricProModuleCommandHandler::onStateSnapshot(StateSnapshotCallbackHandler callback) {
+  _stateSnapshotCallbackHandler = callback;
+}
+
+#if defined(SINRICPRO_METRICS) || defined(SINRICPRO_TRACE) || defined(SINRICPRO_PROFILE)
+/**
+ * @brief Add sdk metrics ("sdkMetrics"), message trace ("sdkTrace") and profile ("sdkProfile") to the health report
+ *
+ * If `healthReport` is a json object, they are added to it. Otherwise the report is wrapped into a new json object as "report".
+ */
+void SinricProModuleCommandHandler::addSdkReport(String& healthReport) {
+  JsonDocument report;
+  if (!healthReport.length() || deserializeJson(report, healthReport) || !report.is<JsonObject>()) {
+    report.clear();
+    if (healthReport.length()) report["report"] = healthReport;
+  }
+#ifdef SINRICPRO_METRICS
+  Metrics.toJson(report["sdkMetrics"].to<JsonObject>());
+#endif
+#ifdef SINRICPRO_TRACE
+  Trace.toJson(report["sdkTrace"].to<JsonObject>());
+#endif
+#ifdef SINRICPRO_PROFILE
+  Profiler.toJson(report["sdkProfile"].to<JsonObject>());
+#endif
+  healthReport = "";
+  serializeJson(report, healthReport);
+}
+#endif
+
 bool SinricProModuleCommandHandler::handleRequest(SinricProRequest &request) {
   if (strcmp(FSTR_OTA_otaUpdateAvailable, request.action.c_str()) == 0 && _otaUpdateCallbackHandler) {
     String url = request.request_value[FSTR_OTA_url];        
@@ -114,6 +161,17 @@ bool SinricProModuleCommandHandler::handleRequest(SinricProRequest &request) {
 
     return success;
   } 
+#if defined(SINRICPRO_METRICS) || defined(SINRICPRO_TRACE) || defined(SINRICPRO_PROFILE)
+  else if (strcmp(FSTR_INSIGHTS_health, request.action.c_str()) == 0) {
+    String healthReport = "";
+    bool success = _reportHealthCallbackHandler ? _reportHealthCallbackHandler(healthReport) : true;
+    if (success) {
+      addSdkReport(healthReport);
+      request.response_value[FSTR_INSIGHTS_report] = healthReport;
+    }
+    return success;
+  }
+#else
   else if (strcmp(FSTR_INSIGHTS_health, request.action.c_str()) == 0 && _reportHealthCallbackHandler) {    
     String healthReport = "";
     bool success = _reportHealthCallbackHandler(healthReport);
@@ -122,6 +180,12 @@ bool SinricProModuleCommandHandler::handleRequest(SinricProRequest &request) {
     }
     return success;
   }
+#endif
+  else if (strcmp(FSTR_SNAPSHOT_stateSnapshot, request.action.c_str()) == 0 && _stateSnapshotCallbackHandler) {
+    JsonObject devices = request.response_value[FSTR_SNAPSHOT_devices].to<JsonObject>();
+    _stateSnapshotCallbackHandler(devices);
+    return true;
+  }
   else {
      DEBUG_SINRIC("[SinricProModuleCommandHandler:handleRequest]: action: %s not supported!\r\n", request.action.c_str());
   }
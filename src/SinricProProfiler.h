@@ -0,0 +1,194 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+/*
+ * Callbacks and handle() calls are only timed if SINRICPRO_PROFILE is defined (before including SinricPro.h).
+ * Otherwise all SINRICPRO_PROFILE_xxx macros compile to nothing.
+ */
+
+#ifdef SINRICPRO_PROFILE
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <functional>
+#include <vector>
+
+#include "SinricProConfig.h"
+#include "SinricProDebug.h"
+#include "SinricProNamespace.h"
+namespace SINRICPRO_NAMESPACE {
+
+static const uint32_t PROFILE_HISTOGRAM_BOUNDS[] = {100, 1000, 10000, 50000, 100000, 500000, 1000000};  // upper bounds in us, last bucket is everything above
+static const size_t   PROFILE_HISTOGRAM_SIZE     = sizeof(PROFILE_HISTOGRAM_BOUNDS) / sizeof(PROFILE_HISTOGRAM_BOUNDS[0]) + 1;
+
+/**
+ * @brief Duration histogram (microseconds)
+ */
+struct TimingStats {
+    uint32_t count;                            ///< number of measurements
+    uint32_t maxDuration;                      ///< longest duration in us
+    uint32_t buckets[PROFILE_HISTOGRAM_SIZE];  ///< count per PROFILE_HISTOGRAM_BOUNDS bucket
+
+    void     record(uint32_t us);
+    uint32_t percentile(uint8_t percent) const;
+};
+
+/**
+ * @brief Callback durations of a single action (eg. "setPowerState"), "other" for the actions beyond
+ * `SINRICPRO_PROFILE_ACTION_COUNT` - 1
+ */
+struct CallbackStats {
+    String      action;  ///< action
+    TimingStats timing;  ///< callback durations
+};
+
+/**
+ * @brief Callback definition for onSlowCallback function
+ *
+ * Gets called after a device / module callback exceeded `SINRICPRO_CALLBACK_BUDGET` ms.
+ * @param deviceId   deviceId of the device ("" for module requests)
+ * @param action     action of the request
+ * @param durationMs duration of the callback in ms
+ */
+using SlowCallbackHandler = std::function<void(const String& deviceId, const String& action, uint32_t durationMs)>;
+
+void TimingStats::record(uint32_t us) {
+    count++;
+    if (us > maxDuration) maxDuration = us;
+
+    size_t bucket = 0;
+    while (bucket < PROFILE_HISTOGRAM_SIZE - 1 && us > PROFILE_HISTOGRAM_BOUNDS[bucket]) bucket++;
+    buckets[bucket]++;
+}
+
+/**
+ * @brief Upper bound of the bucket containing the given percentile (`maxDuration` for the last bucket)
+ */
+uint32_t TimingStats::percentile(uint8_t percent) const {
+    if (!count) return 0;
+    uint32_t rank       = (count * percent + 99) / 100;
+    uint32_t cumulative = 0;
+    for (size_t bucket = 0; bucket < PROFILE_HISTOGRAM_SIZE - 1; bucket++) {
+        cumulative += buckets[bucket];
+        if (cumulative >= rank) return min(PROFILE_HISTOGRAM_BOUNDS[bucket], maxDuration);
+    }
+    return maxDuration;
+}
+
+/**
+ * @brief Times device / module callbacks per action, handle() calls and the gaps between handle() calls
+ */
+class CallbackProfiler {
+  public:
+    void callbackDone(const String& deviceId, const String& action, uint32_t us);
+    void handleStarted(uint32_t now);
+    void handleDone(uint32_t start);
+    void onSlowCallback(SlowCallbackHandler cb);
+
+    const std::vector<CallbackStats>& getCallbackStats() const;
+    const TimingStats&                getHandleStats() const;
+    const TimingStats&                getLoopGapStats() const;
+
+    void toJson(JsonObject profile) const;
+
+  protected:
+    static void timingToJson(JsonObject object, const TimingStats& timing);
+
+    std::vector<CallbackStats> callbacks;
+    TimingStats                handleTiming = {};
+    TimingStats                loopGaps     = {};
+    uint32_t                   lastHandle   = 0;
+    bool                       started      = false;
+    SlowCallbackHandler        _slowCallbackCb;
+};
+
+void CallbackProfiler::callbackDone(const String& deviceId, const String& action, uint32_t us) {
+    CallbackStats* stats = nullptr;
+    for (auto& entry : callbacks) {
+        if (entry.action == action) stats = &entry;
+    }
+    if (!stats) {
+        // keep memory bounded: when SINRICPRO_PROFILE_ACTION_COUNT - 1 actions are recorded, all further actions share "other"
+        String name = callbacks.size() < SINRICPRO_PROFILE_ACTION_COUNT - 1 ? action : String("other");
+        for (auto& entry : callbacks) {
+            if (entry.action == name) stats = &entry;
+        }
+        if (!stats) {
+            callbacks.push_back(CallbackStats{name, {}});
+            stats = &callbacks.back();
+        }
+    }
+    stats->timing.record(us);
+
+    if (us / 1000 < SINRICPRO_CALLBACK_BUDGET) return;
+    DEBUG_SINRIC("[SinricPro:Profiler]: WARNING: callback for \"%s\" on device \"%s\" blocked for %lu ms\r\n", action.c_str(), deviceId.c_str(), (unsigned long)(us / 1000));
+    if (_slowCallbackCb) _slowCallbackCb(deviceId, action, us / 1000);
+}
+
+void CallbackProfiler::handleStarted(uint32_t now) {
+    if (started) loopGaps.record(now - lastHandle);
+    started    = true;
+    lastHandle = now;
+}
+
+void CallbackProfiler::handleDone(uint32_t start) {
+    handleTiming.record(micros() - start);
+}
+
+void CallbackProfiler::onSlowCallback(SlowCallbackHandler cb) {
+    _slowCallbackCb = cb;
+}
+
+const std::vector<CallbackStats>& CallbackProfiler::getCallbackStats() const {
+    return callbacks;
+}
+
+const TimingStats& CallbackProfiler::getHandleStats() const {
+    return handleTiming;
+}
+
+const TimingStats& CallbackProfiler::getLoopGapStats() const {
+    return loopGaps;
+}
+
+void CallbackProfiler::toJson(JsonObject profile) const {
+    JsonArray bounds = profile["histogramBounds"].to<JsonArray>();
+    for (auto bound : PROFILE_HISTOGRAM_BOUNDS) bounds.add(bound);
+
+    JsonObject callbackObject = profile["callbacks"].to<JsonObject>();
+    for (auto& entry : callbacks) timingToJson(callbackObject[entry.action].to<JsonObject>(), entry.timing);
+    timingToJson(profile["handle"].to<JsonObject>(), handleTiming);
+    timingToJson(profile["loopGap"].to<JsonObject>(), loopGaps);
+}
+
+void CallbackProfiler::timingToJson(JsonObject object, const TimingStats& timing) {
+    object["count"]   = timing.count;
+    object["max"]     = timing.maxDuration;
+    object["p99"]     = timing.percentile(99);
+    JsonArray buckets = object["buckets"].to<JsonArray>();
+    for (auto bucket : timing.buckets) buckets.add(bucket);
+}
+
+CallbackProfiler Profiler;
+
+}  // namespace SINRICPRO_NAMESPACE
+
+#define SINRICPRO_PROFILE_START(timer)                      uint32_t timer = micros()
+#define SINRICPRO_PROFILE_CALLBACK(timer, deviceId, action) SINRICPRO_NAMESPACE::Profiler.callbackDone(deviceId, action, micros() - timer)
+#define SINRICPRO_PROFILE_HANDLE_START(timer)               uint32_t timer = micros(); SINRICPRO_NAMESPACE::Profiler.handleStarted(timer)
+#define SINRICPRO_PROFILE_HANDLE_DONE(timer)                SINRICPRO_NAMESPACE::Profiler.handleDone(timer)
+
+#else
+
+#define SINRICPRO_PROFILE_START(timer)
+#define SINRICPRO_PROFILE_CALLBACK(timer, deviceId, action)
+#define SINRICPRO_PROFILE_HANDLE_START(timer)
+#define SINRICPRO_PROFILE_HANDLE_DONE(timer)
+
+#endif
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <Arduino.h>
+#include <atomic>
 #include <queue>
 
 #include "SinricProNamespace.h"
@@ -15,22 +17,77 @@ namespace SINRICPRO_NAMESPACE {
 typedef enum {
   IF_UNKNOWN    = 0,
   IF_WEBSOCKET  = 1,
-  IF_UDP        = 2
+  IF_UDP        = 2,
+  IF_LOCAL_WEBSOCKET = 3
 } interface_t;
 
+/**
+ * @brief Interface a message has been received from / has to be sent to
+ *
+ * For udp the address and port of the peer are included, so a response goes back to the client which sent the request.
+ */
+struct MessageRoute {
+  interface_t interface;
+  IPAddress   remoteIP;
+  uint16_t    remotePort;
+  uint32_t    receivedAt;  // micros() when the request has been received (udp / local websocket)
+  uint8_t     client;      // local websocket client number
+
+  /**
+   * @brief Same peer: the websocket, the same udp address and port or the same local websocket client
+   */
+  bool isSamePeer(const MessageRoute& other) const {
+    if (interface != other.interface) return false;
+    if (interface == IF_UDP) return remoteIP == other.remoteIP && remotePort == other.remotePort;
+    if (interface == IF_LOCAL_WEBSOCKET) return client == other.client && remoteIP == other.remoteIP;
+    return true;
+  }
+};
+
+/**
+ * @brief Send priority of an outgoing message (highest first)
+ */
+enum class MessagePriority : uint8_t {
+  response,   // response to a request
+  alert,      // doorbell, push notification, motion and contact events
+  state,      // state changes
+  telemetry,  // periodic sensor readings (cause PERIODIC_POLL)
+  COUNT
+};
+
 class SinricProMessage {
 public:
   SinricProMessage(interface_t interface, const char* message);
+  SinricProMessage(const MessageRoute& route, const char* message);
   ~SinricProMessage();
   const char*   getMessage() const;
   interface_t   getInterface() const;
+  const MessageRoute& getRoute() const;
+  uint32_t      getTraceId() const;
+  void          setTraceId(uint32_t traceId);
+  MessagePriority getPriority() const;
+  uint32_t      getDeviceKey() const;
+  void          setPriority(MessagePriority priority, uint32_t deviceKey);
+  uint32_t      getCreatedAt() const;
 private:
-  interface_t   _interface;
+  MessageRoute  _route;
   char*         _message;
+  uint32_t      _traceId;
+  MessagePriority _priority;
+  uint32_t      _deviceKey;
+  uint32_t      _createdAt;
 };
 
 SinricProMessage::SinricProMessage(interface_t interface, const char* message) : 
-  _interface(interface) { 
+  SinricProMessage(MessageRoute{interface, IPAddress(), 0, 0, 0}, message) {
+};
+
+SinricProMessage::SinricProMessage(const MessageRoute& route, const char* message) : 
+  _route(route),
+  _traceId(0),
+  _priority(MessagePriority::state),
+  _deviceKey(0),
+  _createdAt(micros()) { 
   _message = strdup(message); 
 };
 
@@ -43,10 +100,87 @@ const char* SinricProMessage::getMessage() const {
 };
 
 interface_t SinricProMessage::getInterface() const { 
-  return _interface; 
+  return _route.interface; 
+};
+
+const MessageRoute& SinricProMessage::getRoute() const {
+  return _route;
+};
+
+uint32_t SinricProMessage::getTraceId() const {
+  return _traceId;
+};
+
+void SinricProMessage::setTraceId(uint32_t traceId) {
+  _traceId = traceId;
+};
+
+MessagePriority SinricProMessage::getPriority() const {
+  return _priority;
+};
+
+uint32_t SinricProMessage::getDeviceKey() const {
+  return _deviceKey;
+};
+
+/**
+ * @brief Set the send priority and the key of the device the message belongs to (used to serve devices round-robin)
+ */
+void SinricProMessage::setPriority(MessagePriority priority, uint32_t deviceKey) {
+  _priority  = priority;
+  _deviceKey = deviceKey;
+};
+
+/**
+ * @brief `micros()` when the message has been created
+ */
+uint32_t SinricProMessage::getCreatedAt() const {
+  return _createdAt;
 };
 
 
 typedef std::queue<SinricProMessage*> SinricProQueue_t;
 
+/**
+ * @brief Lock-free single producer / single consumer queue
+ *
+ * Used to pass messages between the network task and the application when `SINRICPRO_NETWORK_TASK` is defined.
+ * Exactly one thread may call push() and exactly one (other) thread may call pop(). Holds up to SIZE - 1 items.
+ */
+template <typename T, size_t SIZE>
+class SinricProSpscQueue {
+public:
+  bool push(T item);
+  bool pop(T& item);
+  bool empty() const;
+private:
+  T                   buffer[SIZE];
+  std::atomic<size_t> head{0};
+  std::atomic<size_t> tail{0};
+};
+
+template <typename T, size_t SIZE>
+bool SinricProSpscQueue<T, SIZE>::push(T item) {
+  size_t currentTail = tail.load(std::memory_order_relaxed);
+  size_t nextTail    = (currentTail + 1) % SIZE;
+  if (nextTail == head.load(std::memory_order_acquire)) return false;  // full
+  buffer[currentTail] = item;
+  tail.store(nextTail, std::memory_order_release);
+  return true;
+}
+
+template <typename T, size_t SIZE>
+bool SinricProSpscQueue<T, SIZE>::pop(T& item) {
+  size_t currentHead = head.load(std::memory_order_relaxed);
+  if (currentHead == tail.load(std::memory_order_acquire)) return false;  // empty
+  item = buffer[currentHead];
+  head.store((currentHead + 1) % SIZE, std::memory_order_release);
+  return true;
+}
+
+template <typename T, size_t SIZE>
+bool SinricProSpscQueue<T, SIZE>::empty() const {
+  return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+}
+
 } // SINRICPRO_NAMESPACE
\ No newline at end of file
@@ -0,0 +1,201 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+/*
+ * Message traces are only recorded if SINRICPRO_TRACE is defined (before including SinricPro.h).
+ * Otherwise all SINRICPRO_TRACE_xxx macros compile to nothing.
+ */
+
+#ifdef SINRICPRO_TRACE
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "SinricProConfig.h"
+#include "SinricProNamespace.h"
+namespace SINRICPRO_NAMESPACE {
+
+enum class TraceStage : uint8_t {
+    received,          // pushed into the receiveQueue by the websocket / udp listener
+    dequeued,          // taken from the receiveQueue
+    verified,          // signature verified
+    dispatched,        // request handling started
+    callbackReturned,  // device / module callback returned
+    responseQueued,    // response pushed into the sendQueue
+    sent,              // response sent
+    COUNT
+};
+
+enum class TraceOutcome : uint8_t {
+    pending,           // still in progress (or lost)
+    success,           // request handled successfully
+    failed,            // device / module did not handle the request
+    invalidSignature,  // signature did not match
+    response,          // response from the server (no further stages)
+    dropped,           // dropped (queue full)
+    duplicate          // retransmitted request, answered from the response cache
+};
+
+static const uint8_t TRACE_NO_DEVICE = 0xFF;  // module request or unknown device
+
+/**
+ * @brief Fixed-size ring buffer with the lifecycle of the most recent inbound messages
+ *
+ * Every inbound message gets a trace id (stored in `SinricProMessage`). Stage times are microseconds relative
+ * to the `received` stage (0 = stage not reached). Actions are stored as index into a small action table.
+ */
+class MessageTrace {
+  public:
+    uint32_t received(uint8_t interface);
+    void     stage(uint32_t traceId, TraceStage stage);
+    void     request(uint32_t traceId, const String& replyToken, const String& action);
+    void     device(uint32_t traceId, uint8_t deviceIndex);
+    void     outcome(uint32_t traceId, TraceOutcome outcome);
+
+    void toJson(JsonObject trace) const;
+    void dump(Print& output) const;
+
+  protected:
+    struct Entry {
+        uint32_t id;
+        uint32_t receivedAt;                        // millis()
+        uint32_t receivedMicros;                    // micros()
+        uint32_t stages[(size_t)TraceStage::COUNT];
+        char     replyToken[SINRICPRO_TRACE_TOKEN_LENGTH + 1];
+        uint8_t  deviceIndex;
+        uint8_t  actionId;
+        uint8_t  interface;
+        uint8_t  outcome;
+    };
+
+    Entry*  find(uint32_t traceId);
+    uint8_t actionId(const String& action);
+
+    Entry    entries[SINRICPRO_TRACE_SIZE] = {};
+    String   actions[SINRICPRO_TRACE_ACTION_COUNT];
+    uint8_t  actionCount                   = 0;
+    uint32_t nextId                        = 1;
+};
+
+/**
+ * @brief Start a new trace for an inbound message
+ * @return trace id to be stored in the message
+ */
+uint32_t MessageTrace::received(uint8_t interface) {
+    uint32_t id = nextId++;
+    if (!nextId) nextId = 1;  // 0 = not traced
+
+    Entry& entry         = entries[id % SINRICPRO_TRACE_SIZE];
+    entry                = Entry();
+    entry.id             = id;
+    entry.receivedAt     = millis();
+    entry.receivedMicros = micros();
+    entry.deviceIndex    = TRACE_NO_DEVICE;
+    entry.actionId       = 0xFF;
+    entry.interface      = interface;
+    entry.outcome        = (uint8_t)TraceOutcome::pending;
+    return id;
+}
+
+void MessageTrace::stage(uint32_t traceId, TraceStage stage) {
+    Entry* entry = find(traceId);
+    if (!entry) return;
+    uint32_t elapsed             = micros() - entry->receivedMicros;
+    entry->stages[(size_t)stage] = elapsed ? elapsed : 1;
+}
+
+void MessageTrace::request(uint32_t traceId, const String& replyToken, const String& action) {
+    Entry* entry = find(traceId);
+    if (!entry) return;
+    strncpy(entry->replyToken, replyToken.c_str(), SINRICPRO_TRACE_TOKEN_LENGTH);
+    entry->replyToken[SINRICPRO_TRACE_TOKEN_LENGTH] = 0;
+    entry->actionId                                 = actionId(action);
+}
+
+void MessageTrace::device(uint32_t traceId, uint8_t deviceIndex) {
+    Entry* entry = find(traceId);
+    if (entry) entry->deviceIndex = deviceIndex;
+}
+
+void MessageTrace::outcome(uint32_t traceId, TraceOutcome outcome) {
+    Entry* entry = find(traceId);
+    if (entry) entry->outcome = (uint8_t)outcome;
+}
+
+/**
+ * @brief Compact json representation (decode with extras/trace_decode.py)
+ *
+ * `{"actions":[...],"entries":[[id,receivedAt,"replyToken",device,action,interface,outcome,stage1..stageN],...]}`
+ */
+void MessageTrace::toJson(JsonObject trace) const {
+    JsonArray actionArray = trace["actions"].to<JsonArray>();
+    for (uint8_t i = 0; i < actionCount; i++) actionArray.add(actions[i]);
+
+    JsonArray entryArray = trace["entries"].to<JsonArray>();
+    for (uint32_t i = 1; i <= SINRICPRO_TRACE_SIZE; i++) {
+        const Entry& entry = entries[(nextId + i - 1) % SINRICPRO_TRACE_SIZE];  // oldest first
+        if (!entry.id) continue;
+        JsonArray item = entryArray.add<JsonArray>();
+        item.add(entry.id);
+        item.add(entry.receivedAt);
+        item.add(entry.replyToken);
+        item.add(entry.deviceIndex);
+        item.add(entry.actionId);
+        item.add(entry.interface);
+        item.add(entry.outcome);
+        for (size_t stage = 1; stage < (size_t)TraceStage::COUNT; stage++) item.add(entry.stages[stage]);
+    }
+}
+
+/**
+ * @brief Print the trace as a single json line (eg. `SinricPro.dumpTrace(Serial)`)
+ */
+void MessageTrace::dump(Print& output) const {
+    JsonDocument doc;
+    toJson(doc["sdkTrace"].to<JsonObject>());
+    serializeJson(doc, output);
+    output.println();
+}
+
+MessageTrace::Entry* MessageTrace::find(uint32_t traceId) {
+    if (!traceId) return nullptr;
+    Entry& entry = entries[traceId % SINRICPRO_TRACE_SIZE];
+    return entry.id == traceId ? &entry : nullptr;  // overwritten by a newer message
+}
+
+uint8_t MessageTrace::actionId(const String& action) {
+    for (uint8_t i = 0; i < actionCount; i++) {
+        if (actions[i] == action) return i;
+    }
+    if (actionCount >= SINRICPRO_TRACE_ACTION_COUNT) return 0xFF;
+    actions[actionCount] = action;
+    return actionCount++;
+}
+
+MessageTrace Trace;
+
+}  // namespace SINRICPRO_NAMESPACE
+
+#define SINRICPRO_TRACE_RECEIVED(message)                     (message)->setTraceId(SINRICPRO_NAMESPACE::Trace.received((message)->getInterface()))
+#define SINRICPRO_TRACE_STAGE(traceId, name)                  SINRICPRO_NAMESPACE::Trace.stage(traceId, SINRICPRO_NAMESPACE::TraceStage::name)
+#define SINRICPRO_TRACE_REQUEST(traceId, replyToken, action)  SINRICPRO_NAMESPACE::Trace.request(traceId, replyToken, action)
+#define SINRICPRO_TRACE_DEVICE(traceId, deviceIndex)          SINRICPRO_NAMESPACE::Trace.device(traceId, deviceIndex)
+#define SINRICPRO_TRACE_OUTCOME(traceId, name)                SINRICPRO_NAMESPACE::Trace.outcome(traceId, SINRICPRO_NAMESPACE::TraceOutcome::name)
+#define SINRICPRO_TRACE_RESULT(traceId, success)              SINRICPRO_NAMESPACE::Trace.outcome(traceId, (success) ? SINRICPRO_NAMESPACE::TraceOutcome::success : SINRICPRO_NAMESPACE::TraceOutcome::failed)
+
+#else
+
+#define SINRICPRO_TRACE_RECEIVED(message)
+#define SINRICPRO_TRACE_STAGE(traceId, name)
+#define SINRICPRO_TRACE_REQUEST(traceId, replyToken, action)
+#define SINRICPRO_TRACE_DEVICE(traceId, deviceIndex)
+#define SINRICPRO_TRACE_OUTCOME(traceId, name)
+#define SINRICPRO_TRACE_RESULT(traceId, success)
+
+#endif
@@ -18,19 +18,32 @@
 #include "SinricProQueue.h"
 #include "SinricProConfig.h"
 #include "SinricProDebug.h"
+#include "SinricProMetrics.h"
+#include "SinricProTrace.h"
+#include "UdpAdmission.h"
 
 #include "SinricProNamespace.h"
 namespace SINRICPRO_NAMESPACE {
 
+/**
+ * @brief Receives requests from the local network and answers them
+ *
+ * Requests are received on a multicast socket which stays open (and joined) until stop() is called.
+ * Every request remembers the address and port it came from, responses are sent there via a separate unicast socket.
+ */
 class UdpListener {
   public:
     void              begin(SinricProQueue_t* receiveQueue);
     void              handle();
-    void              sendMessage(String &message);
+    void              sendMessage(String &message, const IPAddress& remoteIP, uint16_t remotePort);
+    void              released();
+    const UdpStats&   getStats() const;
     void              stop();
 
   private:
-    WiFiUDP           _udp;
+    WiFiUDP           _udp;       // multicast, receive only
+    WiFiUDP           _replyUdp;  // unicast responses
+    UdpAdmission      _admission;
     SinricProQueue_t* receiveQueue;
 };
 
@@ -47,33 +60,40 @@ void UdpListener::begin(SinricProQueue_t* receiveQueue) {
 void UdpListener::handle() {
   int len = _udp.parsePacket();
   if (!len) return;
+  if (!_admission.admit((uint32_t)_udp.remoteIP(), len)) return;  // the next parsePacket() discards the datagram
 
-  if (len) {
-    char* buf = (char*) malloc(len+1);
-    memset(buf, 0, len+1);
-    _udp.read(buf, len);
-    SinricProMessage* request = new SinricProMessage(IF_UDP, buf);
-    DEBUG_SINRIC("[SinricPro:UDP]: receiving request\r\n%s\r\n", buf);
-    free(buf);
-    receiveQueue->push(request);
-  }
+  char* buf = (char*) malloc(len+1);
+  memset(buf, 0, len+1);
+  _udp.read(buf, len);
+  SinricProMessage* request = new SinricProMessage(MessageRoute{IF_UDP, _udp.remoteIP(), _udp.remotePort(), (uint32_t)micros(), 0}, buf);
+  DEBUG_SINRIC("[SinricPro:UDP]: receiving request\r\n%s\r\n", buf);
+  free(buf);
+  SINRICPRO_TRACE_RECEIVED(request);
+  receiveQueue->push(request);
+  SINRICPRO_METRIC_COUNT(udpReceived);
+  SINRICPRO_METRIC_GAUGE(receiveQueue, receiveQueue->size());
 }
 
-void UdpListener::sendMessage(String &message) {
-  _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
-  _udp.print(message);
-  _udp.endPacket();
-  // restart UDP??
-  #if defined ESP8266
-    _udp.beginMulticast(WiFi.localIP(), UDP_MULTICAST_IP, UDP_MULTICAST_PORT);
-  #endif  
-  #if defined ESP32
-    _udp.beginMulticast(UDP_MULTICAST_IP, UDP_MULTICAST_PORT);
-  #endif  
+void UdpListener::sendMessage(String &message, const IPAddress& remoteIP, uint16_t remotePort) {
+  _replyUdp.beginPacket(remoteIP, remotePort);
+  _replyUdp.print(message);
+  _replyUdp.endPacket();
+}
+
+/**
+ * @brief A udp message has been taken from the receive queue
+ */
+void UdpListener::released() {
+  _admission.released();
+}
+
+const UdpStats& UdpListener::getStats() const {
+  return _admission.getStats();
 }
 
 void UdpListener::stop() {
   _udp.stop();
+  _replyUdp.stop();
 }
 
 } // SINRICPRO_NAMESPACE
\ No newline at end of file
@@ -19,8 +19,16 @@
 #include "SinricProConfig.h"
 #include "SinricProDebug.h"
 #include "SinricProInterface.h"
+#include "SinricProMetrics.h"
+#include "SinricProTrace.h"
 #include "SinricProNamespace.h"
 #include "SinricProQueue.h"
+#include "ReconnectScheduler.h"
+#include "DnsCache.h"
+#include "HeapStats.h"
+#include "TlsProfile.h"
+#include "AdaptiveHeartbeat.h"
+#include "ServerSelector.h"
 namespace SINRICPRO_NAMESPACE {
 
 enum class ConnectionState {
@@ -33,6 +41,15 @@ enum class ConnectionState {
 #error "Wrong WebSockets Version! Minimum Version is 2.3.5!!!"
 #endif
 
+/**
+ * @brief Timings of the most recent successful connection, measured from the start of the connection attempt
+ */
+struct ConnectionLatency {
+    uint32_t dns          = 0;  ///< milliseconds spent resolving the server address (0 if it was cached)
+    uint32_t connect      = 0;  ///< milliseconds until the websocket was connected (tcp, tls and websocket handshake)
+    uint32_t firstMessage = 0;  ///< milliseconds until the first message from the server was received
+};
+
 using wsConnectedCallback    = std::function<void(void)>;
 using wsDisconnectedCallback = std::function<void(void)>;
 using wsPongCallback         = std::function<void(uint32_t)>;
@@ -42,9 +59,13 @@ class WebsocketListener : protected WebSocketsClient {
     WebsocketListener();
     ~WebsocketListener();
 
-    void begin(String server, String appKey, String deviceIds, SinricProQueue_t* receiveQueue);
+    void begin(const std::vector<String>& servers, String appKey, String deviceIds, SinricProQueue_t* receiveQueue, ConnectionCause cause = ConnectionCause::startup);
     void handle();
     void stop();
+    void suspend();
+    void resume();
+    bool isStarted();
+    unsigned long nextDeadlineIn();
     void setRestoreDeviceStates(bool flag);
 
     void sendMessage(String& message);
@@ -52,14 +73,41 @@ class WebsocketListener : protected WebSocketsClient {
     void onConnected(wsConnectedCallback callback);
     void onDisconnected(wsDisconnectedCallback callback);
     void onPong(wsPongCallback callback);
-    
+    void onConnectionAttempt(ConnectionAttemptCallback callback);
+    void onServerPreferenceChanged(ServerPreferenceCallback callback);
+    void setPreferredServer(size_t index);
+
+    const ConnectionAttempt& getLastConnectionAttempt() const;
+    const ConnectionLatency& getConnectionLatency() const;
+    const HeapStats&         getHeapStats() const;
+    const TlsStats&          getTlsStats() const;
+    const HeartbeatStats&    getHeartbeatStats() const;
+    const String&            getCurrentServer() const;
+    const ServerSelection&   getServerSelection() const;
+    const std::vector<ServerStats>& getServerStats() const;
+
     using WebSocketsClient::disconnect;
     using WebSocketsClient::isConnected;
 
   protected:
     bool _begin;
+    bool _suspended;
     bool restoreDeviceStates;
     ConnectionState connectionState;
+    ReconnectScheduler reconnectScheduler;
+    DnsCache dnsCache;
+    HeapMonitor heapMonitor;
+    TlsProfile tlsProfile;
+    AdaptiveHeartbeat heartbeat;
+    ServerSelector serverSelector;
+#if defined(WEBSOCKET_SSL) && defined(SSL_BARESSL)
+    BearSSL::Session tlsSession;
+#endif
+
+    unsigned long     attemptStartedAt;
+    bool              waitForFirstMessage;
+    ConnectionLatency pendingLatency;
+    ConnectionLatency latency;
 
     wsConnectedCallback    _wsConnectedCb;
     wsDisconnectedCallback _wsDisconnectedCb;
@@ -68,15 +116,24 @@ class WebsocketListener : protected WebSocketsClient {
     virtual void runCbEvent(WStype_t type, uint8_t* payload, size_t length) override;
 
     void              setExtraHeaders();
+    void              startClient();
+    bool              openConnection(const IPAddress& address);
+    void              attemptFailed();
+    void              applyHeartbeat();
     SinricProQueue_t* receiveQueue;
+    String            server;
+    String            tlsServer;
     String            deviceIds;
     String            appKey;
 };
 
 WebsocketListener::WebsocketListener()
     : _begin(false)
+    , _suspended(false)
     , restoreDeviceStates(false)
     , connectionState(ConnectionState::disconnected)
+    , attemptStartedAt(0)
+    , waitForFirstMessage(false)
     , _wsConnectedCb(nullptr)
     , _wsDisconnectedCb(nullptr)
     , _wsPongCb(nullptr) {}
@@ -110,39 +167,188 @@ void WebsocketListener::setExtraHeaders() {
     WebSocketsClient::setExtraHeaders(headers.c_str());
 }
 
-void WebsocketListener::begin(String server, String appKey, String deviceIds, SinricProQueue_t* receiveQueue) {
+void WebsocketListener::begin(const std::vector<String>& servers, String appKey, String deviceIds, SinricProQueue_t* receiveQueue, ConnectionCause cause) {
     if (_begin) return;
     _begin = true;
-    connectionState = ConnectionState::connecting;
+    connectionState = ConnectionState::disconnected;
 
     this->receiveQueue = receiveQueue;
     this->appKey       = appKey;
     this->deviceIds    = deviceIds;
+    serverSelector.setServers(servers);
+    server = serverSelector.getCurrent();
+
+    if (isConnected()) stop();
+    setExtraHeaders();
+    enableHeartbeat(heartbeat.getInterval(), heartbeat.getPongTimeout(), WEBSOCKET_RETRY_COUNT);
+    startClient();
+    reconnectScheduler.schedule(cause);
+}
 
+void WebsocketListener::startClient() {
 #ifdef WEBSOCKET_SSL
     DEBUG_SINRIC("[SinricPro:Websocket]: Connecting to WebSocket Server using SSL (%s)\r\n", server.c_str());
+    WebSocketsClient::beginSSL(server.c_str(), SINRICPRO_SERVER_SSL_PORT, "/");
 #else
     DEBUG_SINRIC("[SinricPro:Websocket]: Connecting to WebSocket Server (%s)\r\n", server.c_str());
+    WebSocketsClient::begin(server.c_str(), SINRICPRO_SERVER_PORT, "/");  // server address, port and URL
+#endif
+    if (tlsServer != server) {  // tls session and probe result belong to one server
+        tlsServer = server;
+#if defined(WEBSOCKET_SSL) && defined(SSL_BARESSL)
+        tlsSession = BearSSL::Session();
 #endif
+        tlsProfile.reset();
+    }
+    // connections are opened by openConnection(), WebSocketsClient::loop() must never connect on its own
+    setReconnectInterval(ULONG_MAX);
+}
 
-    if (isConnected()) stop();
-    setExtraHeaders();
-    enableHeartbeat(WEBSOCKET_PING_INTERVAL, WEBSOCKET_PING_TIMEOUT, WEBSOCKET_RETRY_COUNT);
+/**
+ * @brief Open the tcp / tls connection to the resolved server address and start the websocket handshake
+ *
+ * The hostname is kept for the Host header and for SNI. BearSSL (ESP8266, RP2040) can't connect to an address with
+ * SNI, so it connects by hostname (answered from the lwIP dns table) and resumes the previous tls session instead.
+ * @return `false` if the connection could not be opened
+ */
+bool WebsocketListener::openConnection(const IPAddress& address) {
 #ifdef WEBSOCKET_SSL
-    WebSocketsClient::beginSSL(server.c_str(), SINRICPRO_SERVER_SSL_PORT, "/");
+    WEBSOCKETS_NETWORK_SSL_CLASS* client = new WEBSOCKETS_NETWORK_SSL_CLASS();
+    client->setInsecure();
+    tlsProfile.apply(*client);
+#if defined(SSL_BARESSL)
+    client->setSession(&tlsSession);
+    bool connected = client->connect(server.c_str(), SINRICPRO_SERVER_SSL_PORT);
 #else
-    WebSocketsClient::begin(server.c_str(), SINRICPRO_SERVER_PORT, "/");  // server address, port and URL
+    bool connected = client->connect(address, SINRICPRO_SERVER_SSL_PORT, server.c_str(), nullptr, nullptr, nullptr);
+#endif
+    _client.ssl = client;
+#else
+    WEBSOCKETS_NETWORK_CLASS* client    = new WEBSOCKETS_NETWORK_CLASS();
+    bool                      connected = client->connect(address, SINRICPRO_SERVER_PORT);
+#endif
+    _client.tcp = client;
+
+    if (!connected) {
+        DEBUG_SINRIC("[SinricPro:Websocket]: unable to connect to %s (%s)\r\n", server.c_str(), address.toString().c_str());
+        delete client;
+#ifdef WEBSOCKET_SSL
+        _client.ssl = nullptr;
 #endif
+        _client.tcp = nullptr;
+        return false;
+    }
+    connectedCb();  // sends the websocket handshake, WebSocketsClient::loop() takes over from here
+    return true;
 }
 
 void WebsocketListener::handle() {
+    if (connectionState == ConnectionState::disconnected) {
+        // WebSocketsClient::loop() would start a new connection attempt, so don't call it before the next attempt is due
+        if (!reconnectScheduler.isDue()) return;
+        reconnectScheduler.attemptStarted();
+        attemptStartedAt = millis();
+
+        const String& selectedServer = serverSelector.select();
+        if (selectedServer != server) {
+            server = selectedServer;
+            startClient();
+        }
+
+        // don't start a tcp / tls connection if the server can't be resolved
+        IPAddress serverAddress;
+        if (!dnsCache.resolve(server, serverAddress)) {
+            attemptFailed();
+            return;
+        }
+        pendingLatency.dns = millis() - attemptStartedAt;
+
+#ifdef WEBSOCKET_SSL
+        tlsProfile.probe(serverAddress, SINRICPRO_SERVER_SSL_PORT);
+#endif
+        heapMonitor.beforeHandshake();
+        if (heapMonitor.getStats().blockBeforeHandshake < tlsProfile.requiredBlock()) {
+            DEBUG_SINRIC("[SinricPro:Websocket]: not enough memory for a connection (%lu of %lu bytes)\r\n", (unsigned long)heapMonitor.getStats().blockBeforeHandshake, (unsigned long)tlsProfile.requiredBlock());
+            attemptFailed();
+            return;
+        }
+        if (!openConnection(serverAddress)) {
+            attemptFailed();
+            return;
+        }
+        connectionState = ConnectionState::connecting;
+    }
+
     loop();
+
+    if (connectionState == ConnectionState::connected) heapMonitor.sample();
+
+    // tcp / ssl connect failed without a WStype_DISCONNECTED event
+    if (connectionState == ConnectionState::connecting && _client.status == WSC_NOT_CONNECTED) {
+        connectionState = ConnectionState::disconnected;
+        attemptFailed();
+    }
+}
+
+void WebsocketListener::attemptFailed() {
+    DEBUG_SINRIC("[SinricPro:Websocket]: connection attempt failed\r\n");
+    // the server address might have changed
+    dnsCache.invalidate();
+    serverSelector.failed();
+    reconnectScheduler.schedule(ConnectionCause::retry);
 }
 
 void WebsocketListener::stop() {
-    disconnect();
     _begin = false;
+    disconnect();
     connectionState = ConnectionState::disconnected;
+    reconnectScheduler.cancel();
+}
+
+/**
+ * @brief Close the connection and stop reconnecting until resume() gets called (WiFi lost)
+ */
+void WebsocketListener::suspend() {
+    if (_suspended) return;
+    _suspended = true;
+    if (connectionState != ConnectionState::disconnected) disconnect();
+    connectionState = ConnectionState::disconnected;
+    reconnectScheduler.cancel();
+}
+
+/**
+ * @brief Schedule a new connection attempt after suspend() (WiFi restored)
+ */
+void WebsocketListener::resume() {
+    if (!_suspended) return;
+    _suspended = false;
+    if (_begin) reconnectScheduler.schedule(ConnectionCause::wifiRestored);
+}
+
+bool WebsocketListener::isStarted() {
+    return _begin;
+}
+
+/**
+ * @brief Time in milliseconds until handle() has work to do (next connection attempt, ping or pong timeout)
+ * @return `0` while a connection attempt is in progress, `ULONG_MAX` if nothing is scheduled
+ */
+unsigned long WebsocketListener::nextDeadlineIn() {
+    if (!_begin || _suspended) return ULONG_MAX;
+
+    switch (connectionState) {
+        case ConnectionState::disconnected:
+            return reconnectScheduler.nextAttemptIn();
+        case ConnectionState::connecting:
+            return 0;
+        case ConnectionState::connected: {
+            unsigned long timeout = _client.pongReceived ? _client.pingInterval : _client.pongTimeout;
+            if (!timeout) return ULONG_MAX;
+            unsigned long elapsed = millis() - _client.lastPing;
+            return elapsed >= timeout ? 0 : timeout - elapsed;
+        }
+    }
+    return 0;
 }
 
 void WebsocketListener::setRestoreDeviceStates(bool flag) {
@@ -165,13 +371,70 @@ void WebsocketListener::onPong(wsPongCallback callback) {
     _wsPongCb = callback;
 }
 
+void WebsocketListener::onConnectionAttempt(ConnectionAttemptCallback callback) {
+    reconnectScheduler.onAttempt(callback);
+}
+
+const ConnectionAttempt& WebsocketListener::getLastConnectionAttempt() const {
+    return reconnectScheduler.lastAttempt();
+}
+
+const ConnectionLatency& WebsocketListener::getConnectionLatency() const {
+    return latency;
+}
+
+const HeapStats& WebsocketListener::getHeapStats() const {
+    return heapMonitor.getStats();
+}
+
+const TlsStats& WebsocketListener::getTlsStats() const {
+    return tlsProfile.getStats();
+}
+
+const HeartbeatStats& WebsocketListener::getHeartbeatStats() const {
+    return heartbeat.getStats();
+}
+
+void WebsocketListener::onServerPreferenceChanged(ServerPreferenceCallback callback) {
+    serverSelector.onPreferenceChanged(callback);
+}
+
+void WebsocketListener::setPreferredServer(size_t index) {
+    serverSelector.setPreferred(index);
+}
+
+const String& WebsocketListener::getCurrentServer() const {
+    return server;
+}
+
+const ServerSelection& WebsocketListener::getServerSelection() const {
+    return serverSelector.getLastSelection();
+}
+
+const std::vector<ServerStats>& WebsocketListener::getServerStats() const {
+    return serverSelector.getStats();
+}
+
+void WebsocketListener::applyHeartbeat() {
+    // enableHeartbeat() would reset the pong state, so only update the timings
+    _client.pingInterval = heartbeat.getInterval();
+    _client.pongTimeout  = heartbeat.getPongTimeout();
+}
+
 void WebsocketListener::runCbEvent(WStype_t type, uint8_t* payload, size_t length) {
     (void)length;
 
     switch (type) {
         case WStype_DISCONNECTED: {
                 DEBUG_SINRIC("[SinricPro:Websocket]: disconnected\r\n");
-                if (connectionState == ConnectionState::connected && _wsDisconnectedCb) _wsDisconnectedCb();
+                if (connectionState == ConnectionState::connected) {
+                    if (_begin && !_suspended) heartbeat.connectionLost();
+                    applyHeartbeat();
+                    if (_wsDisconnectedCb) _wsDisconnectedCb();
+                    reconnectScheduler.schedule(ConnectionCause::connectionLost);
+                } else if (connectionState == ConnectionState::connecting) {
+                    attemptFailed();
+                }
                 connectionState = ConnectionState::disconnected;
            }
             break;
@@ -184,17 +447,35 @@ void WebsocketListener::runCbEvent(WStype_t type, uint8_t* payload, size_t lengt
                 setExtraHeaders();
             }
             connectionState = ConnectionState::connected;
+            reconnectScheduler.connected();
+            pendingLatency.connect = millis() - attemptStartedAt;
+            waitForFirstMessage    = true;
+            heapMonitor.afterHandshake();
+            heartbeat.connected();
             break;
 
         case WStype_TEXT: {
             SinricProMessage* request = new SinricProMessage(IF_WEBSOCKET, (char*)payload);
             DEBUG_SINRIC("[SinricPro:Websocket]: receiving data\r\n");
+            SINRICPRO_TRACE_RECEIVED(request);
             receiveQueue->push(request);
+            SINRICPRO_METRIC_COUNT(websocketReceived);
+            SINRICPRO_METRIC_GAUGE(receiveQueue, receiveQueue->size());
+            if (waitForFirstMessage) {
+                waitForFirstMessage         = false;
+                pendingLatency.firstMessage = millis() - attemptStartedAt;
+                latency                     = pendingLatency;
+                serverSelector.connected(latency.firstMessage);
+                DEBUG_SINRIC("[SinricPro:Websocket]: latency: dns %lu ms, connect %lu ms, first message %lu ms\r\n", (unsigned long)latency.dns, (unsigned long)latency.connect, (unsigned long)latency.firstMessage);
+            }
             break;
         }
 
         case WStype_PONG: {
-            if (_wsPongCb) _wsPongCb(millis() - _client.lastPing);
+            uint32_t rtt = millis() - _client.lastPing;
+            heartbeat.pongReceived(rtt);
+            applyHeartbeat();
+            if (_wsPongCb) _wsPongCb(rtt);
             break;
         }
 
@@ -0,0 +1,201 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+/*
+ * Device states are only shadowed if SINRICPRO_STATE_SHADOW is defined (before including SinricPro.h).
+ * Otherwise StateShadow and StateShadowMap keep nothing and every state is unknown.
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <functional>
+#include <vector>
+
+#include "SinricProNamespace.h"
+namespace SINRICPRO_NAMESPACE {
+
+/**
+ * @brief Callback to add the shadowed states of a capability to a device state dump
+ */
+using SinricProStateHandler = std::function<void(JsonObject&)>;
+
+/**
+ * @brief Shadow updates made by a request whose response has been deferred
+ *
+ * Applied when the deferred response completes successfully, dropped if it fails or times out.
+ */
+using StateShadowUpdates = std::vector<std::function<void()>>;
+
+/**
+ * @brief Collects the shadow updates while a deferred request is handled (`nullptr` = update right away)
+ */
+StateShadowUpdates*& deferredShadowUpdates() {
+    static StateShadowUpdates* updates = nullptr;
+    return updates;
+}
+
+/**
+ * @brief Last known value of a device state
+ *
+ * Updated by accepted requests and sent events. Only kept if `SINRICPRO_STATE_SHADOW` is defined,
+ * otherwise the state is never known and all functions do nothing.
+ */
+template <typename V>
+class StateShadow {
+  public:
+    bool     isKnown() const;
+    bool     isUnchanged(const V& value) const;
+    const V& get() const;
+    void     set(const V& value);
+
+#ifdef SINRICPRO_STATE_SHADOW
+  protected:
+    V    value{};
+    bool known = false;
+#endif
+};
+
+template <typename V>
+bool StateShadow<V>::isKnown() const {
+#ifdef SINRICPRO_STATE_SHADOW
+    return known;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief `true` if the state is known and equal to `value` (an event would not change anything)
+ */
+template <typename V>
+bool StateShadow<V>::isUnchanged(const V& value) const {
+    return isKnown() && get() == value;
+}
+
+template <typename V>
+const V& StateShadow<V>::get() const {
+#ifdef SINRICPRO_STATE_SHADOW
+    return value;
+#else
+    static V unknown{};
+    return unknown;
+#endif
+}
+
+template <typename V>
+void StateShadow<V>::set(const V& value) {
+#ifdef SINRICPRO_STATE_SHADOW
+    if (StateShadowUpdates* updates = deferredShadowUpdates()) {
+        updates->push_back([this, value]() {
+            this->value = value;
+            known       = true;
+        });
+        return;
+    }
+    this->value = value;
+    known       = true;
+#else
+    (void)value;
+#endif
+}
+
+/**
+ * @brief Last known values of a device state with multiple instances (eg. modes or range values)
+ *
+ * The default instance uses an empty instance name.
+ */
+template <typename V>
+class StateShadowMap {
+  public:
+    struct Entry {
+        String instance;
+        V      value;
+    };
+
+    bool                      isKnown(const String& instance) const;
+    bool                      isUnchanged(const String& instance, const V& value) const;
+    const V&                  get(const String& instance) const;
+    void                      set(const String& instance, const V& value);
+    const std::vector<Entry>& entries() const;
+
+#ifdef SINRICPRO_STATE_SHADOW
+  protected:
+    const Entry* find(const String& instance) const;
+
+    std::vector<Entry> values;
+#endif
+};
+
+template <typename V>
+bool StateShadowMap<V>::isKnown(const String& instance) const {
+#ifdef SINRICPRO_STATE_SHADOW
+    return find(instance) != nullptr;
+#else
+    (void)instance;
+    return false;
+#endif
+}
+
+template <typename V>
+bool StateShadowMap<V>::isUnchanged(const String& instance, const V& value) const {
+    return isKnown(instance) && get(instance) == value;
+}
+
+template <typename V>
+const V& StateShadowMap<V>::get(const String& instance) const {
+    static V unknown{};
+#ifdef SINRICPRO_STATE_SHADOW
+    const Entry* entry = find(instance);
+    if (entry) return entry->value;
+#else
+    (void)instance;
+#endif
+    return unknown;
+}
+
+template <typename V>
+void StateShadowMap<V>::set(const String& instance, const V& value) {
+#ifdef SINRICPRO_STATE_SHADOW
+    if (StateShadowUpdates* updates = deferredShadowUpdates()) {
+        updates->push_back([this, instance, value]() { set(instance, value); });
+        return;
+    }
+    Entry* entry = const_cast<Entry*>(find(instance));
+    if (entry) {
+        entry->value = value;
+    } else {
+        values.push_back(Entry{instance, value});
+    }
+#else
+    (void)instance;
+    (void)value;
+#endif
+}
+
+template <typename V>
+const std::vector<typename StateShadowMap<V>::Entry>& StateShadowMap<V>::entries() const {
+#ifdef SINRICPRO_STATE_SHADOW
+    return values;
+#else
+    static const std::vector<Entry> none;
+    return none;
+#endif
+}
+
+#ifdef SINRICPRO_STATE_SHADOW
+template <typename V>
+const typename StateShadowMap<V>::Entry* StateShadowMap<V>::find(const String& instance) const {
+    for (auto& entry : values) {
+        if (entry.instance == instance) return &entry;
+    }
+    return nullptr;
+}
+#endif
+
+}  // namespace SINRICPRO_NAMESPACE
@@ -1,15 +1,50 @@
 #include "Timestamp.h"
 
+// the timestamp is set by the network side and read by the application side (SINRICPRO_NETWORK_TASK),
+// a 64 bit value can't be read or written in one go on these cores
+#if defined(ESP32)
+static portMUX_TYPE timestampMux = portMUX_INITIALIZER_UNLOCKED;
+struct TimestampLock {
+    TimestampLock() { portENTER_CRITICAL(&timestampMux); }
+    ~TimestampLock() { portEXIT_CRITICAL(&timestampMux); }
+};
+#elif defined(ARDUINO_ARCH_RP2040)
+#include <atomic>
+static std::atomic_flag timestampFlag = ATOMIC_FLAG_INIT;
+struct TimestampLock {
+    TimestampLock() { while (timestampFlag.test_and_set(std::memory_order_acquire)) {} }
+    ~TimestampLock() { timestampFlag.clear(std::memory_order_release); }
+};
+#else
+struct TimestampLock {
+    TimestampLock() {}
+};
+#endif
+
 uint32_t Timestamp::getTimestamp() {
+    TimestampLock lock;
     update();
     return timestamp_ms / 1000UL;
 }
 
 void Timestamp::setTimestamp(uint32_t new_timestamp) {
+    TimestampLock lock;
     timestamp_ms = uint64_t(new_timestamp) * 1000;
     last_update  = millis();
 }
 
+uint64_t Timestamp::getTimestampMs() {
+    TimestampLock lock;
+    update();
+    return timestamp_ms;
+}
+
+void Timestamp::setTimestampMs(uint64_t new_timestamp_ms) {
+    TimestampLock lock;
+    timestamp_ms = new_timestamp_ms;
+    last_update  = millis();
+}
+
 void Timestamp::update() {
     if (!timestamp_ms) return;
     uint32_t current_millis = millis();
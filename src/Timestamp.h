@@ -6,6 +6,8 @@ class Timestamp {
   public:
     uint32_t getTimestamp();
     void     setTimestamp(uint32_t);
+    uint64_t getTimestampMs();
+    void     setTimestampMs(uint64_t);
 
   protected:
     void update();
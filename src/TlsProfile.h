@@ -0,0 +1,138 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <WebSocketsClient.h>
+
+#include "SinricProConfig.h"
+#include "SinricProDebug.h"
+#include "SinricProNamespace.h"
+namespace SINRICPRO_NAMESPACE {
+
+/**
+ * @brief Memory profile of the tls connection
+ *
+ * All sizes are in bytes, buffer sizes without the protocol overhead.
+ */
+struct TlsStats {
+    uint16_t fragmentLength = 0;  ///< max fragment length accepted by the server (0 = not negotiated, default buffers)
+    uint16_t rxBuffer       = 0;  ///< receive buffer of the secure client (0 = default size)
+    uint16_t txBuffer       = 0;  ///< transmit buffer of the secure client (0 = default size)
+    uint32_t requiredBlock  = 0;  ///< largest free heap block required to start a handshake (0 = not checked)
+};
+
+/**
+ * @brief Chooses the buffer sizes of the secure client
+ *
+ * With BearSSL (ESP8266, RP2040) the server is probed once for max fragment length support. If it accepts
+ * `SINRICPRO_TLS_FRAGMENT_LENGTH`, the receive buffer is shrunk to that size and the transmit buffer to
+ * `SINRICPRO_TLS_TX_BUFFER` (outgoing messages are split into records of that size). If it refuses, the default
+ * buffers are used. mbedTLS (ESP32) buffer sizes are fixed at build time.
+ * Only the websocket connection is profiled; the camera upload client (CameraController, ESP32 only) uses mbedTLS and
+ * is not covered.
+ */
+class TlsProfile {
+  public:
+    TlsProfile();
+
+    void reset();
+    void probe(const IPAddress& address, uint16_t port);
+    template <typename SecureClient>
+    void apply(SecureClient& client);
+    uint32_t requiredBlock() const;
+
+    const TlsStats& getStats() const;
+
+  protected:
+    enum class ProbeResult : uint8_t {
+        unknown,
+        accepted,
+        refused
+    };
+
+    ProbeResult probeResult;
+    TlsStats    stats;
+};
+
+#if defined(SSL_BARESSL)
+static const uint32_t TLS_RX_OVERHEAD     = 325;          // BearSSL record overhead of the receive buffer
+static const uint32_t TLS_DEFAULT_RX_SIZE = 16384 + 325;  // BearSSL default receive buffer
+#endif
+
+TlsProfile::TlsProfile()
+    : probeResult(ProbeResult::unknown) {
+    stats.requiredBlock = requiredBlock();
+}
+
+/**
+ * @brief Forget the probe result (the server has changed)
+ */
+void TlsProfile::reset() {
+    probeResult          = ProbeResult::unknown;
+    stats.fragmentLength = 0;
+    stats.rxBuffer       = 0;
+    stats.txBuffer       = 0;
+    stats.requiredBlock  = requiredBlock();
+}
+
+/**
+ * @brief Ask the server for max fragment length support (once per server)
+ */
+void TlsProfile::probe(const IPAddress& address, uint16_t port) {
+#if defined(WEBSOCKET_SSL) && defined(SSL_BARESSL)
+    if (!SINRICPRO_TLS_FRAGMENT_LENGTH || probeResult != ProbeResult::unknown) return;
+
+    if (WEBSOCKETS_NETWORK_SSL_CLASS::probeMaxFragmentLength(address, port, SINRICPRO_TLS_FRAGMENT_LENGTH)) {
+        DEBUG_SINRIC("[SinricPro:TLS]: max fragment length %i accepted\r\n", SINRICPRO_TLS_FRAGMENT_LENGTH);
+        probeResult          = ProbeResult::accepted;
+        stats.fragmentLength = SINRICPRO_TLS_FRAGMENT_LENGTH;
+        stats.rxBuffer       = SINRICPRO_TLS_FRAGMENT_LENGTH;
+        stats.txBuffer       = SINRICPRO_TLS_TX_BUFFER;
+    } else {
+        DEBUG_SINRIC("[SinricPro:TLS]: max fragment length refused, using default buffers\r\n");
+        probeResult = ProbeResult::refused;
+    }
+    stats.requiredBlock = requiredBlock();
+#else
+    (void)address;
+    (void)port;
+#endif
+}
+
+/**
+ * @brief Set the buffer sizes of a secure client before it connects
+ */
+template <typename SecureClient>
+void TlsProfile::apply(SecureClient& client) {
+#if defined(SSL_BARESSL)
+    if (probeResult == ProbeResult::accepted) client.setBufferSizes(stats.rxBuffer, stats.txBuffer);
+#else
+    (void)client;
+#endif
+}
+
+/**
+ * @brief Largest free heap block needed for a handshake: `SINRICPRO_TLS_MIN_FREE_BLOCK` if set, otherwise the
+ * receive buffer of BearSSL (0 for mbedTLS and plain websocket connections)
+ */
+uint32_t TlsProfile::requiredBlock() const {
+    uint32_t configured = SINRICPRO_TLS_MIN_FREE_BLOCK;
+    if (configured) return configured;
+#if defined(WEBSOCKET_SSL) && defined(SSL_BARESSL)
+    return probeResult == ProbeResult::accepted ? stats.rxBuffer + TLS_RX_OVERHEAD : TLS_DEFAULT_RX_SIZE;
+#else
+    return 0;
+#endif
+}
+
+const TlsStats& TlsProfile::getStats() const {
+    return stats;
+}
+
+}  // namespace SINRICPRO_NAMESPACE
@@ -0,0 +1,200 @@
+/*
+ *  Copyright (c) 2019 Sinric. All rights reserved.
+ *  Licensed under Creative Commons Attribution-Share Alike (CC BY-SA)
+ *
+ *  This file is part of the Sinric Pro (https://github.com/sinricpro/)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <vector>
+
+#include "SinricProConfig.h"
+#include "SinricProDebug.h"
+#include "SinricProMetrics.h"
+#include "SinricProNamespace.h"
+namespace SINRICPRO_NAMESPACE {
+
+/**
+ * @brief Limits of an admission control instance
+ */
+struct AdmissionLimits {
+    size_t        maxSize;        ///< bytes
+    size_t        queueShare;     ///< messages waiting in the receive queue
+    size_t        queueReserved;  ///< part of `queueShare` which unknown sources can't use
+    uint32_t      rate;           ///< messages per second and source
+    uint32_t      burst;          ///< messages a source may send at once
+    size_t        sources;        ///< source addresses tracked by the rate limit
+    unsigned long sourceIdle;     ///< ms after which a tracked source may be replaced by a new one
+};
+
+/**
+ * @brief Limits of the udp listener (`SINRICPRO_UDP_*`)
+ */
+inline AdmissionLimits udpAdmissionLimits() {
+    return AdmissionLimits{SINRICPRO_UDP_MAX_SIZE, SINRICPRO_UDP_QUEUE_SHARE, SINRICPRO_UDP_QUEUE_RESERVED, SINRICPRO_UDP_RATE, SINRICPRO_UDP_BURST, SINRICPRO_UDP_SOURCES, SINRICPRO_UDP_SOURCE_IDLE};
+}
+
+/**
+ * @brief Statistics of the udp admission control
+ */
+struct UdpStats {
+    uint32_t accepted;     ///< datagrams passed to the receive queue
+    uint32_t oversized;    ///< datagrams larger than `maxSize` (`SINRICPRO_UDP_MAX_SIZE`)
+    uint32_t queueFull;    ///< datagrams dropped because the queue share (`SINRICPRO_UDP_QUEUE_SHARE`) is used
+    uint32_t rateLimited;  ///< datagrams dropped by the per-source rate limit
+};
+
+/**
+ * @brief Decides if a udp datagram is accepted, before any memory is allocated and before JSON parsing or HMAC work
+ *
+ * - datagrams larger than `maxSize` bytes are rejected
+ * - at most `queueShare` messages wait in the receive queue, `queueReserved` of them are reserved for known sources
+ * - every known source has a token bucket of `burst` datagrams, refilled with `rate` datagrams per second
+ * - all unknown sources share one such bucket. A source becomes known when a datagram of it is admitted, its own
+ *   bucket starts empty. So rotating (spoofed) source addresses get no more than the shared bucket plus the buckets of
+ *   the `sources` known sources.
+ * - a new source replaces a source which has been idle for `sourceIdle` ms, otherwise the source which became known
+ *   last. Sources which have been admitted earlier keep their bucket during a flood of new addresses.
+ *
+ * The udp listener uses the `SINRICPRO_UDP_*` limits, the local websocket server has its own instance with the
+ * `SINRICPRO_LOCAL_SERVER_*` limits (see SinricProLocalServer.h).
+ */
+class UdpAdmission {
+  public:
+    UdpAdmission();
+    explicit UdpAdmission(const AdmissionLimits& limits);
+
+    bool                   admit(uint32_t sourceIP, size_t length);
+    void                   released();
+    const UdpStats&        getStats() const;
+    const AdmissionLimits& getLimits() const;
+
+  protected:
+    struct Source {
+        uint32_t      ip;
+        uint32_t      tokens;  // 1/1000 datagram
+        unsigned long lastRefill;
+        unsigned long knownSince;
+        bool          used;
+    };
+
+    Source* find(uint32_t sourceIP);
+    Source* replace(unsigned long currentMillis);
+    bool    takeToken(uint32_t& tokens, unsigned long& lastRefill, unsigned long currentMillis);
+
+    AdmissionLimits     limits;
+    std::vector<Source> sources;
+    uint32_t            unknownTokens;  // bucket shared by all unknown sources
+    unsigned long       unknownRefill;
+    size_t              queued;
+    UdpStats            stats;
+};
+
+UdpAdmission::UdpAdmission()
+    : UdpAdmission(udpAdmissionLimits()) {}
+
+UdpAdmission::UdpAdmission(const AdmissionLimits& limits)
+    : limits(limits)
+    , sources(limits.sources)
+    , unknownTokens(limits.burst * 1000)
+    , unknownRefill(millis())
+    , queued(0)
+    , stats() {}
+
+/**
+ * @brief Check if a received datagram may be queued
+ * @param sourceIP  address of the sender
+ * @param length    size of the datagram in bytes
+ * @return `true` if the datagram has been admitted (call `released()` when it has been taken from the receive queue)
+ */
+bool UdpAdmission::admit(uint32_t sourceIP, size_t length) {
+    if (length > limits.maxSize) {
+        DEBUG_SINRIC("[SinricPro:UDP]: datagram of %i bytes rejected (too large)\r\n", length);
+        stats.oversized++;
+        SINRICPRO_METRIC_COUNT(udpOversized);
+        return false;
+    }
+
+    Source* source = find(sourceIP);
+    size_t  share  = source ? limits.queueShare : limits.queueShare - limits.queueReserved;
+    if (queued >= share) {
+        DEBUG_SINRIC("[SinricPro:UDP]: datagram rejected (receive queue share exhausted)\r\n");
+        stats.queueFull++;
+        SINRICPRO_METRIC_COUNT(udpQueueFull);
+        return false;
+    }
+
+    unsigned long currentMillis = millis();
+    bool          admitted      = source ? takeToken(source->tokens, source->lastRefill, currentMillis) : takeToken(unknownTokens, unknownRefill, currentMillis);
+    if (!admitted) {
+        DEBUG_SINRIC("[SinricPro:UDP]: datagram rejected (rate limit)\r\n");
+        stats.rateLimited++;
+        SINRICPRO_METRIC_COUNT(udpRateLimited);
+        return false;
+    }
+    if (!source) {
+        source             = replace(currentMillis);
+        source->used       = true;
+        source->ip         = sourceIP;
+        source->tokens     = 0;
+        source->lastRefill = currentMillis;
+        source->knownSince = currentMillis;
+    }
+    queued++;
+    stats.accepted++;
+    return true;
+}
+
+/**
+ * @brief An admitted datagram has been taken from the receive queue
+ */
+void UdpAdmission::released() {
+    if (queued) queued--;
+}
+
+const UdpStats& UdpAdmission::getStats() const {
+    return stats;
+}
+
+const AdmissionLimits& UdpAdmission::getLimits() const {
+    return limits;
+}
+
+UdpAdmission::Source* UdpAdmission::find(uint32_t sourceIP) {
+    for (auto& source : sources) {
+        if (source.used && source.ip == sourceIP) return &source;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Entry for a new source: a free one, the longest idle one if it is idle for `sourceIdle` ms,
+ * otherwise the one which became known last
+ */
+UdpAdmission::Source* UdpAdmission::replace(unsigned long currentMillis) {
+    Source* idle   = &sources[0];
+    Source* newest = &sources[0];
+    for (auto& source : sources) {
+        if (!source.used) return &source;
+        if ((long)(source.lastRefill - idle->lastRefill) < 0) idle = &source;
+        if ((long)(source.knownSince - newest->knownSince) > 0) newest = &source;
+    }
+    return currentMillis - idle->lastRefill >= limits.sourceIdle ? idle : newest;
+}
+
+bool UdpAdmission::takeToken(uint32_t& tokens, unsigned long& lastRefill, unsigned long currentMillis) {
+    const uint32_t fullBucket = limits.burst * 1000;
+
+    unsigned long elapsed = currentMillis - lastRefill;
+    lastRefill            = currentMillis;
+    tokens                = (elapsed >= limits.burst * 1000UL / limits.rate) ? fullBucket : min(fullBucket, tokens + (uint32_t)(elapsed * limits.rate));
+
+    if (tokens < 1000) return false;
+    tokens -= 1000;
+    return true;
+}
+
+}  // namespace SINRICPRO_NAMESPACE